@@ -0,0 +1,77 @@
+#ifndef BASE_ACCEPTOR_H_
+#define BASE_ACCEPTOR_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Monitor.h>
+#include <Base/Thread.h>
+#include <Base/Type.h>
+#else
+#include <Monitor.h>
+#include <Thread.h>
+#include <Type.h>
+#endif
+
+#if __cplusplus
+namespace Base {
+class Acceptor {
+ public:
+  /* @NOTE: this callback is called on the thread of a shard for every
+   * connection which the shard accepts. The shard's Monitor is given so the
+   * connection can be watched there and its callbacks stay on the same core.
+   * When it fails, the connection is closed */
+  using Accept = Function<ErrorCodeE(Int socket, Monitor& monitor)>;
+
+  /* @NOTE: an acceptor listens on one port with several sockets which are
+   * bound with SO_REUSEPORT, so the kernel spreads new connections among
+   * them. Every socket belongs to a shard, a shard is a Monitor of its own
+   * type with its own polling system and a thread which is pinned to a core,
+   * so shards don't share a HEAD or any lock on the accepting path:
+   *
+   *                        kernel (SO_REUSEPORT)
+   *               +---------------+---------------+
+   *               |               |               |
+   *           socket 0        socket 1        socket 2
+   *               |               |               |
+   *          Monitor 0       Monitor 1       Monitor 2
+   *           (core 0)        (core 1)        (core 2)
+   *
+   * - shards == 0: we use one shard per core which we can run on.
+   * ______________________________________________________________________ */
+  explicit Acceptor(UInt shards = 0);
+  virtual ~Acceptor();
+
+  /* @NOTE: this method opens the sockets and starts the shards, port 0 lets
+   * the kernel choose a port and Port() tells which one it is */
+  ErrorCodeE Listen(String address, UInt port, Accept accept,
+                    Int backlog = 1024);
+
+  /* @NOTE: this method stops the shards and closes the sockets, connections
+   * which have been accepted are kept */
+  ErrorCodeE Stop();
+
+  /* @NOTE: this method shows the port which we are listening */
+  UInt Port();
+
+  /* @NOTE: this method shows how many shards we have */
+  UInt Size();
+
+  /* @NOTE: these methods access the Monitor of a shard and show how many
+   * connections it has accepted */
+  Monitor& At(UInt index);
+  ULong Accepted(UInt index);
+
+ private:
+  struct Shard;
+
+  ErrorCodeE OnAccepting(Shard* shard);
+  void Release();
+
+  Vector<Shard*> _Shards;
+  Accept _Accept;
+  UInt _Port;
+  Bool _Stopping;
+};
+} // namespace Base
+#endif
+#endif // BASE_ACCEPTOR_H_
@@ -0,0 +1,400 @@
+#ifndef BASE_CONCURRENT_HASHTABLE_H_
+#define BASE_CONCURRENT_HASHTABLE_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Atomic.h>
+#include <Base/Epoch.h>
+#include <Base/Exception.h>
+#include <Base/Hash.h>
+#include <Base/Logcat.h>
+#include <Base/Macro.h>
+#include <Base/Type.h>
+#else
+#include <Atomic.h>
+#include <Epoch.h>
+#include <Exception.h>
+#include <Hash.h>
+#include <Logcat.h>
+#include <Macro.h>
+#include <Type.h>
+#endif
+
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/* @NOTE: how many slots a shard starts with, it must be a power of 2 */
+#ifndef CONCURRENT_HASHTABLE_SLOTS
+#define CONCURRENT_HASHTABLE_SLOTS 16
+#endif
+
+/* @NOTE: how many times we spin on a busy shard before yielding the CPU */
+#ifndef CONCURRENT_HASHTABLE_SPINS
+#define CONCURRENT_HASHTABLE_SPINS 64
+#endif
+
+#if __cplusplus
+namespace Base {
+/* @NOTE: HashT is called with a KeyT* like the one of Hashtable */
+template<typename KeyT, typename ValueT, typename IndexT=Int,
+         typename HashT=Hash::Default<KeyT, IndexT>>
+class ConcurrentHashtable {
+ public:
+  /* @NOTE: a ConcurrentHashtable splits its keys to shards by hash, every
+   * shard is a small Robin Hood table guarded by its own sequence number:
+   * - A writer makes the sequence odd with a CAS, modifies the shard and
+   *   makes it even again, so writers of different shards never meet.
+   * - A reader of a trivially copyable key-value doesn't write anything
+   *   shared. It reads the sequence, probes and copies the value, then reads
+   *   the sequence again and retries if a writer came in between. Tables
+   *   which are replaced when a shard grows are retired to Epoch since
+   *   readers might still probe them.
+   * - Other types can't be copied while a writer is changing them, so their
+   *   readers take the shard like writers do.
+   *
+   * - shards == 0: we use 4 shards per online CPU.
+   * ______________________________________________________________________ */
+  explicit ConcurrentHashtable(HashT hashing = HashT{}, UInt shards = 0)
+      : _Hash{hashing}, _Shards{None}, _Bits{1} {
+    if (shards == 0) {
+      Long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+      shards = 4*(online > 0? UInt(online): 1);
+    }
+
+    while ((1u << _Bits) < shards) {
+      _Bits++;
+    }
+
+    _Shards = new Shard[1 << _Bits];
+
+    for (UInt i = 0; i < (1u << _Bits); ++i) {
+      _Shards[i].Sequence = 0;
+
+      if (!(_Shards[i].Current = Build(CONCURRENT_HASHTABLE_SLOTS))) {
+        throw Except(EDrainMem, "can\'t allocate ConcurrentHashtable");
+      }
+    }
+  }
+
+  virtual ~ConcurrentHashtable() {
+    for (UInt i = 0; i < (1u << _Bits); ++i) {
+      Table* table = _Shards[i].Current;
+
+      for (ULong k = 0; k <= table->Mask; ++k) {
+        if (table->Slots[k].Distance >= 0) {
+          table->Slots[k].~Slot();
+        }
+      }
+
+      Release(table);
+    }
+
+    delete[] _Shards;
+  }
+
+  /* @NOTE: put key-value to our ConcurrentHashtable */
+  ErrorCodeE Put(const KeyT& key, const ValueT& value) {
+    IndexT hashing{_Hash((KeyT*)&key)};
+    Shard& shard = Pick(hashing);
+    ErrorCodeE error{ENoError};
+
+    Lock(shard);
+    error = Emplace(shard, key, value, hashing);
+    Unlock(shard);
+
+    return error;
+  }
+
+  /* @NOTE: copy the value of a key to `value`, ENotFound is returned if the
+   * key doesn't exist */
+  ErrorCodeE Get(const KeyT& key, ValueT& value) {
+    IndexT hashing{_Hash((KeyT*)&key)};
+
+    return Read(Pick(hashing), key, value, hashing,
+                std::integral_constant<Bool, Optimistic>{});
+  }
+
+  /* @NOTE: remove a key from our ConcurrentHashtable */
+  ErrorCodeE Del(const KeyT& key) {
+    IndexT hashing{_Hash((KeyT*)&key)};
+    Shard& shard = Pick(hashing);
+    ErrorCodeE error{ENoError};
+
+    Lock(shard);
+    error = Remove(shard, key, hashing);
+    Unlock(shard);
+
+    return error;
+  }
+
+  /* @NOTE: this method shows how many keys we have, it's only a snapshot
+   * when writers are working */
+  ULong Size() {
+    ULong result{0};
+
+    for (UInt i = 0; i < (1u << _Bits); ++i) {
+      Lock(_Shards[i]);
+      result += _Shards[i].Current->Count;
+      Unlock(_Shards[i]);
+    }
+
+    return result;
+  }
+
+  /* @NOTE: this method shows how many shards we have */
+  UInt Shards() { return 1u << _Bits; }
+
+ protected:
+  static constexpr Bool Optimistic =
+      std::is_trivially_copyable<KeyT>::value &&
+      std::is_trivially_copyable<ValueT>::value;
+
+  struct Slot {
+    IndexT Hash, Distance;
+    KeyT Key;
+    ValueT Value;
+  };
+
+  struct Table {
+    ULong Mask, Count;
+    Slot* Slots;
+  };
+
+  /* @NOTE: shards are padded to a cache line so writers of neighbour shards
+   * don't bounce each other's sequences */
+  struct Shard {
+    UInt Sequence;
+    Table* Current;
+    Char _Padding[64 - 2*sizeof(Void*)];
+  };
+
+  static Table* Build(ULong size) {
+    Table* result = new Table{size - 1, 0, None};
+
+    if (!(result->Slots = (Slot*)ABI::Malloc(sizeof(Slot)*size))) {
+      delete result;
+      return None;
+    }
+
+    for (ULong i = 0; i < size; ++i) {
+      result->Slots[i].Distance = -1;
+    }
+
+    return result;
+  }
+
+  static void Release(Void* pointer) {
+    Table* table = (Table*)pointer;
+
+    free(table->Slots);
+    delete table;
+  }
+
+  static void Relax(UInt spins) {
+    if (spins % CONCURRENT_HASHTABLE_SPINS == CONCURRENT_HASHTABLE_SPINS - 1) {
+      sched_yield();
+    } else {
+      RELAX();
+    }
+  }
+
+  /* @NOTE: these methods read a value, types which can't be copied while a
+   * writer is changing them take the shard and the others are read without
+   * writing anything shared */
+  ErrorCodeE Read(Shard& shard, const KeyT& key, ValueT& value,
+                  IndexT hashing, std::false_type) {
+    Long index{-1};
+
+    Lock(shard);
+
+    if ((index = Seek(shard.Current, key, hashing)) >= 0) {
+      value = shard.Current->Slots[index].Value;
+    }
+
+    Unlock(shard);
+    return index < 0? ENotFound: ENoError;
+  }
+
+  ErrorCodeE Read(Shard& shard, const KeyT& key, ValueT& value,
+                  IndexT hashing, std::true_type) {
+    typename std::aligned_storage<sizeof(ValueT), alignof(ValueT)>::type
+        result;
+    Epoch::Guard guard{};
+
+    for (UInt spins = 0; ; ++spins) {
+      UInt sequence = __atomic_load_n(&shard.Sequence, __ATOMIC_ACQUIRE);
+      Table* table{None};
+      Long index{-1};
+
+      if (sequence & 1) {
+        Relax(spins);
+        continue;
+      }
+
+      table = READ_ONCE(shard.Current);
+
+      if ((index = Seek(table, key, hashing)) >= 0) {
+        memcpy(&result, &table->Slots[index].Value, sizeof(ValueT));
+      }
+
+      /* @NOTE: what we have read is only valid if no writer has touched
+       * the shard since we read the sequence */
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+      if (READ_ONCE(shard.Sequence) != sequence) {
+        continue;
+      } else if (index < 0) {
+        return ENotFound;
+      }
+
+      memcpy(&value, &result, sizeof(ValueT));
+      return ENoError;
+    }
+  }
+
+  Shard& Pick(IndexT hashing) {
+    /* @NOTE: tables use the low bits of the hash, so shards are picked by
+     * the high bits of a multiplicative mix to keep both independent */
+    return _Shards[(ULong(hashing)*0x9e3779b97f4a7c15ULL) >> (64 - _Bits)];
+  }
+
+  void Lock(Shard& shard) {
+    for (UInt spins = 0; ; ++spins) {
+      UInt sequence = READ_ONCE(shard.Sequence);
+
+      if (!(sequence & 1) && CMPXCHG(&shard.Sequence, sequence, sequence + 1)) {
+        break;
+      }
+
+      Relax(spins);
+    }
+  }
+
+  void Unlock(Shard& shard) { INC(&shard.Sequence); }
+
+  /* @NOTE: the probe is bounded by the table's size since optimistic readers
+   * might see distances which are being changed */
+  static Long Seek(Table* table, const KeyT& key, IndexT hashing) {
+    ULong mask = table->Mask, index = ULong(hashing) & mask;
+
+    for (IndexT distance = 0; ULong(distance) <= mask; ++distance) {
+      Slot& slot = table->Slots[index];
+
+      if (READ_ONCE(slot.Distance) < distance) {
+        break;
+      } else if (READ_ONCE(slot.Hash) == hashing && slot.Key == key) {
+        return index;
+      }
+
+      index = (index + 1) & mask;
+    }
+
+    return -1;
+  }
+
+  static void Place(Table* table, Slot& incoming) {
+    ULong mask = table->Mask, index = ULong(incoming.Hash) & mask;
+
+    for (incoming.Distance = 0; table->Slots[index].Distance >= 0;
+         index = (index + 1) & mask, incoming.Distance++) {
+      if (table->Slots[index].Distance < incoming.Distance) {
+        std::swap(table->Slots[index], incoming);
+      }
+    }
+
+    new (&table->Slots[index]) Slot(std::move(incoming));
+  }
+
+  ErrorCodeE Emplace(Shard& shard, const KeyT& key, const ValueT& value,
+                     IndexT hashing) {
+    Table* table = shard.Current;
+    Long index{-1};
+
+    if ((index = Seek(table, key, hashing)) >= 0) {
+      table->Slots[index].Value = value;
+      return ENoError;
+    }
+
+    /* @NOTE: grow the shard when it's 7/8 full, readers which are probing
+     * the old table will retry since the sequence is odd now */
+    if (table->Count + 1 > (table->Mask + 1) - (table->Mask + 1)/8) {
+      Table* bigger = Build(2*(table->Mask + 1));
+
+      if (!bigger) {
+        return DrainMem(Format{"grow a shard to {} slots"}
+                            .Apply(2*(table->Mask + 1))).code();
+      }
+
+      for (ULong i = 0; i <= table->Mask; ++i) {
+        if (table->Slots[i].Distance >= 0) {
+          Slot moving{std::move(table->Slots[i])};
+
+          if (!Optimistic) {
+            table->Slots[i].~Slot();
+          }
+
+          Place(bigger, moving);
+        }
+      }
+
+      bigger->Count = table->Count;
+      WRITE_ONCE(shard.Current, bigger);
+
+      if (Optimistic) {
+        Epoch::Retire(table, Release);
+      } else {
+        Release(table);
+      }
+
+      table = bigger;
+    }
+
+    {
+      Slot incoming{hashing, 0, key, value};
+
+      Place(table, incoming);
+    }
+
+    table->Count++;
+    return ENoError;
+  }
+
+  ErrorCodeE Remove(Shard& shard, const KeyT& key, IndexT hashing) {
+    Table* table = shard.Current;
+    ULong mask = table->Mask, next{0};
+    Long index{-1};
+
+    if ((index = Seek(table, key, hashing)) < 0) {
+      return ENotFound;
+    }
+
+    table->Slots[index].~Slot();
+
+    /* @NOTE: backward-shift deletion, see Hashtable::Del */
+    for (next = (index + 1) & mask;
+         table->Slots[next].Distance > 0;
+         index = next, next = (next + 1) & mask) {
+      new (&table->Slots[index]) Slot(std::move(table->Slots[next]));
+
+      table->Slots[next].~Slot();
+      table->Slots[index].Distance--;
+    }
+
+    table->Slots[index].Distance = -1;
+    table->Count--;
+    return ENoError;
+  }
+
+  HashT _Hash;
+  Shard* _Shards;
+  UInt _Bits;
+};
+} // namespace Base
+#endif
+#endif // BASE_CONCURRENT_HASHTABLE_H_
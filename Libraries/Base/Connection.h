@@ -0,0 +1,177 @@
+#ifndef BASE_CONNECTION_H_
+#define BASE_CONNECTION_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Monitor.h>
+#include <Base/Type.h>
+#include <Base/Utils.h>
+#else
+#include <Monitor.h>
+#include <Type.h>
+#include <Utils.h>
+#endif
+
+#if __cplusplus
+namespace Base {
+/* @NOTE: a buffer is a chain of pieces of chunks. Chunks are fixed-size,
+ * refcounted and carved from slabs, a released chunk goes back to a small
+ * pool of the thread which releases it. Copying a Buffer or taking a Slice
+ * only takes references, the bytes are never copied:
+ *
+ *   chunk 0                    chunk 1
+ *   +--------------------+     +--------------------+
+ *   |  consumed | piece 0 | -> | piece 1 |   free   |
+ *   +--------------------+     +--------------------+
+ *
+ * A Buffer isn't thread-safe but its chunks are, so a copy can be given to
+ * another thread and released there */
+class Buffer {
+ public:
+  struct Chunk;
+
+  struct Statistic {
+    /* @NOTE: how many chunks have been carved from slabs, how many times a
+     * chunk is taken from a pool and how many times a new slab is needed */
+    ULong Allocated, Hits, Misses;
+  };
+
+  Buffer();
+  Buffer(const Buffer& src);
+  Buffer(Buffer&& src);
+  ~Buffer();
+
+  Buffer& operator=(const Buffer& src);
+  Buffer& operator=(Buffer&& src);
+
+  /* @NOTE: these methods show how many bytes and pieces we have, a piece is
+   * a contiguous View inside a chunk */
+  ULong Size();
+  UInt Count();
+  View At(UInt index);
+
+  /* @NOTE: this method makes a Buffer which shares `size` bytes starting at
+   * `offset` with us */
+  Buffer Slice(ULong offset, ULong size);
+
+  /* @NOTE: this method drops `size` bytes from the front, chunks which are
+   * no longer used are released */
+  void Consume(ULong size);
+
+  /* @NOTE: these methods copy bytes out, they are for the small parts which
+   * must be contiguous like headers */
+  ULong Copy(Char* output, ULong size, ULong offset = 0);
+  String ToString();
+
+  /* @NOTE: this method finds the first `c`, it returns -1 when not found */
+  Long Find(Char c, ULong offset = 0);
+
+  void Clear();
+
+  /* @NOTE: this method shows statistics of the chunk pools */
+  static Statistic Statistics();
+
+ protected:
+  friend class Connection;
+
+  struct Piece {
+    Chunk* Owner;
+    UInt Begin, End;
+  };
+
+  /* @NOTE: these are used by Connection to fill the buffer, Append takes a
+   * new reference of the chunk */
+  void Append(Chunk* chunk, UInt begin, UInt end);
+
+  static Chunk* Take();
+  static void Ref(Chunk* chunk);
+  static void Unref(Chunk* chunk);
+  static Char* Data(Chunk* chunk);
+  static UInt Capacity();
+
+  Vector<Piece> _Pieces;
+  ULong _Size;
+};
+
+class Connection {
+ public:
+  /* @NOTE: this callback is called when new bytes come, `input` keeps every
+   * byte which hasn't been consumed so a callback consumes what it can parse
+   * and leaves the rest to the next call. It's called once more when the
+   * peer closes the connection and Closed() tells that */
+  using Receive = Function<ErrorCodeE(Connection& connection, Buffer& input)>;
+
+  /* @NOTE: this callback is called when the output queue drops to the low
+   * watermark after it has reached the high watermark, a producer which has
+   * stopped because of Writable() may write again from here */
+  using Resume = Function<void(Connection& connection)>;
+
+  virtual ~Connection();
+
+  /* @NOTE: this function watches a socket on `monitor` and drains it into
+   * chunks whenever it's readable. The socket is switched to non-blocking
+   * mode and the Monitor closes it when the peer closes it. Our callbacks
+   * return what they need to the Monitor, so the socket should be handled by
+   * the HEAD itself like the shards of an Acceptor */
+  static Shared<Connection> Make(Monitor& monitor, Int socket,
+                                 Receive receive);
+
+  /* @NOTE: these methods queue bytes to send. Small writes are copied after
+   * each other into the tail chunk of the queue, so a burst of replies
+   * becomes a single segment, while a Buffer is queued by reference. Inside
+   * our callbacks, the queue is flushed with one vectored write when they
+   * return, otherwise it's flushed right away. When the socket is full, we
+   * wait for EPOLLOUT and stop reading until the queue is sent. These
+   * methods must be called on the thread of the Monitor */
+  ErrorCodeE Write(const Char* data, ULong size);
+  ErrorCodeE Write(Buffer& buffer);
+  ErrorCodeE Flush();
+
+  /* @NOTE: this method sets watermarks of the output queue, Writable() turns
+   * False when the queue reaches `high` and True again when it drops to
+   * `low`, `resume` is called at that moment. We don't read while it's False
+   * so a peer which doesn't read its replies can't make us queue forever */
+  void Watermarks(ULong low, ULong high, Resume resume = None);
+  Bool Writable();
+
+  /* @NOTE: these methods show the socket, if the peer has closed it and how
+   * many bytes we have received, sent and still keep in the output queue.
+   * The socket is -1 when the Monitor has closed it */
+  Int Socket();
+  Bool Closed();
+  ULong Received();
+  ULong Sent();
+  ULong Pending();
+
+ protected:
+  explicit Connection(Monitor& monitor, Int socket, Receive receive);
+
+  /* @NOTE: this method is called by the Monitor whenever the socket is
+   * readable or writable */
+  ErrorCodeE OnEvent();
+
+  /* @NOTE: this method reads until the socket is empty or the output queue
+   * is too long, `drained` tells which one happens */
+  ErrorCodeE OnReading(Bool* drained);
+
+  /* @NOTE: this method checks the watermarks and flushes the queue when we
+   * are outside of our callbacks */
+  ErrorCodeE Queue();
+
+  /* @NOTE: this method makes sure a tail chunk has free space and tells how
+   * much */
+  static UInt Reserve(Buffer::Chunk** tail, UInt* filled);
+
+  Monitor* _Monitor;
+  Receive _Receive;
+  Resume _Resume;
+  Buffer _Input, _Output;
+  Buffer::Chunk *_Tail, *_Outgoing;
+  ULong _Received, _Sent, _Low, _High;
+  UInt _Filled, _Written;
+  Int _Socket;
+  Bool _Closed, _Blocked, _Paused, _Busy;
+};
+} // namespace Base
+#endif
+#endif // BASE_CONNECTION_H_
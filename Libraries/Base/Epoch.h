@@ -0,0 +1,60 @@
+#if !defined(BASE_EPOCH_H_) && __cplusplus
+#define BASE_EPOCH_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Type.h>
+#else
+#include <Type.h>
+#endif
+
+namespace Base {
+class Epoch {
+ public:
+  /* @NOTE: this is how we reclaim memory which is shared among threads:
+   * - A reader marks itself active with the current global epoch before it
+   *   touches any shared node and marks itself inactive when it's done. It
+   *   never retries or waits for anyone.
+   * - A writer which unlinks a node doesn't release it directly, instead it
+   *   retires the node with the epoch recently observed.
+   * - The global epoch only moves forward when every active reader has seen
+   *   it, so a node retired at epoch e can be released safely when the global
+   *   epoch reaches e + 2 since no reader can still see it.
+   *
+   *   epoch:     e            e + 1          e + 2
+   *          ----+--------------+--------------+------>
+   *              |              |              |
+   *           retire        readers of e    release
+   *                         are draining
+   * ______________________________________________________________________ */
+
+  class Guard {
+   public:
+    Guard();
+    ~Guard();
+  };
+
+  /* @NOTE: these methods are used to enter and leave a critical section, they
+   * can be nested and a Guard is the convenient way to use them */
+  static void Enter();
+  static void Leave();
+
+  /* @NOTE: this method is used to retire a pointer, the callback release will
+   * be called when no thread can see this pointer anymore */
+  static void Retire(Void* pointer, void (*release)(Void*));
+
+  /* @NOTE: this method is used to try moving the global epoch forward and
+   * release every retired pointer which is safe to be released recently */
+  static ULong Collect();
+
+  /* @NOTE: this method waits until every reader which might see a pointer
+   * unlinked before this call has left, it can't wait inside a critical
+   * section so EBadLogic will be returned in that case */
+  static ErrorCodeE Synchronize();
+
+  /* @NOTE: this method is used to count how many pointers are still waiting
+   * to be released */
+  static ULong Pending();
+};
+}  // namespace Base
+#endif  // BASE_EPOCH_H_
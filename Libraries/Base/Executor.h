@@ -0,0 +1,135 @@
+#ifndef BASE_EXECUTOR_H_
+#define BASE_EXECUTOR_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Queue.h>
+#include <Base/Thread.h>
+#include <Base/Type.h>
+#else
+#include <Queue.h>
+#include <Thread.h>
+#include <Type.h>
+#endif
+
+#if __cplusplus
+namespace Base {
+namespace Internal {
+/* @NOTE: this is the work-stealing deque of Chase and Lev. Only the owner
+ * pushes and takes at the bottom, so it works as a stack from the owner's
+ * POV and keeps the recently submitted tasks hot in its cache, while
+ * thieves steal the oldest tasks at the top:
+ *
+ *       top (thieves)                      bottom (owner)
+ *            |                                  |
+ *            v                                  v
+ *       +--------+--------+--------+--------+--------+
+ *       | task 0 | task 1 | task 2 | task 3 |        |
+ *       +--------+--------+--------+--------+--------+
+ *
+ * Only the last task is raced by both sides and that race is solved with a
+ * CAS on top. When the array is full, the owner grows it and retires the old
+ * one to Epoch since thieves might still read it.
+ * ______________________________________________________________________ */
+class Deque {
+ public:
+  using Task = Function<void()>;
+
+  explicit Deque(ULong capacity = 256);
+  ~Deque();
+
+  /* @NOTE: these methods can only be called by the owner */
+  void Push(Task* task);
+  Task* Take();
+
+  /* @NOTE: this method can be called by any thread, it returns None when the
+   * deque is empty or we lose the race with another thread */
+  Task* Steal();
+
+  /* @NOTE: this method shows how many tasks are waiting in the deque */
+  ULong Size();
+
+ private:
+  struct Array {
+    ULong Mask;
+    Task** Items;
+  };
+
+  static Array* Build(ULong capacity);
+  static void Release(Void* pointer);
+
+  Long _Top, _Bottom;
+  Array* _Array;
+};
+} // namespace Internal
+
+class Executor {
+ public:
+  using Task = Function<void()>;
+
+  struct Statistic {
+    /* @NOTE: how many tasks are submitted by this worker, executed by this
+     * worker, stolen from another workers or picked from the shared queue */
+    ULong Submitted, Executed, Stolen, Injected;
+
+    /* @NOTE: how many tasks throw exceptions and how many times this worker
+     * parks because there is nothing to do */
+    ULong Failed, Parked;
+  };
+
+  /* @NOTE: an executor runs tasks on a fixed set of workers, each worker owns
+   * a deque and every task which is submitted by a worker goes to the
+   * worker's deque. Tasks which are submitted by another threads go to a
+   * shared Queue. An idle worker picks tasks from its own deque first, then
+   * from the shared Queue and finally steals from randomized victims before
+   * it parks. Workers are Base::Thread so they are still watched by
+   * WatchStopper, a task which is blocked by a Base::Lock is seen as the
+   * worker is blocked and the deadlock solver works as usual.
+   *
+   * - workers == 0: we spawn one worker per online CPU.
+   * ______________________________________________________________________ */
+  explicit Executor(UInt workers = 0);
+  virtual ~Executor();
+
+  /* @NOTE: this method is used to submit a new task, it fails with
+   * EBadLogic when the executor is stopping */
+  ErrorCodeE Submit(Task task);
+
+  /* @NOTE: this method is used to wait until every submitted task is done, a
+   * negative timeout means forever and EDoAgain is returned when the
+   * timeout happens */
+  ErrorCodeE Wait(Double timeout = -1.0);
+
+  /* @NOTE: this method shows statistics of a worker */
+  Statistic Statistics(UInt worker);
+
+  /* @NOTE: this method shows which workers have been running their current
+   * tasks longer than threshold seconds, they might be stuck */
+  Vector<UInt> Stucks(Double threshold);
+
+  /* @NOTE: this method shows how many workers we have */
+  UInt Size();
+
+  /* @NOTE: this method shows how many tasks are submitted but not done */
+  ULong Pending();
+
+ private:
+  struct Worker;
+
+  void Run(Worker* worker);
+  Task* Find(Worker* worker);
+  void Signal();
+
+  Vector<Worker*> _Workers;
+  Queue<Task*> _Shared;
+
+  /* @NOTE: _Signal is bumped whenever a new task is submitted and _Idle is
+   * bumped whenever the executor has nothing to do, they are the words which
+   * workers and waiters park on */
+  UInt _Signal, _Sleepers, _Idle, _Waiters;
+  ULong _Pending;
+  Bool _Running;
+};
+} // namespace Base
+#endif
+#endif // BASE_EXECUTOR_H_
@@ -0,0 +1,88 @@
+#ifndef BASE_HASH_H_
+#define BASE_HASH_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Type.h>
+#include <Base/Utils.h>
+#else
+#include <Type.h>
+#include <Utils.h>
+#endif
+
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus
+namespace Base {
+namespace Hash {
+/* @NOTE: a 64-bit hash of a byte string in the style of wyhash, it reads 8
+ * bytes at a time and folds them with 64x64->128 bit multiplications so it
+ * runs at several GB/s and every input bit affects every output bit. It's
+ * made for hashtables, not for anything which must resist attackers */
+ULong Digest(const Void* data, ULong size, ULong seed = 0);
+
+/* @NOTE: CRC32C (Castagnoli) of a byte string, the previous result can be
+ * passed as crc to continue a checksum. It uses the crc32 instruction of
+ * SSE4.2 when cpuid says the CPU has it and a table otherwise */
+UInt CRC32C(const Void* data, ULong size, UInt crc = 0);
+
+/* @NOTE: this function shows if CRC32C is done by the CPU */
+Bool Accelerated();
+
+/* @NOTE: a bijective mixer for integers, the finalizer of SplitMix64. Keys
+ * which only differ in a few bits are spread everywhere, so the low bits
+ * can be used directly as an index of a power of 2 table */
+inline ULong Mix(ULong value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+
+  return value;
+}
+
+/* @NOTE: the built-in hashes of the usual keys, a View of a String has the
+ * same hash as the String */
+inline ULong Of(const View& view) { return Digest(view.Data, view.Size); }
+
+inline ULong Of(const String& value) {
+  return Digest(value.c_str(), value.size());
+}
+
+template<typename Type>
+inline typename std::enable_if<std::is_integral<Type>::value ||
+                               std::is_enum<Type>::value, ULong>::type
+Of(Type value) {
+  return Mix(ULong(value));
+}
+
+/* @NOTE: Default is the hasher of Hashtable when nothing else is given, it
+ * has no state and uses the built-in hashes above so every call is inlined.
+ * A key without a built-in hash doesn't compile, Custom must be used then */
+template<typename KeyT, typename IndexT=Int>
+struct Default {
+  IndexT operator()(KeyT* key) { return IndexT(Of(*key)); }
+  IndexT operator()(const View& view) { return IndexT(Of(view)); }
+};
+
+/* @NOTE: Custom wraps a user's function, any callable of `IndexT(KeyT*)` is
+ * accepted so a lambda or an old hashing function can still be used. The
+ * function only knows KeyT so looking a View up doesn't compile */
+template<typename KeyT, typename IndexT=Int>
+class Custom {
+ public:
+  template<typename FunctionT,
+           typename = decltype(std::declval<FunctionT&>()((KeyT*)None))>
+  Custom(FunctionT custom): _Custom{custom} {}
+
+  IndexT operator()(KeyT* key) { return _Custom(key); }
+
+ private:
+  Function<IndexT(KeyT*)> _Custom;
+};
+} // namespace Hash
+} // namespace Base
+#endif
+#endif // BASE_HASH_H_
@@ -4,12 +4,16 @@
 
 #if USE_BASE_WITH_FULL_PATH_HEADER
 #include <Base/Exception.h>
+#include <Base/Hash.h>
 #include <Base/Logcat.h>
+#include <Base/Thread.h>
 #include <Base/Type.h>
 #include <Base/Utils.h>
 #else
 #include <Exception.h>
+#include <Hash.h>
 #include <Logcat.h>
+#include <Thread.h>
 #include <Type.h>
 #include <Utils.h>
 #endif
@@ -17,87 +21,211 @@
 /* @NOTE: this header will be used to calculate log */
 #include <math.h>
 
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* @NOTE: how many buckets of the previous mapping are moved on every Put or
+ * Get while the chained mode is migrating */
+#ifndef HASHTABLE_MIGRATION
+#define HASHTABLE_MIGRATION 16
+#endif
+
 namespace Base {
-template<typename KeyT, typename ValueT, typename IndexT=Int>
-class Hashtable {
- protected:
-  /* @NOTH: this tricky way will help to build a manual Hashtable with specific
-   * memory addresses */
-  Hashtable(){}
+namespace Internal {
+namespace Swiss {
+/* @NOTE: every slot of the Swiss mode has a control byte, an empty slot is
+ * EEmpty, a removed slot is EDeleted and an occupied slot keeps 7 bits of
+ * its hash so most of the keys which don't match are rejected without
+ * touching their slots */
+enum ControlE { EEmpty = -128, EDeleted = -2 };
+
+/* @NOTE: how many control bytes are probed at once */
+constexpr UInt Width = 16;
+
+/* @NOTE: a group loads Width control bytes and returns bitmasks where bit i
+ * says the i-th byte matches. SSE2 compares a whole group with 1 instruction,
+ * the fallback does the same on 2 words with the usual bit tricks */
+class Group {
+ public:
+  explicit Group(const Byte* controls) {
+#if __SSE2__
+    _Controls = _mm_loadu_si128((const __m128i*)controls);
+#else
+    memcpy(_Controls, controls, sizeof(_Controls));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    _Controls[0] = __builtin_bswap64(_Controls[0]);
+    _Controls[1] = __builtin_bswap64(_Controls[1]);
+#endif
+#endif
+  }
+
+  /* @NOTE: bytes which are equal to fragment, the fallback may report a
+   * few false positives but the caller always compares full hashes */
+  UInt Match(Byte fragment) {
+#if __SSE2__
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(fragment),
+                                            _Controls));
+#else
+    ULong pattern = 0x0101010101010101ULL*UInt(uint8_t(fragment));
+    ULong low = _Controls[0] ^ pattern, high = _Controls[1] ^ pattern;
+
+    return Pack((low - 0x0101010101010101ULL) & ~low,
+                (high - 0x0101010101010101ULL) & ~high);
+#endif
+  }
+
+  /* @NOTE: bytes which are EEmpty, a probe stops at a group having one */
+  UInt MatchEmpty() {
+#if __SSE2__
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(EEmpty),
+                                            _Controls));
+#else
+    return Pack(_Controls[0] & ~(_Controls[0] << 6),
+                _Controls[1] & ~(_Controls[1] << 6));
+#endif
+  }
+
+  /* @NOTE: bytes which are EEmpty or EDeleted, both have the sign bit */
+  UInt MatchFree() {
+#if __SSE2__
+    return _mm_movemask_epi8(_Controls);
+#else
+    return Pack(_Controls[0], _Controls[1]);
+#endif
+  }
 
+ private:
+#if __SSE2__
+  __m128i _Controls;
+#else
+  /* @NOTE: gather the sign bits of 16 bytes to a 16-bit mask like what
+   * _mm_movemask_epi8 does */
+  static UInt Pack(ULong low, ULong high) {
+    low = (low >> 7) & 0x0101010101010101ULL;
+    high = (high >> 7) & 0x0101010101010101ULL;
+
+    return UInt((low*0x0102040810204080ULL) >> 56) |
+           (UInt((high*0x0102040810204080ULL) >> 56) << 8);
+  }
+
+  ULong _Controls[2];
+#endif
+};
+} // namespace Swiss
+} // namespace Internal
+
+/* @NOTE: HashT is called with a KeyT* and, if Find is called with a View,
+ * with a const View&. A struct with inline operator() lets the compiler
+ * inline the hash which Function<> can't do. Hash::Default hashes Strings
+ * and integers by itself, Hash::Custom wraps a user's function */
+template<typename KeyT, typename ValueT, typename IndexT=Int,
+         typename HashT=Hash::Default<KeyT, IndexT>>
+class Hashtable {
  public:
+  /* @NOTE: storage engines of Hashtable, True is still accepted as the
+   * open-addressing mode for the old flag `use_bintree` */
+  enum StyleE { EChained = 0, ERobinHood = 1, ESwiss = 2 };
+
+  /* @NOTE: this mapping is used by the chained mode, entries which collide
+   * are chained through Indexes inside the same arrays, -1 means the slot is
+   * empty and Size means the end of a chain. Roots keep the full hash of each
+   * entry and Levels mark entries which have been moved to the next mapping
+   * during a migration. Free is where we continue looking for an empty slot
+   * when a chain must be extended */
   struct MappingV1 {
     Int KType, VType;
     UInt Size;
     Void *Keys, *Values;
     Bool *Levels;
     IndexT *Roots, *Indexes;
+    IndexT Free;
   };
 
+  /* @NOTE: this mapping is used by the open-addressing mode, every entry
+   * lives in its home slot or after it and Distances keep how far each entry
+   * is from its home, -1 means the slot is empty. Distances are kept apart
+   * from Slots so a probe scans many of them on a single cache line and only
+   * touches a slot when its distance says the key may be there */
   struct MappingV2 {
     Int KType, VType;
     UInt Size;
-    Void *Keys, *Values;
-    Bool *Levels;
-    IndexT *Roots, *Left, *Right;
+    Void *Slots;
+    IndexT *Distances;
   };
 
-  explicit Hashtable(Function<IndexT(KeyT*)> hashing, Bool use_bintree = False):
-      _Hash{hashing}, _Style{use_bintree}, _Bitwise{True}, _Count{0} {
-    memset(&_Map, 0, sizeof(_Map));
+  /* @NOTE: this mapping is used by the Swiss mode, Controls has Size bytes
+   * plus a copy of its first Width bytes at the end so a group can be
+   * loaded at any slot without wrapping around. Deleted counts EDeleted
+   * bytes since they make probes longer until the next rehash */
+  struct MappingV3 {
+    Int KType, VType;
+    UInt Size, Deleted;
+    Void *Slots;
+    Byte *Controls;
+  };
 
-    if (_Style) {
-      _Map.v2.Left = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v2.Right = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v2.Roots = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v2.Levels = (Bool*) ABI::Malloc(sizeof(Bool)*2);
-      _Map.v2.Size = 2;
-    } else {
-      _Map.v1.Levels = (Bool*) ABI::Malloc(sizeof(Bool)*2);
-      _Map.v1.Roots = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v1.Indexes = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v1.Size = 2;
-    }
-    Clear();
-  }
+  /* @NOTE: a slot of the open-addressing and Swiss modes, the full hash is kept so we
+   * can skip comparing keys and rehash without calling _Hash again */
+  struct Slot {
+    IndexT Hash;
+    KeyT Key;
+    ValueT Value;
+  };
 
-  explicit Hashtable(IndexT(*hashing)(KeyT*), Bool use_bintree = False):
-      _Hash{hashing}, _Style{use_bintree}, _Bitwise{True}, _Count{0} {
+  explicit Hashtable(HashT hashing = HashT{}, UInt style = EChained):
+      _Hash{hashing}, _Style{style}, _Bitwise{True}, _Count{0},
+      _Limit{0.875}, _Previous{}, _Cursor{0} {
     memset(&_Map, 0, sizeof(_Map));
 
-    if (_Style) {
-      _Map.v2.Left = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v2.Right = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v2.Roots = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v2.Levels = (Bool*) ABI::Malloc(sizeof(Bool)*2);
-      _Map.v2.Size = 2;
+    if (_Style == ERobinHood) {
+      if (Allocate(2)) {
+        throw Except(EDrainMem, "can\'t allocate Hashtable");
+      }
+    } else if (_Style == ESwiss) {
+      if (Build(Internal::Swiss::Width)) {
+        throw Except(EDrainMem, "can\'t allocate Hashtable");
+      }
     } else {
-      _Map.v1.Levels = (Bool*) ABI::Malloc(sizeof(Bool)*2);
-      _Map.v1.Roots = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v1.Indexes = (IndexT*) ABI::Malloc(sizeof(IndexT)*2);
-      _Map.v1.Size = 2;
+      if (Prepare(_Map.v1, 2)) {
+        throw Except(EDrainMem, "can\'t allocate Hashtable");
+      }
     }
     Clear();
   }
 
-  explicit Hashtable(UInt size, IndexT(*hashing)(KeyT*), Bool use_bintree = False):
-      _Hash{hashing}, _Style{use_bintree}, _Count{0} {
+  explicit Hashtable(UInt size, HashT hashing, UInt style = EChained):
+      _Hash{hashing}, _Style{style}, _Count{0}, _Limit{0.875},
+      _Previous{}, _Cursor{0} {
     auto n = log(size)/log(2);
 
     _Bitwise = (n == UInt(n));
     memset(&_Map, 0, sizeof(_Map));
 
-    if (_Style) {
-      _Map.v2.Left = (IndexT*) ABI::Malloc(sizeof(IndexT)*size);
-      _Map.v2.Right = (IndexT*) ABI::Malloc(sizeof(IndexT)*size);
-      _Map.v2.Roots = (IndexT*) ABI::Malloc(sizeof(IndexT)*size);
-      _Map.v2.Levels = (Bool*) ABI::Malloc(sizeof(Bool)*size);
-      _Map.v2.Size = size;
+    if (_Style == ERobinHood || _Style == ESwiss) {
+      UInt capacity = _Style == ESwiss? Internal::Swiss::Width: 2;
+
+      /* @NOTE: the open-addressing modes always use a power of 2 size and
+       * they must keep `size` items without crossing the load factor */
+      while (capacity*_Limit < size) {
+        capacity <<= 1;
+      }
+
+      if (_Style == ESwiss? Build(capacity): Allocate(capacity)) {
+        throw Except(EDrainMem, "can\'t allocate Hashtable");
+      }
+
+      _Bitwise = True;
     } else {
-      _Map.v1.Levels = (Bool*) ABI::Malloc(sizeof(Bool)*size);
-      _Map.v1.Roots = (IndexT*) ABI::Malloc(sizeof(IndexT)*size);
-      _Map.v1.Indexes = (IndexT*) ABI::Malloc(sizeof(IndexT)*size);
-      _Map.v1.Size = size;
+      if (Prepare(_Map.v1, size)) {
+        throw Except(EDrainMem, "can\'t allocate Hashtable");
+      }
     }
     Clear();
   }
@@ -106,71 +234,46 @@ class Hashtable {
 
   /* @NOTE: put key-value to our Hashtable */
   ErrorCodeE Put(KeyT&& key, ValueT&& value) {
-    KeyT* keys = (KeyT*)(_Style? _Map.v2.Keys: _Map.v1.Keys);
-    Bool* levels = _Style? _Map.v2.Levels: _Map.v1.Levels;
-    IndexT* roots = _Style? _Map.v2.Roots: _Map.v1.Roots;
-    UInt size = _Style? _Map.v2.Size: _Map.v1.Size;
-    IndexT hashing = _Hash(&key);
-    UInt index = Mod(hashing);
-
-    /* @NOTE: check if we need migration or not */
-    if (_Count >= size) {
-      if (levels) {
-        auto error = Migrate();
-
-        if (error) {
-          return error;
-        } else {
-          return Put(RValue(key), RValue(value));
-        }
-      } else {
-        return OutOfRange.code();
-      }
+    if (_Style == ERobinHood) {
+      return Emplace(RValue(key), RValue(value));
+    } else if (_Style == ESwiss) {
+      return Store(RValue(key), RValue(value));
     }
 
-    /* @NOTE: analyze table and pick the approviated index */
-    if (_Style) {
-      return NoSupport("still on developing").code();
-    } else {
-      IndexT* indexes = _Map.v1.Indexes;
-
-      if (IndexAt(indexes, index) >= 0) {
-        IndexT next;
+    IndexT hashing = _Hash(&key);
+    Long index{-1};
 
-        if (KeyAt(keys, index) == key) {
-          goto insert_keyval;
-        }
+    /* @NOTE: move a few buckets on every Put, the previous mapping is empty
+     * long before the current one is full since it's twice as large */
+    if (_Previous.Size) {
+      Step(HASHTABLE_MIGRATION);
+    }
 
-        /* @NOTE: maybe we will found the key if we keep checking indexes */
-        for (; index < size; index = indexes[index]) {
-          if (KeyAt(keys, index) == key) {
-            goto insert_keyval;
-          }
-        }
+    /* @NOTE: the key might stay on any mapping during a migration */
+    if ((index = Lookup(_Map.v1, key, hashing)) >= 0) {
+      ValueAt((ValueT*)_Map.v1.Values, index) = RValue(value);
+      return ENoError;
+    } else if (_Previous.Size &&
+               (index = Lookup(_Previous, key, hashing)) >= 0) {
+      ValueAt((ValueT*)_Previous.Values, index) = RValue(value);
+      return ENoError;
+    }
 
-        /* @NOTE: not found the key, going to find a new slot to insert this
-         * key-value */
-        if ((next = FindEmpty(index)) < 0) {
-          return OutOfRange.code();
-        }
+    /* @NOTE: check if we need migration or not */
+    if (_Count >= _Map.v1.Size) {
+      auto error = Expand();
 
-        /* @NOTE: make the current index to point to the end of Hashtable */
-        IndexAt(indexes, index) = next;
-        IndexAt(indexes, next) = size;
-        index = next;
+      if (error) {
+        return error;
       }
     }
 
-    /* @NOTE: save level and root values of each item to use on migrating
-     * pharse */
-    LevelAt(levels, index) = Bool(1 & (hashing / size));
-    RootAt(roots, index) = hashing%size;
+    if (Insert(_Map.v1, key, value, hashing)) {
+      return OutOfRange.code();
+    }
 
     /* @NOTE: increase couter */
     _Count++;
-
-insert_keyval:
-    Insert(key, value, index);
     return ENoError;
   }
 
@@ -225,36 +328,32 @@ insert_keyval:
     }
 
     /* @NOTE: select value base on key value */
-    if (_Style) {
-      return (NoSupport << "Hashtable with binary tree is still on developing");
+    if (_Style == ESwiss) {
+      size = _Map.v3.Size;
+      keys = (KeyT*)_Map.v3.Slots;
+      values = (ValueT*)_Map.v3.Slots;
+    } else if (_Style == ERobinHood) {
+      size = _Map.v2.Size;
+      keys = (KeyT*)_Map.v2.Slots;
+      values = (ValueT*)_Map.v2.Slots;
     } else {
-      IndexT* indexes = _Map.v1.Indexes;
       size = _Map.v1.Size;
       keys = (KeyT*)_Map.v1.Keys;
       values = (ValueT*)_Map.v1.Values;
+    }
 
-      if (size == 0) {
-        error = DoNothing << "Hashtable is empty recently";
-      } else if (!keys) {
-        error = BadLogic << "Hastable::Keys is empty recently";
-      } else if (!values) {
-        error = BadLogic << "Hastable::Values is empty recently";
-      } else {
-        for (UInt index = Mod(hashing);
-             index <= size;
-             index = IndexAt(indexes, index)) {
-          if (KeyAt(keys, index) != key) {
-            continue;
-          }
-
-          pointer = (Void*)(&ValueAt(values, index));
-          break;
-        }
-      }
+    if (size == 0) {
+      error = DoNothing << "Hashtable is empty recently";
+    } else if (!keys) {
+      error = BadLogic << "Hastable::Keys is empty recently";
+    } else if (!values) {
+      error = BadLogic << "Hastable::Values is empty recently";
+    } else {
+      pointer = (Void*)Locate(key, hashing);
     }
 
     /* @NOTE: verify the exception */
-    if (!pointer && select) {
+    if (!pointer) {
       if (error){
         return error;
       } else {
@@ -290,151 +389,511 @@ insert_keyval:
     return error;
   }
 
-  /* @NOTE: clear everything with this method */
-  virtual void Clear(Bool all = False) {
-    if (_Style) {
-      if (all) {
-        if (_Map.v2.Left) free(_Map.v2.Left);
-        if (_Map.v2.Right) free(_Map.v2.Right);
-        if (_Map.v2.Levels) free(_Map.v2.Levels);
-        if (_Map.v2.Roots) free(_Map.v2.Roots);
-      } else {
-        if (_Map.v2.Levels) {
-          memset(_Map.v2.Levels, 0, _Map.v2.Size*sizeof(Bool));
-        }
-        if (_Map.v2.Roots) {
-          memset(_Map.v2.Roots, -1, _Map.v2.Size*sizeof(IndexT));
-        }
-        if (_Map.v2.Left) {
-          memset(_Map.v2.Left, -1, _Map.v2.Size*sizeof(IndexT));
-        }
-        if (_Map.v2.Right) {
-          memset(_Map.v2.Right, -1, _Map.v2.Size*sizeof(IndexT));
-        }
+  /* @NOTE: find the value of an existing key without building any Error, it
+   * returns None if the key doesn't exist. The pointer is valid until the next
+   * call since a migration might move the entry */
+  ValueT* Find(const KeyT& key) {
+    return Locate(key, _Hash((KeyT*)&key));
+  }
+
+  /* @NOTE: find the value of a key by its content without building a KeyT,
+   * KeyT must have data() and size() like String does and HashT must give
+   * a View the same hash as the key which has the same content */
+  ValueT* Find(const View& view) { return Locate(view, _Hash(view)); }
+
+  /* @NOTE: remove a key from Hashtable, only the open-addressing and Swiss
+   * modes support it recently */
+  ErrorCodeE Del(const KeyT& key) {
+    Slot* slots = (Slot*)_Map.v2.Slots;
+    IndexT* distances = _Map.v2.Distances;
+    Long index{-1};
+    UInt mask{0};
+
+    if (_Style == ESwiss) {
+      return Erase(key);
+    } else if (_Style != ERobinHood) {
+      return NoSupport("still on developing").code();
+    } else if ((index = Seek(key, _Hash((KeyT*)&key))) < 0) {
+      return ENotFound;
+    }
+
+    mask = _Map.v2.Size - 1;
+    slots[index].~Slot();
+
+    /* @NOTE: shift the following entries back until we meet an empty slot or
+     * an entry which is already at home, so we don't need tombstones and
+     * lookups stay as short as they were before the key was put */
+
+    for (UInt next = (index + 1) & mask;
+         distances[next] > 0;
+         index = next, next = (next + 1) & mask) {
+      new (&slots[index]) Slot(std::move(slots[next]));
+
+      slots[next].~Slot();
+      distances[index] = distances[next] - 1;
+    }
+
+    distances[index] = -1;
+    _Count--;
+    return ENoError;
+  }
+
+  /* @NOTE: configure the maximum load factor of the open-addressing mode,
+   * Hashtable grows when a Put is going to cross it */
+  ErrorCodeE LoadFactor(Double factor) {
+    if (factor <= 0.0 || factor > 1.0) {
+      return BadLogic("load factor must be in (0, 1]").code();
+    }
+
+    _Limit = factor;
+    return ENoError;
+  }
+
+  /* @NOTE: this method shows how many keys we have */
+  ULong Size() { return _Count; }
+
+  /* @NOTE: make room for `size` keys at once, so Put doesn't grow the table
+   * again until it holds more than that */
+  ErrorCodeE Reserve(ULong size) {
+    if (_Style == ERobinHood || _Style == ESwiss) {
+      UInt current = _Style == ESwiss? _Map.v3.Size: _Map.v2.Size;
+      UInt capacity = current;
+
+      /* @NOTE: Swiss must keep an empty slot, see Store */
+      while (capacity*_Limit < size ||
+             (_Style == ESwiss && capacity <= size)) {
+        capacity <<= 1;
+      }
+
+      if (capacity == current) {
+        return ENoError;
       }
 
-      if (_Map.v2.Keys) free(_Map.v2.Keys);
-      if (_Map.v2.Values) free(_Map.v2.Values);
+      return _Style == ESwiss? Regroup(capacity): Rehash(capacity);
+    } else if (size > _Map.v1.Size) {
+      MappingV1 next{};
+      ErrorCodeE error{ENoError};
+      UInt capacity = size;
 
-      if (!all) {
-        _Map.v2.Keys = ABI::Malloc(sizeof(KeyT)*_Map.v2.Size);
-        _Map.v2.Values = ABI::Malloc(sizeof(ValueT)*_Map.v2.Size);
+      if (_Bitwise) {
+        for (capacity = _Map.v1.Size; capacity < size; capacity <<= 1) {}
       }
-    } else {
-      if (all) {
-        if (_Map.v1.Indexes) free(_Map.v1.Indexes);
-        if (_Map.v1.Levels) free(_Map.v1.Levels);
-        if (_Map.v1.Roots) free(_Map.v1.Roots);
-      } else{
-        if (_Map.v1.Indexes) {
-          memset(_Map.v1.Indexes, -1, _Map.v1.Size*sizeof(IndexT));
-        }
-        if (_Map.v1.Levels) {
-          memset(_Map.v1.Levels, 0, _Map.v1.Size*sizeof(Bool));
+
+      if (_Previous.Size) {
+        Step(_Previous.Size);
+      }
+
+      if ((error = Prepare(next, capacity))) {
+        return error;
+      }
+
+      _Previous = _Map.v1;
+      _Map.v1 = next;
+      _Cursor = 0;
+
+      Step(_Previous.Size);
+    }
+
+    return ENoError;
+  }
+
+  /* @NOTE: put every key-value of a range of std::pair or Base::Pair at
+   * once. An empty open-addressing or Swiss table is sized once, then the
+   * entries are hashed, sorted by their home slots and written in that
+   * order, so the slots are filled from the start to the end like a stream
+   * instead of randomly. With threads > 1 the home slots are split to
+   * `threads` ranges by hash prefix, every thread hashes, sorts and writes
+   * its own range and the few entries which would cross into the next
+   * range are put at the end. Like Put, the last value of a key wins.
+   * Other cases, including ranges without random access, fall back to
+   * Reserve and Put */
+  template<typename IteratorT>
+  ErrorCodeE BuildFrom(IteratorT begin, IteratorT end, UInt threads = 1) {
+    using Category = typename std::iterator_traits<IteratorT>::iterator_category;
+
+    ULong size = std::distance(begin, end);
+    ErrorCodeE error{ENoError};
+
+    if ((error = Reserve(_Count + size))) {
+      return error;
+    } else if (_Count > 0 || _Style == EChained ||
+               !std::is_same<Category, std::random_access_iterator_tag>::value) {
+      for (auto it = begin; it != end; ++it) {
+        KeyT key{Left(*it)};
+        ValueT value{Right(*it)};
+
+        if ((error = Put(RValue(key), RValue(value)))) {
+          return error;
         }
-        if (_Map.v1.Roots) {
-          memset(_Map.v1.Roots, 0, _Map.v1.Size*sizeof(IndexT));
+      }
+
+      return ENoError;
+    }
+
+    return Bulk(begin, size, threads < 1? 1: threads, Category{});
+  }
+
+  /* @NOTE: clear everything with this method */
+  virtual void Clear(Bool all = False) {
+    if (_Style == ESwiss) {
+      Slot* slots = (Slot*)_Map.v3.Slots;
+
+      for (UInt i = 0; _Map.v3.Controls && i < _Map.v3.Size; ++i) {
+        if (_Map.v3.Controls[i] >= 0) {
+          slots[i].~Slot();
         }
       }
 
-      if (_Map.v1.Keys) free(_Map.v1.Keys);
-      if (_Map.v1.Values) free(_Map.v1.Values);
+      if (all) {
+        if (_Map.v3.Slots) free(_Map.v3.Slots);
+        if (_Map.v3.Controls) free(_Map.v3.Controls);
+      } else if (_Map.v3.Controls) {
+        memset(_Map.v3.Controls, Internal::Swiss::EEmpty,
+               _Map.v3.Size + Internal::Swiss::Width);
+        _Map.v3.Deleted = 0;
+      }
+    } else if (_Style == ERobinHood) {
+      Slot* slots = (Slot*)_Map.v2.Slots;
 
-      if (!all) {
-        _Map.v1.Keys = ABI::Malloc(sizeof(KeyT)*_Map.v1.Size);
-        _Map.v1.Values = ABI::Malloc(sizeof(ValueT)*_Map.v1.Size);
+      for (UInt i = 0; _Map.v2.Distances && i < _Map.v2.Size; ++i) {
+        if (_Map.v2.Distances[i] >= 0) {
+          slots[i].~Slot();
+        }
+      }
+
+      if (all) {
+        if (_Map.v2.Slots) free(_Map.v2.Slots);
+        if (_Map.v2.Distances) free(_Map.v2.Distances);
+      } else if (_Map.v2.Distances) {
+        memset(_Map.v2.Distances, -1, _Map.v2.Size*sizeof(IndexT));
       }
+    } else {
+      Release(_Previous, True);
+      Release(_Map.v1, all);
     }
 
     if (all) memset(&_Map, 0, sizeof(_Map));
+    _Count = 0;
   }
 
  protected:
-  virtual KeyT& KeyAt(KeyT* array, UInt index) { return array[index]; }
+  /* @NOTE: this helper implements Find of every mode, the hash is computed
+   * once by the caller and LookupT is either KeyT or View */
+  template<typename LookupT>
+  ValueT* Locate(const LookupT& key, IndexT hashing) {
+    if (_Style == ERobinHood) {
+      Long index = Seek(key, hashing);
+
+      return index < 0? None: &((Slot*)_Map.v2.Slots)[index].Value;
+    } else if (_Style == ESwiss) {
+      Long index = Probe(key, hashing);
+
+      return index < 0? None: &((Slot*)_Map.v3.Slots)[index].Value;
+    } else if (_Map.v1.Keys && _Map.v1.Values) {
+      Long index{-1};
+
+      if (_Previous.Size) {
+        Step(HASHTABLE_MIGRATION);
+      }
 
-  virtual ValueT& ValueAt(ValueT* array, UInt index) { return array[index]; }
+      if ((index = Lookup(_Map.v1, key, hashing)) >= 0) {
+        return &ValueAt((ValueT*)_Map.v1.Values, index);
+      } else if (_Previous.Size &&
+                 (index = Lookup(_Previous, key, hashing)) >= 0) {
+        return &ValueAt((ValueT*)_Previous.Values, index);
+      }
+    }
 
-  virtual IndexT& IndexAt(IndexT* array, UInt index) { return array[index]; }
+    return None;
+  }
 
-  virtual IndexT& RootAt(IndexT* array, UInt index) { return array[index]; }
+  template<typename LeftT, typename RightT>
+  static const LeftT& Left(const std::pair<LeftT, RightT>& pair) {
+    return pair.first;
+  }
 
-  virtual Bool& LevelAt(Bool* array, UInt index) { return array[index]; }
+  template<typename LeftT, typename RightT>
+  static const RightT& Right(const std::pair<LeftT, RightT>& pair) {
+    return pair.second;
+  }
 
-  virtual IndexT& LeftAt(IndexT* array, UInt index) { return array[index]; }
+  template<typename LeftT, typename RightT>
+  static const LeftT& Left(const Pair<LeftT, RightT>& pair) {
+    return pair.Left;
+  }
 
-  virtual IndexT& RightAt(IndexT* array, UInt index) { return array[index]; }
+  template<typename LeftT, typename RightT>
+  static const RightT& Right(const Pair<LeftT, RightT>& pair) {
+    return pair.Right;
+  }
 
-  virtual ErrorCodeE Expand() {
-    UInt size = _Style? _Map.v2.Size: _Map.v1.Size;
-    Bool* levels = _Style? _Map.v2.Levels: _Map.v1.Levels;
-    IndexT* roots = _Style? _Map.v2.Roots: _Map.v1.Roots;
-    KeyT* keys = (KeyT*)(_Style? _Map.v2.Keys: _Map.v1.Keys);
-    ValueT* values = (ValueT*)(_Style? _Map.v2.Values: _Map.v1.Values);
-    ErrorCodeE error = ENoError;
-
-    /* @NOTE: realocate variable keys */
-    if (!(keys = (KeyT*)ABI::Realloc(keys, 2*size*sizeof(KeyT)))) {
-      error = DrainMem(Format{"ABI::Realloc() keys with {}"
-                              "bytes"}.Apply(2*size*sizeof(KeyT))).code();
-    } else if (_Style) {
-      _Map.v2.Keys = keys;
+  /* @NOTE: the slot where a probe of the open-addressing or Swiss mode
+   * starts */
+  UInt Home(IndexT hashing) {
+    if (_Style == ESwiss) {
+      return UInt(Spread(hashing) >> 32) & (_Map.v3.Size - 1);
     } else {
-      _Map.v1.Keys = keys;
+      return UInt(hashing) & (_Map.v2.Size - 1);
     }
+  }
+
+  template<typename IteratorT, typename CategoryT>
+  ErrorCodeE Bulk(IteratorT UNUSED(begin), ULong UNUSED(size),
+                  UInt UNUSED(threads), CategoryT) {
+    return BadLogic("BuildFrom needs a random access range").code();
+  }
+
+  /* @NOTE: this helper implements BuildFrom on an empty table which has been
+   * reserved already. Entries are sorted as `home << 32 | index` words so
+   * the sort moves 8 bytes per entry whatever KeyT and ValueT are, and only
+   * their hashes are saved since the range can be read by index */
+  template<typename IteratorT>
+  ErrorCodeE Bulk(IteratorT begin, ULong size, UInt threads,
+                  std::random_access_iterator_tag) {
+    UInt slots = _Style == ESwiss? _Map.v3.Size: _Map.v2.Size;
+    Vector<IndexT> hashes(size);
+    Vector<ULong> orders(size), sorted(size), bounds(threads + 1, 0);
+    Vector<Vector<ULong>> deferred(threads);
+    Vector<ULong> placed(threads, 0);
+    Vector<Base::Thread*> workers{};
+
+    if (threads > slots/Internal::Swiss::Width) {
+      threads = slots/Internal::Swiss::Width;
+      threads = threads < 1? 1: threads;
+    }
+
+    /* @NOTE: hash every entry */
+    Run(threads, workers, [&](UInt thread) {
+      for (ULong i = size*thread/threads; i < size*(thread + 1)/threads; ++i) {
+        hashes[i] = _Hash((KeyT*)&Left(begin[i]));
+        orders[i] = (ULong(Home(hashes[i])) << 32) | i;
+      }
+    });
+
+    /* @NOTE: split the entries to parts by the prefix of their homes, every
+     * part is a range of slots which is written by a single thread */
+    if (threads > 1) {
+      Vector<ULong> offsets(threads, 0);
+
+      for (auto order : orders) {
+        bounds[(order >> 32)*threads/slots + 1]++;
+      }
 
-    /* @NOTE: realocate variable values */
-    if (error || !(values = (ValueT*)ABI::Realloc(values, 2*size*sizeof(ValueT)))) {
-      if (!error) {
-        error = DrainMem(Format{"ABI::Realloc() values with {} "
-                                "bytes"}.Apply(2*size*sizeof(ValueT))).code();
+      for (UInt part = 0; part < threads; ++part) {
+        bounds[part + 1] += bounds[part];
+        offsets[part] = bounds[part];
       }
-    } else if (_Style) {
-      _Map.v2.Values = values;
+
+      for (auto order : orders) {
+        sorted[offsets[(order >> 32)*threads/slots]++] = order;
+      }
+
+      std::swap(orders, sorted);
     } else {
-      _Map.v1.Values = values;
+      bounds[1] = size;
     }
 
-    /* @NOTE: realocate variable levels */
-    if (error || !(levels = (Bool*)ABI::Realloc(levels, 2*size*sizeof(Bool)))) {
-      if (!error) {
-        error = DrainMem(Format{"ABI::Realloc() levels with {} "
-                                "bytes"}.Apply(2*size*sizeof(Bool))).code();
+    Run(threads, workers, [&](UInt thread) {
+      ULong first = bounds[thread], last = bounds[thread + 1];
+      UInt end = ULong(thread + 1)*slots/threads;
+
+      Sort(&orders[first], &sorted[first], last - first, slots);
+
+      for (ULong i = first; i < last; ++i) {
+        ULong index = orders[i] & 0xffffffff;
+        UInt home = orders[i] >> 32;
+        Bool replaced{False};
+
+        /* @NOTE: the range is read randomly, so fetch the next few entries
+         * while we are writing this one */
+        if (i + 8 < last) {
+          __builtin_prefetch(&hashes[orders[i + 8] & 0xffffffff]);
+          __builtin_prefetch(&begin[orders[i + 8] & 0xffffffff]);
+        }
+
+        /* @NOTE: the sort is stable so a key which is put again later comes
+         * after this one with the same home */
+        for (ULong k = i + 1; k < last && (orders[k] >> 32) == home; ++k) {
+          ULong other = orders[k] & 0xffffffff;
+
+          if (hashes[other] == hashes[index] &&
+              Same(Left(begin[other]), Left(begin[index]))) {
+            replaced = True;
+            break;
+          }
+        }
+
+        if (replaced) {
+          continue;
+        } else if (Write(hashes[index], Left(begin[index]),
+                         Right(begin[index]), home, end)) {
+          placed[thread]++;
+        } else {
+          deferred[thread].push_back(orders[i] & 0xffffffff);
+        }
       }
-    } else if (_Style) {
-      _Map.v2.Levels = levels;
-    } else {
-      _Map.v1.Levels = levels;
+    });
+
+    for (auto count : placed) {
+      _Count += count;
     }
 
-    /* @NOTE: realocate variable roots */
-    if (error || !(roots = (IndexT*)ABI::Realloc(roots, 2*size*sizeof(IndexT)))) {
-      if (!error) {
-        error = DrainMem(Format{"ABI::Realloc() roots with {} "
-                                "bytes"}.Apply(2*size*sizeof(IndexT))).code();
+    for (auto& list : deferred) {
+      for (auto i : list) {
+        KeyT key{Left(begin[i])};
+        ValueT value{Right(begin[i])};
+        ErrorCodeE error{_Style == ESwiss? Store(RValue(key), RValue(value)):
+                                           Emplace(RValue(key), RValue(value))};
+
+        if (error) {
+          return error;
+        }
       }
-    } else if (_Style) {
-      _Map.v2.Roots = roots;
-    } else {
-      _Map.v1.Roots = roots;
     }
 
-    if (_Style) {
-      return ENoSupport;
-    } else {
-      IndexT* indexes = _Map.v1.Indexes;
+    return ENoError;
+  }
+
+  /* @NOTE: a stable LSD radix sort of `home << 32 | index` words by their
+   * homes, 11 bits per pass keep the counters inside L1 */
+  static void Sort(ULong* items, ULong* buffer, ULong size, UInt slots) {
+    UInt bits{0};
+
+    while ((1ul << bits) < slots) {
+      bits++;
+    }
+
+    for (UInt shift = 0; shift < bits; shift += 11) {
+      ULong counters[1 << 11] = {0};
+
+      for (ULong i = 0; i < size; ++i) {
+        counters[(items[i] >> (32 + shift)) & 0x7ff]++;
+      }
+
+      for (ULong i = 0, sum = 0; i < (1 << 11); ++i) {
+        ULong count = counters[i];
+
+        counters[i] = sum;
+        sum += count;
+      }
 
-      /* @NOTE: realocate variable indexes */
-      if (error || !(indexes = (IndexT*)ABI::Realloc(indexes, 2*size*sizeof(IndexT)))) {
-        if (!error) {
-          error = DrainMem(Format{"ABI::Realloc() indexes with {} "
-                                  "bytes"}.Apply(2*size*sizeof(IndexT))).code();
+      for (ULong i = 0; i < size; ++i) {
+        buffer[counters[(items[i] >> (32 + shift)) & 0x7ff]++] = items[i];
+      }
+
+      std::swap(items, buffer);
+    }
+
+    /* @NOTE: an odd number of passes leaves the result in the buffer */
+    if (((bits + 10)/11) % 2) {
+      memcpy(buffer, items, size*sizeof(ULong));
+    }
+  }
+
+  /* @NOTE: run a job on `threads` threads, the caller works as the first
+   * one */
+  static void Run(UInt threads, Vector<Base::Thread*>& workers,
+                  Function<void(UInt)> job) {
+    for (UInt thread = 1; thread < threads; ++thread) {
+      workers.push_back(new Base::Thread{});
+      workers.back()->Start([job, thread]() { job(thread); });
+    }
+
+    job(0);
+
+    /* @NOTE: deleting a Thread joins it */
+    for (auto worker : workers) {
+      delete worker;
+    }
+
+    workers.clear();
+  }
+
+  /* @NOTE: write an entry of a sorted part without probing, False is
+   * returned if its slot would cross `end` so it must be put later:
+   * - Robin Hood: entries come in the order of their homes so the first
+   *   empty slot after the home never displaces anyone.
+   * - Swiss: the first free slot of the home's group is where Store would
+   *   put it, the group must stay inside the part. */
+  Bool Write(IndexT hashing, const KeyT& key, const ValueT& value, UInt home,
+             UInt end) {
+    if (_Style == ESwiss) {
+      Slot* slots = (Slot*)_Map.v3.Slots;
+
+      if (home + Internal::Swiss::Width > end) {
+        return False;
+      }
+
+      for (UInt i = home; i < home + Internal::Swiss::Width; ++i) {
+        if (_Map.v3.Controls[i] < 0) {
+          new (&slots[i]) Slot{hashing, key, value};
+          Mark(i, Fragment(Spread(hashing)));
+          return True;
         }
-      } else {
-        memset(&indexes[size], -1, size*sizeof(IndexT));
-        _Map.v1.Indexes = indexes;
       }
+
+      return False;
+    } else {
+      Slot* slots = (Slot*)_Map.v2.Slots;
+      IndexT* distances = _Map.v2.Distances;
+
+      for (UInt i = home; i < end; ++i) {
+        if (distances[i] < 0) {
+          new (&slots[i]) Slot{hashing, key, value};
+          distances[i] = i - home;
+          return True;
+        }
+      }
+
+      return False;
     }
+  }
 
+  /* @NOTE: compare a saved key with what we are looking for, the full hashes
+   * are already equal when these are called */
+  static Bool Same(const KeyT& key, const KeyT& other) { return key == other; }
+
+  static Bool Same(const KeyT& key, const View& view) {
+    return key.size() == view.Size && !memcmp(key.data(), view.Data, view.Size);
+  }
+
+  virtual KeyT& KeyAt(KeyT* array, UInt index) { return array[index]; }
+
+  virtual ValueT& ValueAt(ValueT* array, UInt index) { return array[index]; }
+
+  virtual IndexT& IndexAt(IndexT* array, UInt index) { return array[index]; }
+
+  virtual IndexT& RootAt(IndexT* array, UInt index) { return array[index]; }
+
+  virtual Bool& LevelAt(Bool* array, UInt index) { return array[index]; }
+
+  virtual ErrorCodeE Expand() {
+    /* @NOTE: the open-addressing modes can't grow in place since every
+     * entry must be placed again with the new mask */
+    if (_Style == ERobinHood) {
+      return Rehash(2*_Map.v2.Size);
+    } else if (_Style == ESwiss) {
+      return Regroup(2*_Map.v3.Size);
+    }
+
+    MappingV1 next{};
+    ErrorCodeE error{ENoError};
+
+    /* @NOTE: finish the previous migration first, it rarely happens since
+     * every Put moves a few buckets */
+    if (_Previous.Size) {
+      Step(_Previous.Size);
+    }
+
+    if ((error = Prepare(next, 2*_Map.v1.Size))) {
+      return error;
+    }
+
+    /* @NOTE: the current mapping becomes the previous one, its entries are
+     * moved to the new mapping step by step by Put and Get */
+    _Previous = _Map.v1;
+    _Map.v1 = next;
+    _Cursor = 0;
     return ENoError;
   }
 
@@ -442,14 +901,18 @@ insert_keyval:
   template<typename ResultT>
   ResultT* At(UInt index) {
     if (typeid(ResultT) == typeid(ValueT)) {
-      if (_Style) {
-        return (ResultT*)(&ValueAt((ValueT*)_Map.v2.Values, index));
+      if (_Style == ESwiss) {
+        return (ResultT*)(&((Slot*)_Map.v3.Slots)[index].Value);
+      } else if (_Style) {
+        return (ResultT*)(&((Slot*)_Map.v2.Slots)[index].Value);
       } else {
         return (ResultT*)(&ValueAt((ValueT*)_Map.v1.Values, index));
       }
     } else if (typeid(ResultT) != typeid(KeyT)) {
-      if (_Style) {
-        return (ResultT*)(&KeyAt((KeyT*)_Map.v2.Keys, index));
+      if (_Style == ESwiss) {
+        return (ResultT*)(&((Slot*)_Map.v3.Slots)[index].Key);
+      } else if (_Style) {
+        return (ResultT*)(&((Slot*)_Map.v2.Slots)[index].Key);
       } else {
         return (ResultT*)(&KeyAt((KeyT*)_Map.v1.Keys, index));
       }
@@ -472,244 +935,512 @@ insert_keyval:
     }
   }
 
-  /* @NOTE: this helper will support to insert a key-value to slot index-th */
-  Bool Insert(KeyT& key, ValueT& value, UInt index){
+  /* @NOTE: this helper allocates the arrays of a chained mapping */
+  ErrorCodeE Prepare(MappingV1& mapping, UInt size) {
+    KeyT* keys = (KeyT*)ABI::Malloc(sizeof(KeyT)*size);
+    ValueT* values = (ValueT*)ABI::Malloc(sizeof(ValueT)*size);
+    Bool* levels = (Bool*)ABI::Malloc(sizeof(Bool)*size);
+    IndexT* roots = (IndexT*)ABI::Malloc(sizeof(IndexT)*size);
+    IndexT* indexes = (IndexT*)ABI::Malloc(sizeof(IndexT)*size);
+
+    if (!keys || !values || !levels || !roots || !indexes) {
+      if (keys) free(keys);
+      if (values) free(values);
+      if (levels) free(levels);
+      if (roots) free(roots);
+      if (indexes) free(indexes);
+
+      return DrainMem(Format{"ABI::Malloc() {} slots"}.Apply(size)).code();
+    }
 
-    if (_Style) {
-      if (LeftAt(_Map.v2.Left, index) >= 0 ||
-          RightAt(_Map.v2.Right, index) >= 0) {
-        return False;
-      }
+    memset(levels, 0, size*sizeof(Bool));
+    memset(indexes, -1, size*sizeof(IndexT));
 
-      KeyAt((KeyT*)_Map.v2.Keys, index) = key;
-      ValueAt((ValueT*)_Map.v2.Values, index) = value;
-    } else {
-      if (IndexAt(_Map.v1.Indexes, index) >= 0) {
-        return False;
+    mapping.Keys = keys;
+    mapping.Values = values;
+    mapping.Levels = levels;
+    mapping.Roots = roots;
+    mapping.Indexes = indexes;
+    mapping.Size = size;
+    mapping.Free = size;
+    return ENoError;
+  }
+
+  /* @NOTE: this helper destroys every entry of a chained mapping, the arrays
+   * are freed too if `all` is set */
+  void Release(MappingV1& mapping, Bool all) {
+    for (UInt i = 0; mapping.Indexes && i < mapping.Size; ++i) {
+      if (IndexAt(mapping.Indexes, i) >= 0 && !LevelAt(mapping.Levels, i)) {
+        KeyAt((KeyT*)mapping.Keys, i).~KeyT();
+        ValueAt((ValueT*)mapping.Values, i).~ValueT();
       }
+    }
 
-      KeyAt((KeyT*)_Map.v1.Keys, index) = key;
-      ValueAt((ValueT*)_Map.v1.Values, index) = value;
+    if (all) {
+      if (mapping.Keys) free(mapping.Keys);
+      if (mapping.Values) free(mapping.Values);
+      if (mapping.Levels) free(mapping.Levels);
+      if (mapping.Roots) free(mapping.Roots);
+      if (mapping.Indexes) free(mapping.Indexes);
+
+      memset(&mapping, 0, sizeof(mapping));
+    } else if (mapping.Indexes) {
+      memset(mapping.Levels, 0, mapping.Size*sizeof(Bool));
+      memset(mapping.Indexes, -1, mapping.Size*sizeof(IndexT));
+      mapping.Free = mapping.Size;
+    }
+  }
+
+  /* @NOTE: this helper finds the slot of a key in a chained mapping, -1 is
+   * returned if the key doesn't exist */
+  template<typename LookupT>
+  Long Lookup(MappingV1& mapping, const LookupT& key, IndexT hashing) {
+    KeyT* keys = (KeyT*)mapping.Keys;
+    IndexT* indexes = mapping.Indexes;
+    UInt index = Mod(hashing, mapping.Size);
+
+    if (IndexAt(indexes, index) < 0) {
+      return -1;
+    }
+
+    /* @NOTE: chains may be merged, so we check the full hash before
+     * comparing keys and skip entries which have been moved */
+    for (; index < mapping.Size; index = IndexAt(indexes, index)) {
+      if (RootAt(mapping.Roots, index) == hashing &&
+          !LevelAt(mapping.Levels, index) && Same(KeyAt(keys, index), key)) {
+        return index;
+      }
     }
 
-    return True;
+    return -1;
   }
 
-  /* @NOTE: this helper will support how to move a key-value from place
-   *  to place */
-  Bool Move(UInt from, UInt to) {
-    if (_Style) {
-      if (!Insert(KeyAt((KeyT*)_Map.v2.Keys, from),
-                  ValueAt((ValueT*)_Map.v2.Values, from),
-                  to)) {
-        return False;
+  /* @NOTE: this helper moves a new key-value to a chained mapping, the key
+   * must not exist there */
+  ErrorCodeE Insert(MappingV1& mapping, KeyT& key, ValueT& value,
+                    IndexT hashing) {
+    IndexT* indexes = mapping.Indexes;
+    UInt index = Mod(hashing, mapping.Size);
+
+    if (IndexAt(indexes, index) >= 0) {
+      IndexT next = FindEmpty(mapping);
+
+      if (next < 0) {
+        return EOutOfRange;
       }
 
-      LeftAt(_Map.v2.Left, from) = -1;
-      RightAt(_Map.v2.Right, from) = -1;
-    } else {
-      if (!Insert(KeyAt((KeyT*)_Map.v1.Keys, from),
-                  ValueAt((ValueT*)_Map.v1.Values, from),
-                  to)) {
-        return False;
+      /* @NOTE: append the new slot to the end of the chain */
+      while (IndexAt(indexes, index) < IndexT(mapping.Size)) {
+        index = IndexAt(indexes, index);
       }
 
-      IndexAt(_Map.v1.Indexes, from) = -1;
+      IndexAt(indexes, index) = next;
+      index = next;
     }
 
-    return True;
+    new (&KeyAt((KeyT*)mapping.Keys, index)) KeyT(std::move(key));
+    new (&ValueAt((ValueT*)mapping.Values, index)) ValueT(std::move(value));
+
+    IndexAt(indexes, index) = mapping.Size;
+    RootAt(mapping.Roots, index) = hashing;
+    LevelAt(mapping.Levels, index) = False;
+    return ENoError;
   }
 
-  /* @NOTE: this helper will support how to deprecate a slot */
-  ErrorCodeE Deprecate(Int index, Int size){
-    if (_Style) {
-      LeftAt(_Map.v2.Left, index) = -1;
-      RightAt(_Map.v2.Right, index) = -1;
-    } else {
-      auto root = RootAt(_Map.v1.Roots, index);
-      auto indexes = _Map.v1.Indexes;
-
-      if (index == root) {
-        /* @NOTE: root was going to be migrated so we will select the next
-         *  candidate here */
-
-        for (auto next = IndexAt(indexes, index);
-             IndexAt(indexes, next) < size;
-             ++next) {
-          if (RootAt(_Map.v1.Roots, index) == root) {
-            /* @NOTE: found the candidate move it now */
-
-            if (!Move(next, index)) {
-              return BadLogic("broken link").code();
-            }
-            break;
-          }
-        }
-      } else if (IndexAt(indexes, index) == size) {
-        /* @NOTE: this node is on the end of a flow so we will update index
-         *  of the previous node to the end of table */
+  /* @NOTE: this helper moves a few buckets of the previous mapping to the
+   * current one, the previous mapping is released when it becomes empty */
+  void Step(ULong buckets) {
+    KeyT* keys = (KeyT*)_Previous.Keys;
+    ValueT* values = (ValueT*)_Previous.Values;
+    ULong end = _Cursor + buckets;
 
-        IndexAt(indexes, GoToEnd(index, size, 1)) = _Map.v1.Size;
-      } else {
-        /* @NOTE: this node is stacked inside 2 node of a flow so we will
-         *  update index of the previous node to point to the next*/
+    for (; _Cursor < end && _Cursor < _Previous.Size; ++_Cursor) {
+      if (IndexAt(_Previous.Indexes, _Cursor) < 0) {
+        continue;
+      }
 
-        IndexAt(indexes, GoToEnd(index, size, 1)) = IndexAt(indexes, index);
+      /* @NOTE: the link is kept since other chains might go through this
+       * slot, Levels tells lookups to skip it */
+      if (Insert(_Map.v1, KeyAt(keys, _Cursor), ValueAt(values, _Cursor),
+                 RootAt(_Previous.Roots, _Cursor))) {
+        Bug(EBadLogic, "the current mapping is full while migrating");
       }
 
-      /* @NOTE: remove the old link since we have done everything */
-      IndexAt(_Map.v1.Indexes, index) = -1;
+      KeyAt(keys, _Cursor).~KeyT();
+      ValueAt(values, _Cursor).~ValueT();
+      LevelAt(_Previous.Levels, _Cursor) = True;
     }
 
-    return ENoError;
+    if (_Cursor >= _Previous.Size) {
+      Release(_Previous, True);
+      _Cursor = 0;
+    }
   }
 
   /* @NOTE: Hashtable has reached its limitation and we must expand itself and
-   * migrate data to a larger content */
+   * migrate data to a larger content, unlike Put this method doesn't return
+   * until every entry is moved */
   ErrorCodeE Migrate() {
-    ErrorCodeE error = Expand();
-    UInt size = _Style? _Map.v2.Size: _Map.v1.Size;
-    Bool* levels = _Style? _Map.v2.Levels: _Map.v1.Levels;
-    IndexT* roots = _Style? _Map.v2.Roots: _Map.v1.Roots;
-    KeyT* keys = (KeyT*)(_Style? _Map.v2.Keys: _Map.v1.Keys);
-    ValueT* values = (ValueT*)(_Style? _Map.v2.Values: _Map.v1.Values);
+    ErrorCodeE error{ENoError};
 
-    if (error) {
+    if (_Style == ERobinHood) {
+      return Rehash(2*_Map.v2.Size);
+    } else if (_Style == ESwiss) {
+      return Regroup(2*_Map.v3.Size);
+    } else if ((error = Expand())) {
       return error;
     }
 
-    /* @NOTE: initialize value to expanded memory */
-    memset(&LevelAt(levels, size), 0, size*sizeof(Bool));
-    memset(&RootAt(roots, size), 0, size*sizeof(IndexT));
+    Step(_Previous.Size);
+    return ENoError;
+  }
 
-    /* @NOTE: update the mapping table back to _Map */
-    if (_Style) {
-      _Map.v2.Levels = levels;
-      _Map.v2.Roots = roots;
-      _Map.v2.Keys = keys;
-      _Map.v2.Values = values;
-    } else {
-      _Map.v1.Levels = levels;
-      _Map.v1.Roots = roots;
-      _Map.v1.Keys = keys;
-      _Map.v1.Values = values;
+  /* @NOTE: this helper allocates the arrays of the open-addressing mode,
+   * size must be a power of 2 */
+  ErrorCodeE Allocate(UInt size) {
+    Slot* slots = (Slot*)ABI::Malloc(sizeof(Slot)*size);
+    IndexT* distances = (IndexT*)ABI::Malloc(sizeof(IndexT)*size);
+
+    if (!slots || !distances) {
+      if (slots) free(slots);
+      if (distances) free(distances);
+
+      return DrainMem(Format{"ABI::Malloc() {} slots"}.Apply(size)).code();
     }
 
+    memset(distances, -1, size*sizeof(IndexT));
+
+    _Map.v2.Slots = slots;
+    _Map.v2.Distances = distances;
+    _Map.v2.Size = size;
+    return ENoError;
+  }
+
+  /* @NOTE: this helper finds the slot of a key in the open-addressing mode,
+   * entries on a probe sequence are sorted by their distances so we can stop
+   * as soon as we meet an entry which is closer to its home than the key
+   * would be, -1 is returned in that case */
+  template<typename LookupT>
+  Long Seek(const LookupT& key, IndexT hashing) {
+    Slot* slots = (Slot*)_Map.v2.Slots;
+    IndexT* distances = _Map.v2.Distances;
+    UInt mask = _Map.v2.Size - 1;
+    UInt index = hashing & mask;
+
+    for (IndexT distance = 0; distances[index] >= distance; ++distance) {
+      if (slots[index].Hash == hashing && Same(slots[index].Key, key)) {
+        return index;
+      }
+
+      index = (index + 1) & mask;
+    }
+
+    return -1;
+  }
+
+  /* @NOTE: this helper puts a new entry to the open-addressing mode with
+   * Robin Hood hashing, an entry which is closer to its home than the
+   * incoming one gives its slot away and continues probing on behalf of it.
+   * This keeps the variance of distances low so both hits and misses finish
+   * after a few slots even when the table is nearly full */
+  void Place(Slot& incoming, UInt index, IndexT distance) {
+    Slot* slots = (Slot*)_Map.v2.Slots;
+    IndexT* distances = _Map.v2.Distances;
+    UInt mask = _Map.v2.Size - 1;
+
+    for (; distances[index] >= 0; index = (index + 1) & mask, ++distance) {
+      if (distances[index] < distance) {
+        std::swap(slots[index], incoming);
+        std::swap(distances[index], distance);
+      }
+    }
+
+    new (&slots[index]) Slot(std::move(incoming));
+    distances[index] = distance;
+  }
+
+  /* @NOTE: this helper implements Put of the open-addressing mode */
+  ErrorCodeE Emplace(KeyT&& key, ValueT&& value) {
+    IndexT hashing{_Hash(&key)}, distance{0};
+    UInt index{0}, mask{0};
+    Slot* slots{None};
+
+    if (_Count + 1 > _Limit*_Map.v2.Size) {
+      auto error = Rehash(2*_Map.v2.Size);
+
+      if (error) {
+        return error;
+      }
+    }
+
+    slots = (Slot*)_Map.v2.Slots;
+    mask = _Map.v2.Size - 1;
+    index = hashing & mask;
+
+    /* @NOTE: the key might exist already, it can only stay before the first
+     * entry which is closer to its home than the key would be */
+    for (; _Map.v2.Distances[index] >= distance; ++distance) {
+      if (slots[index].Hash == hashing && slots[index].Key == key) {
+        slots[index].Value = RValue(value);
+        return ENoError;
+      }
+
+      index = (index + 1) & mask;
+    }
+
+    /* @NOTE: Place swaps entries with its parameter so the caller's
+     * variables must not be passed to it directly */
+    {
+      Slot incoming{hashing, RValue(key), RValue(value)};
+
+      Place(incoming, index, distance);
+    }
+
+    _Count++;
+    return ENoError;
+  }
+
+  /* @NOTE: this helper moves every entry of the open-addressing mode to a
+   * new set of arrays, the saved hashes are reused so _Hash isn't called */
+  ErrorCodeE Rehash(UInt size) {
+    MappingV2 old = _Map.v2;
+    Slot* slots = (Slot*)old.Slots;
+    ErrorCodeE error = Allocate(size);
+
     if (error) {
+      _Map.v2 = old;
       return error;
-    } else if (_Style) {
-      return ENoSupport;
-    } else {
-      /* @NOTE: update the size first */
-      _Map.v1.Size = 2*size;
-
-      /* @NOTE: this for-loop will be used to migrate odd levels to new
-       *  places */
-      for (UInt i = 0; i < size; ++i) {
-        if (LevelAt(levels, i)) {
-          Int index = size + RootAt(roots, i);
-
-          if (!Insert(KeyAt(keys, i), ValueAt(values, i), index)) {
-            /* @NOTE: find the empty slot since the best place has been
-             *  occupied */
-
-            if ((index = FindEmpty(index)) < 0) {
-              return BadLogic("migrate can\'t find any place to update").code();
-            }
-
-            if (!Insert(KeyAt(keys, i), ValueAt(values, i), index)) {
-              return BadLogic("migrate can\'t perform function Insert()").code();
-            }
-          }
-
-          if (!Deprecate(i, size)) {
-            return BadLogic("fail to do Deprecate()").code();
-          }
+    }
 
-          /* @NOTE: recaculate root and levels */
-          RootAt(roots, index) = RootAt(roots, i) + size;
-          LevelAt(levels, index) = True;
-        }
+    for (UInt i = 0; i < old.Size; ++i) {
+      if (old.Distances[i] < 0) {
+        continue;
       }
+
+      Place(slots[i], slots[i].Hash & (size - 1), 0);
+      slots[i].~Slot();
     }
 
-    return error;
+    free(old.Slots);
+    free(old.Distances);
+    return ENoError;
   }
 
-  /* @NOTE: this helper will support to find the end of a flow */
-  Int GoToEnd(UInt index, Int size, UInt saveback = 0) {
-    UInt saver[saveback + 1], pos{0};
-    Bool rot{False};
+  /* @NOTE: this helper allocates the arrays of the Swiss mode, size must be
+   * a power of 2 and not smaller than a group */
+  ErrorCodeE Build(UInt size) {
+    using namespace Internal::Swiss;
 
-    if (_Style) {
-    } else {
-      auto indexes = _Map.v1.Indexes;
+    Slot* slots = (Slot*)ABI::Malloc(sizeof(Slot)*size);
+    Byte* controls = (Byte*)ABI::Malloc(size + Width);
 
-      for (auto i = IndexAt(indexes, index);
-           IndexAt(indexes, i) < size;
-           i = IndexAt(indexes, i)) {
-        saver[pos] = i;
+    if (!slots || !controls) {
+      if (slots) free(slots);
+      if (controls) free(controls);
 
-        /* @NOTE: pos will increase until it reach its limitation and rotate
-         *  back */
-        if (pos < saveback){
-          pos++;
-        } else {
-          rot = True;
-          pos = 0;
+      return DrainMem(Format{"ABI::Malloc() {} slots"}.Apply(size)).code();
+    }
+
+    memset(controls, EEmpty, size + Width);
+
+    _Map.v3.Slots = slots;
+    _Map.v3.Controls = controls;
+    _Map.v3.Size = size;
+    _Map.v3.Deleted = 0;
+    return ENoError;
+  }
+
+  /* @NOTE: the hash is mixed before it's split since users usually give us
+   * weak hashes like the identity, the high 7 bits become the control byte
+   * and the next bits choose where the probe starts */
+  static ULong Spread(IndexT hashing) {
+    return ULong(UInt(hashing))*0x9e3779b97f4a7c15ULL;
+  }
+
+  static Byte Fragment(ULong spread) { return Byte(spread >> 57); }
+
+  /* @NOTE: change the control byte of a slot and its copy at the end */
+  void Mark(UInt index, Byte control) {
+    using namespace Internal::Swiss;
+
+    _Map.v3.Controls[index] = control;
+
+    if (index < Width) {
+      _Map.v3.Controls[_Map.v3.Size + index] = control;
+    }
+  }
+
+  /* @NOTE: this helper finds the slot of a key in the Swiss mode. Groups are
+   * visited with triangular steps which cover every group of a power of 2
+   * table, and a group having an empty byte ends the probe since Store
+   * would have used it. Most misses finish at the first group after 1 or
+   * 2 cache-line loads of Controls without touching any slot */
+  template<typename LookupT>
+  Long Probe(const LookupT& key, IndexT hashing) {
+    using namespace Internal::Swiss;
+
+    Slot* slots = (Slot*)_Map.v3.Slots;
+    ULong spread = Spread(hashing);
+    UInt mask = _Map.v3.Size - 1;
+    UInt index = UInt(spread >> 32) & mask;
+    Byte fragment = Fragment(spread);
+
+    for (UInt step = 0; step <= mask; step += Width) {
+      Group group{&_Map.v3.Controls[index]};
+
+      for (UInt bits = group.Match(fragment); bits; bits &= bits - 1) {
+        UInt slot = (index + __builtin_ctz(bits)) & mask;
+
+        if (slots[slot].Hash == hashing && Same(slots[slot].Key, key)) {
+          return slot;
         }
       }
 
-      if (rot) {
-        return saver[pos == saveback? saveback: pos + 1];
+      if (group.MatchEmpty()) {
+        break;
       }
+
+      index = (index + step + Width) & mask;
     }
 
     return -1;
   }
 
-  IndexT FindEmpty(IndexT index){
-    if (_Style) {
-    } else {
-      auto indexes = _Map.v1.Indexes;
-
-      for (auto left = index, right = index; ; left--, right++) {
-        if (left >= 0) {
-          if (IndexAt(indexes, left) < 0) {
-            IndexAt(indexes, index) = left;
-            index = left;
-            return left;
-            break;
-          }
-        }
+  /* @NOTE: this helper finds the first free slot on the probe sequence of
+   * a hash, it always exists since Store keeps the load factor below 1 */
+  UInt Vacancy(IndexT hashing) {
+    using namespace Internal::Swiss;
 
-        if (right < IndexT(_Map.v1.Size)) {
-          if (IndexAt(indexes, right) < 0) {
-            return right;
-            break;
-          }
-        } else {
-          break;
-        }
+    ULong spread = Spread(hashing);
+    UInt mask = _Map.v3.Size - 1;
+    UInt index = UInt(spread >> 32) & mask;
+
+    for (UInt step = 0; ; step += Width) {
+      UInt bits = Group{&_Map.v3.Controls[index]}.MatchFree();
+
+      if (bits) {
+        return (index + __builtin_ctz(bits)) & mask;
       }
+
+      index = (index + step + Width) & mask;
     }
-    return -1;
   }
 
-  IndexT Mod(IndexT hashing) {
-    UInt size = _Style? _Map.v2.Size: _Map.v1.Size;
+  /* @NOTE: this helper implements Put of the Swiss mode */
+  ErrorCodeE Store(KeyT&& key, ValueT&& value) {
+    IndexT hashing{_Hash(&key)};
+    Slot* slots = (Slot*)_Map.v3.Slots;
+    Long index = Probe(key, hashing);
+    UInt size{_Map.v3.Size}, slot{0};
+
+    if (index >= 0) {
+      slots[index].Value = RValue(value);
+      return ENoError;
+    }
+
+    /* @NOTE: deleted bytes count as used slots since they don't stop probes,
+     * when they are the reason we are full the table is cleaned up at the
+     * same size instead of growing */
+    if (_Count + _Map.v3.Deleted + 1 > _Limit*size ||
+        _Count + _Map.v3.Deleted + 1 >= size) {
+      auto error = Regroup(2*(_Count + 1) > _Limit*size? 2*size: size);
+
+      if (error) {
+        return error;
+      }
+
+      slots = (Slot*)_Map.v3.Slots;
+    }
+
+    slot = Vacancy(hashing);
+
+    if (_Map.v3.Controls[slot] == Internal::Swiss::EDeleted) {
+      _Map.v3.Deleted--;
+    }
+
+    new (&slots[slot]) Slot{hashing, RValue(key), RValue(value)};
+    Mark(slot, Fragment(Spread(hashing)));
+
+    _Count++;
+    return ENoError;
+  }
+
+  /* @NOTE: this helper implements Del of the Swiss mode, the slot becomes
+   * EDeleted so probes which passed through it still go on */
+  ErrorCodeE Erase(const KeyT& key) {
+    Long index = Probe(key, _Hash((KeyT*)&key));
 
+    if (index < 0) {
+      return ENotFound;
+    }
+
+    ((Slot*)_Map.v3.Slots)[index].~Slot();
+    Mark(index, Internal::Swiss::EDeleted);
+
+    _Map.v3.Deleted++;
+    _Count--;
+    return ENoError;
+  }
+
+  /* @NOTE: this helper moves every entry of the Swiss mode to new arrays,
+   * deleted bytes are dropped on the way */
+  ErrorCodeE Regroup(UInt size) {
+    MappingV3 old = _Map.v3;
+    Slot* slots = (Slot*)old.Slots;
+    ErrorCodeE error = Build(size);
+
+    if (error) {
+      _Map.v3 = old;
+      return error;
+    }
+
+    for (UInt i = 0; i < old.Size; ++i) {
+      if (old.Controls[i] >= 0) {
+        UInt slot = Vacancy(slots[i].Hash);
+
+        new (&((Slot*)_Map.v3.Slots)[slot]) Slot(std::move(slots[i]));
+        Mark(slot, old.Controls[i]);
+        slots[i].~Slot();
+      }
+    }
+
+    free(old.Slots);
+    free(old.Controls);
+    return ENoError;
+  }
+
+  /* @NOTE: this helper finds an empty slot to extend a chain, slots are
+   * never freed in the chained mode so Free only goes down and the total cost
+   * of the searches is bounded by the size of the mapping */
+  IndexT FindEmpty(MappingV1& mapping) {
+    while (mapping.Free > 0) {
+      if (IndexAt(mapping.Indexes, --mapping.Free) < 0) {
+        return mapping.Free;
+      }
+    }
+
+    return -1;
+  }
+
+  IndexT Mod(IndexT hashing, UInt size) {
     if (_Bitwise) {
       return hashing & (size - 1);
     } else {
-      return hashing % size;
+      return UInt(hashing) % size;
     }
   }
 
-  union { MappingV1 v1; MappingV2 v2; } _Map;
-  Function<IndexT(KeyT*)> _Hash;
-  Bool _Style, _Bitwise;
+  union { MappingV1 v1; MappingV2 v2; MappingV3 v3; } _Map;
+  HashT _Hash;
+  UInt _Style;
+  Bool _Bitwise;
   UInt _Count;
+  Double _Limit;
+
+  /* @NOTE: the previous mapping of the chained mode and the next bucket of
+   * it which will be moved, _Previous.Size is 0 if no migration is running */
+  MappingV1 _Previous;
+  ULong _Cursor;
 };
 }  // namespace Base
 #endif  // BASE_HASHTABLE_H_
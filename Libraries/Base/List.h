@@ -3,9 +3,11 @@
 #include <Config.h>
 
 #if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Epoch.h>
 #include <Base/Type.h>
 #include <Base/Utils.h>
 #else
+#include <Epoch.h>
 #include <Type.h>
 #include <Utils.h>
 #endif
@@ -43,32 +45,43 @@ protected:
    * ______________________________________________________________________ */
 
 public:
+  /* @NOTE: a list can be built with 2 layouts:
+   * - ELinked: the default layout, each pointer is kept by its own node and
+   *   every node is chained together.
+   * - EChunked: pointers are kept inside cache-line-aligned chunks and the
+   *   chunks are reached by a directory which is calculated from the index so
+   *   At(index, True) costs O(1) while positional access only jumps over chunks
+   *   instead of walking through every node.
+   * ______________________________________________________________________ */
+  enum LayoutE { ELinked = 0, EChunked = 1 };
+
 #if !NDEBUG
   explicit List(Int retry = -1, Bool dumpable = False);
 #else
   explicit List(Int retry = -1);
 #endif
+  explicit List(LayoutE layout, Int retry = -1);
   virtual ~List();
 
   /* @NOTE: this method is used to get the pointer of a node, base on index or
    * its position number */
   template <typename T> T *At(ULong number, Bool is_index = False) {
-    T *result = None;
-    Long nsec = 1;
+    Node *node = None;
 
-    for (auto retry = _Retry; retry > 0; --retry) {
-      Node *node = None;
+    if (_Layout == EChunked) {
+      return (T *)Pick(number, is_index);
+    } else {
+      /* @NOTE: a detached node is only released when no reader can see it so
+       * we don't need to retry or wait for anyone here */
 
-      if ((node = Access(number, is_index))) {
-        result = (T *)node->Ptr;
+      Epoch::Guard guard{};
 
-        break;
+      if ((node = Access(number, is_index))) {
+        return (T *)node->Ptr;
       }
-
-      Idle((nsec = ((nsec * 2) % ULong(1e9))));
     }
 
-    return result;
+    return None;
   }
 
   /* @NOTE: these methods are used to detect if a node existes or not */
@@ -85,24 +98,53 @@ public:
   Bool Del(ULong index, Void *pointer, ErrorCodeE *code = None,
            Bool failable = False);
 
+  /* @NOTE: this method is used to walk through every live pointer in one pass
+   * and the walk stops when the callback returns an error, this error will be
+   * returned to the caller:
+   * - Without snapshot, concurrent Add/Del are tolerated without any retry and
+   *   the callback might see them or not.
+   * - With snapshot, pointers are collected first and the callback only sees
+   *   a consistent view of the list. If the list keeps changing for too long,
+   *   EDoAgain is returned without calling the callback.
+   * ______________________________________________________________________ */
+  ErrorCodeE ForEach(Function<ErrorCodeE(ULong, Void *)> callback,
+                     Bool snapshot = False);
+
   /* @NOTE: this method is used to get List's size */
   ULong Size(Bool type = False);
 
+  /* @NOTE: this method is used to check which layout is used by this list */
+  LayoutE Layout();
+
+  /* @NOTE: nodes are cached inside per-thread magazines, this structure shows
+   * how well the magazines work:
+   * - Hits: nodes are taken from a magazine.
+   * - Misses: nodes are allocated directly since the magazine and the shared
+   *   depot are both empty.
+   * - Refills: batches are taken from the shared depot.
+   * - Flushes: batches are returned to the shared depot.
+   * ______________________________________________________________________ */
+  struct Statistic {
+    ULong Hits, Misses, Refills, Flushes;
+  };
+
+  /* @NOTE: this method is used to collect counters of every magazines */
+  static Statistic Statistics();
+
 protected:
   struct Node {
     /* @NOTE: this is how our node is defined so with it, we can build a list to
      * work on parallel */
 
     Void *Ptr;
-    Node *Next, *Prev[2], **PNext, **PPrev, **PHead, **PLast;
+    Node *Next, *Prev, **PNext, **PPrev, **PHead, **PLast;
     ULong Index;
     Bool State;
 
     explicit Node(Void *pointer, Node **phead, Node **plast) {
       Ptr = pointer;
       Next = None;
-      Prev[0] = None;
-      Prev[1] = None;
+      Prev = None;
       PPrev = None;
       PNext = None;
       PHead = phead;
@@ -112,6 +154,14 @@ protected:
     }
   };
 
+  /* @NOTE: this is how a chunk is defined when we use layout EChunked, each
+   * chunk is aligned to cache line and keeps its own counter so positional
+   * access can jump over chunks without touching their slots */
+  struct Chunk {
+    Void *Ptr[15];
+    ULong Count;
+  } __attribute__((aligned(64)));
+
   /* @NOTE: this method is used to attach a node into our list, the node could
    * be defined some-where else, waiting to be added into our list */
   Long Attach(Node *node, ErrorCodeE *error = None);
@@ -126,12 +176,34 @@ protected:
   Node *Access(Void *pointer, ErrorCodeE *code = None);
   Node *Access(ULong &number, Bool is_index = False, ErrorCodeE *code = None);
 
-  /* @NOTE: this method is used to allocate a new node. By default, it should
-   * use allocated nodes which are stored inside preserved queue */
+  /* @NOTE: this method is used to allocate a new node. Dead nodes aren't
+   * reused directly, they are retired to Epoch and released by Release() when
+   * no thread can see them anymore */
   Node *Allocate(Void *pointer);
 
 private:
+  struct Magazine;
+
   static void Idle(Long nanosec);
+  static void Release(Void *node);
+
+  /* @NOTE: these methods are used to take and give back nodes to the magazine
+   * of the current thread, the magazine talks to the shared depot in batches
+   * only when it's empty or full */
+  static Magazine *Local();
+  static Node *Take();
+  static void Give(Node *node);
+
+  /* @NOTE: these methods are used by layout EChunked only, Slot() finds the
+   * place of an index using the directory while Pick() and Locate() translate
+   * positions and pointers into slots */
+  Void **Slot(ULong index, Bool allocate = False, Chunk **chunk = None);
+  Void *Pick(ULong number, Bool is_index);
+  ULong Locate(Void *pointer);
+
+  /* @NOTE: this method is used to walk through every live pointer once, it's
+   * the core of method ForEach */
+  ErrorCodeE Walk(Function<ErrorCodeE(ULong, Void *)> &callback);
 
   /* @NOTE: this method is used to detach a node out from our list so we could
    * modify it freely. To make sure that the node is within our list, the index
@@ -147,8 +219,11 @@ private:
 #endif
 
   UInt _Retry;
-  Node *_Head[2], *_Last;
-  ULong _Size[2], _Count;
+  LayoutE _Layout;
+  Bool _Detaching;
+  Node *_Head, *_Last;
+  Chunk **_Segments[64];
+  ULong _Size[2], _Count, _Version[2];
 };
 } // namespace Base
 #endif
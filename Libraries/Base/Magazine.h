@@ -0,0 +1,287 @@
+#ifndef BASE_MAGAZINE_H_
+#define BASE_MAGAZINE_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Atomic.h>
+#include <Base/Type.h>
+#else
+#include <Atomic.h>
+#include <Type.h>
+#endif
+
+#if __cplusplus
+namespace Base {
+namespace Internal {
+/* @NOTE: a magazine is a small stack of free items owned by one thread so
+ * taking or giving back an item never touches any shared cache line. When
+ * it's empty, we take a whole batch from the shared depot and when it's full,
+ * we return half of it as a batch. Batches are chained by the field Prev of
+ * their first item while items inside a batch are chained by Next, so these
+ * are the only fields which T must have.
+ *
+ *   thread A        thread B
+ *   +-------+       +-------+
+ *   | items |       | items |
+ *   +-------+       +-------+
+ *     ^   |           ^   |
+ *     |   v           |   v
+ *   +-----------------------+
+ *   | depot: batch -> batch |
+ *   +-----------------------+
+ *
+ * There is one depot per instance of this template and a magazine is meant
+ * to be kept as a thread_local. The depot keeps at most `Limit` batches, 0
+ * means no limit, and what it refuses is given back to the caller since only
+ * the caller knows how to release it. When its thread exits, a magazine
+ * returns everything to the depot and the thread talks to the depot directly
+ * from then on
+ * ______________________________________________________________________ */
+template<typename T, UInt Size, ULong Limit = 0>
+class Magazine {
+ public:
+  struct Statistic {
+    ULong Hits, Misses, Refills, Flushes;
+  };
+
+  Magazine() : _Items{}, _Count{0}, _Exited{False}, _Counters{0, 0, 0, 0} {}
+  ~Magazine();
+
+  /* @NOTE: this method takes an item, it returns None when the magazine and
+   * the depot are both empty so the caller should allocate a new one */
+  T* Take();
+
+  /* @NOTE: this method gives back an item, it returns a chain of items which
+   * the depot refuses and the caller should release them */
+  T* Give(T* item);
+
+  /* @NOTE: this method keeps a chain of new items, what we can't keep goes to
+   * the depot as a batch */
+  void Stock(T* batch);
+
+  /* @NOTE: this method collects the counters of every magazine, counters of
+   * the current thread haven't been published yet so they are added here */
+  Statistic Statistics();
+
+ protected:
+  Bool Refill();
+  T* Flush(UInt count);
+  void Publish();
+
+  static T* Push(T* batch, Bool force);
+  static T* Pop();
+  static void Lock();
+  static void Unlock();
+
+  T* _Items[Size];
+  UInt _Count;
+  Bool _Exited;
+  Statistic _Counters;
+
+  static T* _Depot;
+  static ULong _Batches;
+  static Bool _Locked;
+  static Statistic _Global;
+};
+
+template<typename T, UInt Size, ULong Limit>
+T* Magazine<T, Size, Limit>::_Depot{None};
+
+template<typename T, UInt Size, ULong Limit>
+ULong Magazine<T, Size, Limit>::_Batches{0};
+
+template<typename T, UInt Size, ULong Limit>
+Bool Magazine<T, Size, Limit>::_Locked{False};
+
+template<typename T, UInt Size, ULong Limit>
+typename Magazine<T, Size, Limit>::Statistic
+    Magazine<T, Size, Limit>::_Global{0, 0, 0, 0};
+
+template<typename T, UInt Size, ULong Limit>
+Magazine<T, Size, Limit>::~Magazine() {
+  /* @NOTE: nobody could release what the depot refuses at this moment, so
+   * the last batch of an exiting thread is always kept */
+
+  T* batch = Flush(_Count);
+
+  if (batch) {
+    Push(batch, True);
+  }
+
+  Publish();
+  _Exited = True;
+}
+
+template<typename T, UInt Size, ULong Limit>
+T* Magazine<T, Size, Limit>::Take() {
+  T* item{None};
+
+  if (_Exited) {
+    if ((item = Pop())) {
+      INC(&_Global.Hits);
+
+      if (item->Next) {
+        Push(item->Next, True);
+      }
+    } else {
+      INC(&_Global.Misses);
+    }
+  } else if (_Count > 0 || Refill()) {
+    _Counters.Hits++;
+    item = _Items[--_Count];
+  } else {
+    _Counters.Misses++;
+  }
+
+  return item;
+}
+
+template<typename T, UInt Size, ULong Limit>
+T* Magazine<T, Size, Limit>::Give(T* item) {
+  T* refused{None};
+
+  if (_Exited) {
+    item->Next = None;
+    return Push(item, False);
+  }
+
+  if (_Count == Size) {
+    refused = Flush(Size / 2);
+  }
+
+  _Items[_Count++] = item;
+  return refused;
+}
+
+template<typename T, UInt Size, ULong Limit>
+void Magazine<T, Size, Limit>::Stock(T* batch) {
+  if (!_Exited) {
+    for (; batch && _Count < Size; batch = batch->Next) {
+      _Items[_Count++] = batch;
+    }
+  }
+
+  /* @NOTE: batches of exited threads may be bigger than what we can keep */
+
+  if (batch) {
+    Push(batch, True);
+  }
+}
+
+template<typename T, UInt Size, ULong Limit>
+typename Magazine<T, Size, Limit>::Statistic
+    Magazine<T, Size, Limit>::Statistics() {
+  Statistic result{READ_ONCE(_Global.Hits), READ_ONCE(_Global.Misses),
+                   READ_ONCE(_Global.Refills), READ_ONCE(_Global.Flushes)};
+
+  if (!_Exited) {
+    result.Hits += _Counters.Hits;
+    result.Misses += _Counters.Misses;
+    result.Refills += _Counters.Refills;
+    result.Flushes += _Counters.Flushes;
+  }
+
+  return result;
+}
+
+template<typename T, UInt Size, ULong Limit>
+Bool Magazine<T, Size, Limit>::Refill() {
+  T* batch = Pop();
+
+  if (!batch) {
+    return False;
+  }
+
+  Stock(batch);
+
+  _Counters.Refills++;
+  Publish();
+  return True;
+}
+
+template<typename T, UInt Size, ULong Limit>
+T* Magazine<T, Size, Limit>::Flush(UInt count) {
+  T* batch{None};
+
+  for (; count > 0 && _Count > 0; --count) {
+    T* item = _Items[--_Count];
+
+    item->Next = batch;
+    batch = item;
+  }
+
+  if (!batch) {
+    return None;
+  }
+
+  _Counters.Flushes++;
+  Publish();
+  return Push(batch, False);
+}
+
+template<typename T, UInt Size, ULong Limit>
+void Magazine<T, Size, Limit>::Publish() {
+  ADD(&_Global.Hits, _Counters.Hits);
+  ADD(&_Global.Misses, _Counters.Misses);
+  ADD(&_Global.Refills, _Counters.Refills);
+  ADD(&_Global.Flushes, _Counters.Flushes);
+
+  _Counters = Statistic{0, 0, 0, 0};
+}
+
+template<typename T, UInt Size, ULong Limit>
+T* Magazine<T, Size, Limit>::Push(T* batch, Bool force) {
+  Lock();
+
+  if (force || !Limit || _Batches < Limit) {
+    batch->Prev = _Depot;
+    _Depot = batch;
+    _Batches++;
+    batch = None;
+  }
+
+  Unlock();
+  return batch;
+}
+
+template<typename T, UInt Size, ULong Limit>
+T* Magazine<T, Size, Limit>::Pop() {
+  T* batch{None};
+
+  if (!READ_ONCE(_Depot)) {
+    return None;
+  }
+
+  Lock();
+
+  if ((batch = _Depot)) {
+    _Depot = batch->Prev;
+    _Batches--;
+  }
+
+  Unlock();
+  return batch;
+}
+
+template<typename T, UInt Size, ULong Limit>
+void Magazine<T, Size, Limit>::Lock() {
+  /* @NOTE: the lock is only held for a few stores, so we spin on a plain
+   * read and let the core relax instead of hammering the cache line with
+   * CMPXCHG */
+
+  while (!CMPXCHG(&_Locked, False, True)) {
+    while (READ_ONCE(_Locked)) {
+      RELAX();
+    }
+  }
+}
+
+template<typename T, UInt Size, ULong Limit>
+void Magazine<T, Size, Limit>::Unlock() {
+  BARRIER();
+  WRITE_ONCE(_Locked, False);
+}
+} // namespace Internal
+} // namespace Base
+#endif
+#endif // BASE_MAGAZINE_H_
@@ -16,6 +16,8 @@
 
 #if __cplusplus
 namespace Base {
+class Lock;
+
 class Monitor {
  public:
   enum ActTypeE {
@@ -28,7 +30,28 @@ class Monitor {
   enum TypeE {
     EIOSync = 0,
     EPipe = 1,
-    ETimer = 2
+
+    /* @NOTE: timers which are driven by a single timerfd, they are triggered
+     * with a Timer and callbacks receive its Id instead of a fd */
+    ETimer = 2,
+
+    /* @NOTE: sockets which are watched by io_uring. A fd which is appended or
+     * modified with EDirect is read by the kernel and callbacks take the data
+     * with Receive. When the kernel can't do that, epoll is used and Receive
+     * doesn't find anything */
+    EIOUring = 3,
+
+    /* @NOTE: sockets like EIOSync, but every type from EShard to ELastShard
+     * has its own HEAD and polling system, so monitors of different shards
+     * share nothing. Acceptor takes one of them per shard */
+    EShard = 64,
+    ELastShard = 64 + 255
+  };
+
+  /* @NOTE: flags which are or-ed with the mode of Append and Modify, they
+   * are ignored by monitors which don't support them */
+  enum FlagE {
+    EDirect = 0x100
   };
 
   enum StatusE {
@@ -40,11 +63,42 @@ class Monitor {
     EDetached = 5
   };
 
-  using Check = Function<ErrorCodeE(Auto, Auto&, Int)>;
+  /* @NOTE: a timer of ETimer, times are in milliseconds. Id is chosen by the
+   * caller and Remove(Auto::As<ULong>(Id)) cancels the timer. Period 0 means
+   * the timer fires once and Slack lets it fire a bit later so close timers
+   * fire together */
+  struct Timer {
+    ULong Id, Delay, Period, Slack;
+  };
+
+  using Check = Function<ErrorCodeE(Auto&, Auto&, Int)>;
   using Perform = Function<ErrorCodeE(Auto, Auto&)>;
   using Indicate = Function<Perform*(Auto&, Int)>;
   using Fallback = Function<ErrorCodeE(Auto fd)>;
 
+  /* @NOTE: callbacks which are picked by Scan for an event. A fd has only a
+   * few owners, so they are kept inside the batch itself and the heap is used
+   * only when there are more than EInline of them */
+  class Batch {
+   public:
+    using Item = Pair<Monitor*, Perform*>;
+
+    Batch();
+
+    void Push(Item item);
+    ULong Size();
+
+    Item* begin();
+    Item* end();
+
+   private:
+    enum { EInline = 4 };
+
+    Item _Inline[EInline];
+    Vector<Item> _Spilled;
+    ULong _Size;
+  };
+
   virtual ~Monitor();
 
   /* @NOTE: these methods are used to access next and previous Monitor */
@@ -57,6 +111,13 @@ class Monitor {
   ErrorCodeE Find(Auto fd);
   ErrorCodeE Remove(Auto fd);
 
+  /* @NOTE: this method takes what the kernel has read for a fd with EDirect
+   * since the last call, an empty String means the peer has closed it.
+   * ENotFound means nothing has been read for us so callbacks must read the
+   * fd by themselves. It must be called on the Monitor which the callback is
+   * triggered on */
+  ErrorCodeE Receive(Auto fd, String& data);
+
   /* @NOTE: this method is used register a trigger when fd passes a
    * certain condition */
   ErrorCodeE Trigger(Auto event, Perform perform);
@@ -70,7 +131,7 @@ class Monitor {
   ErrorCodeE Loop(UInt steps = 1, Int timeout = 0);
 
   /* @NOTE: this method is call by HEAD monitor to probe fd's events */
-  ErrorCodeE Scan(Auto fd, Int mode, Vector<Pair<Monitor*, Perform*>>& callbacks);
+  ErrorCodeE Scan(Auto& fd, Int mode, Batch& callbacks);
 
   /* @NOTE: this function is used to claim a new job should be done later before
    * the monitor is destroyed */
@@ -145,16 +206,16 @@ class Monitor {
    * calling. How to handle these callbacks? how to keep balancing these
    * callbacks? most of them has been managed by Monitor and i will provide
    * convenient virtual methods to configure them */
-  ErrorCodeE Reroute(Monitor* child, Auto fd, Perform& callback);
+  ErrorCodeE Reroute(Monitor* child, Auto& fd, Perform& callback);
 
   /* @NOTE: this function is used to check if the fd is on fallback state which
    * lead to kill and remove its tasks */
-  ErrorCodeE Heartbeat(Auto fd);
+  ErrorCodeE Heartbeat(Auto& fd);
 
   /* @NOTE: these virtual methods are used to interact with monitor */
   virtual ErrorCodeE _Append(Auto fd, Int mode) = 0;
   virtual ErrorCodeE _Modify(Auto fd, Int mode) = 0;
-  virtual ErrorCodeE _Find(Auto fd) = 0;
+  virtual ErrorCodeE _Find(Auto& fd) = 0;
   virtual ErrorCodeE _Remove(Auto fd) = 0;
 
   /* @NOTE: this virtual method is used to register a triggering with
@@ -163,7 +224,7 @@ class Monitor {
 
   /* @NOTE: this virtual method is used to route a callback to the place and it
    * can be picked by _Handle to process */
-  virtual ErrorCodeE _Route(Auto fd, Perform& callback) = 0;
+  virtual ErrorCodeE _Route(Auto& fd, Perform& callback) = 0;
 
   /* @NOTE: this virtual method is used to check status of system or a specific
    * fd whihch is installed into the monitor */
@@ -179,7 +240,11 @@ class Monitor {
                              Int backlog = 100) = 0;
 
   /* @NOTE: this virtual method is used to access context of fd */
-  virtual Auto& _Access(Auto fd) = 0;
+  virtual Auto& _Access(Auto& fd) = 0;
+
+  /* @NOTE: this virtual method is used to take what the kernel has read for a
+   * fd, monitors which never read by themselves keep the default */
+  virtual ErrorCodeE _Receive(Auto& fd, String& data);
 
   /* @NOTE: this virtual method is used to flush every jobs which are pending 
    * inside the Monitor  */
@@ -203,10 +268,18 @@ class Monitor {
   /* @NOTE: these are used to make links between Head and its children */
   Monitor **_PNext, **_PLast, *_Head, *_Last, *_Next, *_Prev;
 
+  /* @NOTE: an entry of the dispatch table, a checker and its indicator are
+   * kept together so an event walks a short array instead of looking every
+   * indicator up by the address of its checker */
+  struct Dispatcher {
+    ULong Address;
+    Check Checker;
+    Indicate Indicator;
+  };
+
   /* @NOTE: these should be managed by CHILD */
-  Vector<Check> _Checks;
+  Vector<Dispatcher> _Dispatchers;
   Vector<Fallback> _Fallbacks;
-  Map<ULong, Indicate> _Indicators;
 
   /* @NOTE: this variable is used to indicate if the child is fully started */
   UInt _State;
@@ -214,15 +287,23 @@ class Monitor {
  private:
   /* @NOTE: this is the implementation of method Scan and it can be use to scan
    * and pick callbacks on single thread only */
-  ErrorCodeE ScanImpl(Auto fd, Int mode, Bool heading,
-                      Vector<Pair<Monitor*, Perform*>>& callbacks);
+  ErrorCodeE ScanImpl(Auto& fd, Int mode, Bool heading, Batch& callbacks);
 
   /* @NOTE: this function is used to scan throught all indicators and return
    * the next Monitor if it has, this is not thread-safe function */
-  ErrorCodeE ScanIter(Auto fd, Int mode, Monitor** next,
-                      Vector<Pair<Monitor*, Perform*>>& callbacks);
+  ErrorCodeE ScanIter(Auto& fd, Int mode, Monitor** next, Batch& callbacks);
 
   Int _Using;
+
+  /* @NOTE: this is the index of this Monitor inside the children list */
+  ULong _Token;
+
+  /* @NOTE: entries of our type inside the shared tables, they are looked up
+   * once under Secure since new types can be added while other monitors
+   * are running, and an entry never moves after it's added */
+  Pair<Monitor*, Monitor*>* _Links;
+  Base::Lock* _Locker;
+  List* _Children;
 };
 } // namespace Base
 #else
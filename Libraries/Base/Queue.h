@@ -4,6 +4,7 @@
 
 #if USE_BASE_WITH_FULL_PATH_HEADER
 #include <Base/Atomic.h>
+#include <Base/Epoch.h>
 #include <Base/Macro.h>
 #include <Base/Type.h>
 #include <Base/List.h>
@@ -12,6 +13,7 @@
 #include <Base/Logcat.h>
 #else
 #include <Atomic.h>
+#include <Epoch.h>
 #include <Macro.h>
 #include <Type.h>
 #include <List.h>
@@ -21,7 +23,414 @@
 #include <Utils.h>
 #endif
 
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <time.h>
+
+/* @NOTE: how many nodes are moved at once by the batch methods of Queue, it
+ * bounds the size of the arrays kept on the stack */
+#ifndef QUEUE_BATCH
+#define QUEUE_BATCH 64
+#endif
+
+/* @NOTE: how many free nodes are kept for unbounded queues of each type */
+#ifndef QUEUE_POOL
+#define QUEUE_POOL 4096
+#endif
+
 namespace Base {
+namespace Internal {
+void Idle(struct timespec* spec);
+
+/* @NOTE: these functions are used to park a thread on a 32-bit word and wake
+ * it up later. Park sleeps only when *address still equals expected and
+ * returns EDoAgain when timeout nanoseconds pass, a negative timeout means
+ * forever. Monotonic shows the monotonic clock in nanoseconds */
+ULong Monotonic();
+ErrorCodeE Park(UInt* address, UInt expected, Long timeout);
+void Wake(UInt* address, Int count);
+
+/* @NOTE: this is a bounded MPMC ring which is built based on the idea of
+ * Dmitry Vyukov. Each cell keeps a sequence number which tells who can use
+ * it next:
+ * - sequence == position: the cell is free and a producer at this position
+ *   can claim it.
+ * - sequence == position + 1: the cell is filled and a consumer at this
+ *   position can claim it.
+ * Producers and consumers only race on their own counter so they never block
+ * each other, except when the ring is full or empty.
+ * ______________________________________________________________________ */
+template <typename T>
+class Ring {
+ public:
+  explicit Ring(UInt capacity) : _Cells{None}, _Mask{0}, _Head{0}, _Tail{0} {
+    ULong size = 1;
+
+    while (size < capacity) {
+      size <<= 1;
+    }
+
+    _Cells = new Cell[size];
+    _Mask = size - 1;
+
+    for (ULong i = 0; i < size; ++i) {
+      _Cells[i].Sequence = i;
+    }
+  }
+
+  ~Ring() { delete[] _Cells; }
+
+  /* @NOTE: this method is used to push a value to the ring, it returns False
+   * immediately when the ring is full */
+  Bool Push(const T& value) {
+    ULong position = READ_ONCE(_Tail);
+    Cell* cell{None};
+
+    while (True) {
+      Long diff;
+
+      cell = &_Cells[position & _Mask];
+      diff = Long(READ_ONCE(cell->Sequence)) - Long(position);
+
+      if (diff == 0) {
+        if (CMPXCHG(&_Tail, position, position + 1)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return False;
+      }
+
+      position = READ_ONCE(_Tail);
+    }
+
+    cell->Value = value;
+    BARRIER();
+    WRITE_ONCE(cell->Sequence, position + 1);
+    return True;
+  }
+
+  /* @NOTE: this method is used to pop a value from the ring, it returns False
+   * immediately when the ring is empty */
+  Bool Pop(T& value) {
+    ULong position = READ_ONCE(_Head);
+    Cell* cell{None};
+
+    while (True) {
+      Long diff;
+
+      cell = &_Cells[position & _Mask];
+      diff = Long(READ_ONCE(cell->Sequence)) - Long(position + 1);
+
+      if (diff == 0) {
+        if (CMPXCHG(&_Head, position, position + 1)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return False;
+      }
+
+      position = READ_ONCE(_Head);
+    }
+
+    value = cell->Value;
+    BARRIER();
+    WRITE_ONCE(cell->Sequence, position + _Mask + 1);
+    return True;
+  }
+
+  /* @NOTE: this method is used to push many values at once, the positions
+   * are claimed with a single CAS so it returns how many values are pushed
+   * and it might be less than count when the ring is nearly full */
+  ULong Push(const T* values, ULong count) {
+    ULong position{0}, ready{0};
+
+    while (count > 0) {
+      position = READ_ONCE(_Tail);
+
+      for (ready = 0; ready < count; ++ready) {
+        Cell* cell = &_Cells[(position + ready) & _Mask];
+
+        if (READ_ONCE(cell->Sequence) != position + ready) {
+          break;
+        }
+      }
+
+      if (ready == 0) {
+        Long diff = Long(READ_ONCE(_Cells[position & _Mask].Sequence)) -
+                    Long(position);
+
+        if (diff < 0) {
+          return 0;
+        }
+      } else if (CMPXCHG(&_Tail, position, position + ready)) {
+        break;
+      }
+    }
+
+    for (ULong i = 0; i < ready; ++i) {
+      Cell* cell = &_Cells[(position + i) & _Mask];
+
+      cell->Value = values[i];
+      BARRIER();
+      WRITE_ONCE(cell->Sequence, position + i + 1);
+    }
+
+    return ready;
+  }
+
+  /* @NOTE: this method is used to pop many values at once, like the method
+   * above the positions are claimed with a single CAS */
+  ULong Pop(T* values, ULong count) {
+    ULong position{0}, ready{0};
+
+    while (count > 0) {
+      position = READ_ONCE(_Head);
+
+      for (ready = 0; ready < count; ++ready) {
+        Cell* cell = &_Cells[(position + ready) & _Mask];
+
+        if (READ_ONCE(cell->Sequence) != position + ready + 1) {
+          break;
+        }
+      }
+
+      if (ready == 0) {
+        Long diff = Long(READ_ONCE(_Cells[position & _Mask].Sequence)) -
+                    Long(position + 1);
+
+        if (diff < 0) {
+          return 0;
+        }
+      } else if (CMPXCHG(&_Head, position, position + ready)) {
+        break;
+      }
+    }
+
+    for (ULong i = 0; i < ready; ++i) {
+      Cell* cell = &_Cells[(position + i) & _Mask];
+
+      values[i] = cell->Value;
+      BARRIER();
+      WRITE_ONCE(cell->Sequence, position + i + _Mask + 1);
+    }
+
+    return ready;
+  }
+
+  /* @NOTE: this method shows how many cells the ring has */
+  ULong Capacity() { return _Mask + 1; }
+
+ private:
+  struct Cell {
+    ULong Sequence;
+    T Value;
+  };
+
+  Cell* _Cells;
+  ULong _Mask;
+
+  /* @NOTE: producers and consumers work on different cache lines, we pad
+   * them instead of aligning them since the ring is created with new */
+  Char _Paddings[2][64];
+  ULong _Head;
+  Char _Padding[64];
+  ULong _Tail;
+};
+
+/* @NOTE: this is a generation-tagged slot table which keeps pointers of
+ * in-flight tasks. A task id is built from the slot's position and the
+ * slot's generation:
+ *
+ *        63                 32 31                  0
+ *       +---------------------+---------------------+
+ *       |     generation      |    position + 1     |
+ *       +---------------------+---------------------+
+ *
+ * Removing a pointer moves the slot's generation forward with a single CAS
+ * so only one thread can win and every id issued before is detected as
+ * stale. Slots are kept inside segments whose size doubles, segments are
+ * never released until the table is destroyed so lookups don't need any
+ * critical section and cost O(1).
+ * ______________________________________________________________________ */
+template <typename T>
+class Table {
+ public:
+  Table() : _Count{0}, _Next{0}, _Free{0} {
+    for (auto i = 0; i < 32; ++i) {
+      _Segments[i] = None;
+    }
+  }
+
+  ~Table() {
+    for (auto i = 0; i < 32; ++i) {
+      delete[] _Segments[i];
+    }
+  }
+
+  /* @NOTE: this method is used to keep a pointer and return its task id, 0
+   * means that we can't find any slot */
+  ULong Add(T* value) {
+    UInt position{0};
+    Slot* slot{None};
+
+    if (!Take(position) || !(slot = Pick(position, True))) {
+      return 0;
+    }
+
+    WRITE_ONCE(slot->Value, value);
+    INC(&_Count);
+
+    return (ULong(READ_ONCE(slot->Generation)) << 32) | (ULong(position) + 1);
+  }
+
+  /* @NOTE: this method is used to find the pointer of a task, None is
+   * returned when the task is done or its id is stale */
+  T* At(ULong task) {
+    UInt generation = task >> 32;
+    Slot* slot = Find(task);
+    T* result{None};
+
+    if (!slot || READ_ONCE(slot->Generation) != generation) {
+      return None;
+    }
+
+    result = READ_ONCE(slot->Value);
+    BARRIER();
+
+    return READ_ONCE(slot->Generation) == generation ? result : None;
+  }
+
+  /* @NOTE: this method is used to remove the pointer of a task, it returns
+   * False when somebody else has removed it or the id is stale */
+  Bool Del(ULong task, T* value) {
+    UInt generation = task >> 32;
+    Slot* slot = Find(task);
+
+    if (!slot || READ_ONCE(slot->Value) != value) {
+      return False;
+    } else if (!CMPXCHG(&slot->Generation, generation, generation + 1)) {
+      return False;
+    }
+
+    WRITE_ONCE(slot->Value, None);
+    DEC(&_Count);
+
+    Give(UInt(task & 0xffffffff) - 1);
+    return True;
+  }
+
+  /* @NOTE: this method is used to visit every pointer which is still kept
+   * inside the table, it isn't safe to use while another threads are
+   * modifying the table */
+  void ForEach(Function<void(T*)> callback) {
+    for (UInt position = 0; position < READ_ONCE(_Next); ++position) {
+      Slot* slot = Pick(position, False);
+
+      if (slot && slot->Value) {
+        callback(slot->Value);
+      }
+    }
+  }
+
+  /* @NOTE: this method shows how many tasks are in-flight */
+  ULong Size() { return READ_ONCE(_Count); }
+
+ private:
+  struct Slot {
+    UInt Generation, Next;
+    T* Value;
+  };
+
+  /* @NOTE: segment k keeps 64 << k slots so the first segments are small
+   * and 32 segments are enough for every 32-bit position */
+  Slot* Pick(UInt position, Bool allocate) {
+    ULong index = ULong(position) + 64;
+    UInt segment = 63 - __builtin_clzll(index) - 6;
+    Slot* slots = READ_ONCE(_Segments[segment]);
+
+    if (!slots && allocate) {
+      Slot* fresh = new (std::nothrow) Slot[ULong(64) << segment]();
+
+      if (!fresh) {
+        return None;
+      } else if (CMPXCHG(&_Segments[segment], None, fresh)) {
+        slots = fresh;
+      } else {
+        delete[] fresh;
+        slots = READ_ONCE(_Segments[segment]);
+      }
+    }
+
+    return slots ? &slots[index - (ULong(64) << segment)] : None;
+  }
+
+  Slot* Find(ULong task) {
+    ULong position = task & 0xffffffff;
+
+    if (position == 0 || position > READ_ONCE(_Next)) {
+      return None;
+    }
+
+    return Pick(UInt(position - 1), False);
+  }
+
+  /* @NOTE: free slots are chained into a stack, its head keeps a tag on the
+   * high 32 bits to prevent the ABA problem and position + 1 on the others */
+  Bool Take(UInt& position) {
+    while (True) {
+      ULong head = READ_ONCE(_Free);
+      Slot* slot{None};
+
+      if ((head & 0xffffffff) == 0) {
+        break;
+      }
+
+      slot = Pick(UInt(head & 0xffffffff) - 1, False);
+
+      if (CMPXCHG(&_Free, head,
+                  (((head >> 32) + 1) << 32) | READ_ONCE(slot->Next))) {
+        position = UInt(head & 0xffffffff) - 1;
+        return True;
+      }
+    }
+
+    /* @NOTE: there is no free slot, claim a brand-new one */
+
+    while (True) {
+      UInt next = READ_ONCE(_Next);
+
+      if (next == 0xffffffff) {
+        return False;
+      } else if (CMPXCHG(&_Next, next, next + 1)) {
+        position = next;
+        return True;
+      }
+    }
+  }
+
+  void Give(UInt position) {
+    Slot* slot = Pick(position, False);
+
+    while (True) {
+      ULong head = READ_ONCE(_Free);
+
+      WRITE_ONCE(slot->Next, UInt(head & 0xffffffff));
+
+      if (CMPXCHG(&_Free, head,
+                  (((head >> 32) + 1) << 32) | (ULong(position) + 1))) {
+        break;
+      }
+    }
+  }
+
+  Slot* _Segments[32];
+  ULong _Count;
+  UInt _Next;
+  ULong _Free;
+};
+} // namespace Internal
+
 template <typename T>
 class Queue {
  private:
@@ -31,67 +440,114 @@ class Queue {
     EWaiting = 2
   };
 
+  /* @NOTE: a node keeps its value inline so Put and Get don't need another
+   * allocation and the value's lifetime never depends on the caller. The
+   * value is constructed when the node is put and destroyed when its task
+   * is done, nodes themselves are reused through a pool */
   struct Node {
-    Pair<T*, Bool> Slot;
     StatusE Status;
     Node *Next;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+    Node(): Status{ERejected}, Next{None} {}
 
-    Node(Pair<T*, Bool>&& slot): Slot{slot}, Status{ERejected}, Next{None} {}
-    Node(Pair<T*, Bool>& slot): Slot{slot}, Status{ERejected}, Next{None} {}
+    T* Value() { return reinterpret_cast<T*>(&Storage); }
   };
 
  public:
   /* @NOTE: as it suggests we can define our backlog size so if the qsize
    * reaches it, we will temporarily freeze the input so the worker-threads
    * will have enough time to reduce backlog a bit. With that we can control
-   * the speed and keep balancing between input and output better */
-  explicit Queue(UInt backlog = 0) : _Size{0}, _Cache{}, _Head{None},
-                                     _Last{None} {
+   * the speed and keep balancing between input and output better.
+   *
+   * - backlog == 0: the queue is unbounded, nodes are taken from a pool
+   *   which is shared by every queue of the same type and nodes are chained
+   *   together.
+   * - backlog > 0: the queue is bounded, nodes are preallocated and they
+   *   are passed through lock-free rings. A node is taken by Put
+   *   and is returned only when its task is done so the backlog counts both
+   *   waiting and processing values. When every node is taken, Put blocks
+   *   when timeout < 0, fails fast when timeout == 0 or waits timeout
+   *   seconds before failing.
+   * ______________________________________________________________________ */
+  explicit Queue(UInt backlog = 0) : _Size{0}, _Backlog{backlog},
+                                     _Signals{0, 0}, _Sleepers{0, 0}, _Cache{},
+                                     _Head{None}, _Last{None}, _Nodes{None},
+                                     _Ring{None}, _Free{None} {
+    if (_Backlog > 0) {
+      _Nodes = (Node*)ABI::Calloc(_Backlog, sizeof(Node));
+      _Ring = new Internal::Ring<Node*>(_Backlog);
+      _Free = new Internal::Ring<Node*>(_Backlog);
+
+      if (!_Nodes) {
+        throw Except(EDrainMem, "can\'t preallocate the queue's backlog");
+      }
+
+      for (UInt i = 0; i < _Backlog; ++i) {
+        _Free->Push(new (&_Nodes[i]) Node{});
+      }
+    }
   }
 
   virtual ~Queue() {
-  }
+    Node* node{None};
 
-  /* @NOTE: This method is used to reject a task the the rejected task will put
-   * back to the queue, waiting to be picked again by another threads */
-  Bool Reject(UInt task) {
-    Node* node = At(task);
+    /* @NOTE: release values which are still waiting or processing, the
+     * preallocated nodes are freed at once while the others are given back
+     * to the pool */
 
-    if (node) {
-      if (!CMPXCHG(&node->Status, EWaiting, ERejected)) {
-        return False;
+    if (_Backlog > 0) {
+      while (_Ring->Pop(node)) {
+        node->Value()->~T();
       }
 
-      if (!Put(node)) {
-        return False;
+      _Cache.ForEach([](Node* node) { node->Value()->~T(); });
+
+      delete _Ring;
+      delete _Free;
+
+      ABI::Free(_Nodes);
+    } else {
+      for (node = _Head; node;) {
+        Node* next = node->Next;
+
+        Release(node);
+        node = next;
       }
 
-      return Del(task, node);
+      _Cache.ForEach([](Node* node) { Release(node); });
     }
+  }
+
+  /* @NOTE: This method is used to reject a task the the rejected task will put
+   * back to the queue, waiting to be picked again by another threads. Values
+   * of move-only types are moved out by Get so they must be given back with
+   * the second method */
+  Bool Reject(ULong task) {
+    static_assert(std::is_copy_assignable<T>::value,
+                  "move-only values must be given back when rejecting");
 
-    return False;
+    return Requeue(task, None);
   }
 
+  Bool Reject(ULong task, T&& value) { return Requeue(task, &value); }
+
   /* @NOTE: This method is used to confirm a task is done so we can remove it 
    * out from our cache */
-  Bool Done(UInt task) {
+  Bool Done(ULong task) {
     Node* node = At(task);
 
-    if (node) {
-      if (!CMPXCHG(&node->Status, EWaiting, EFinished)) {
-        return False;
-      }
+    /* @NOTE: Del moves the slot's generation forward so it's the only claim,
+     * a duplicated or stale id may still see the node through At() but it
+     * can't win Del and it never touches the node which may be reused by
+     * another task already */
 
-      if (Del(task, node)) {
-        Free(node);
-      } else {
-        return False;
-      }
-    } else {
+    if (!node || !Del(task, node)) {
       return False;
     }
 
-    return True;
+    WRITE_ONCE(node->Status, EFinished);
+    return Free(node);
   }
 
   /* @NOTE: This method is used to lock input/output queue. 
@@ -112,61 +568,160 @@ class Queue {
     return _Locks[Int(input)](False);
   }
 
-  /* @NOTE: These methods are used to put a value to queue */
+  /* @NOTE: These methods are used to put a value to queue, the value is
+   * copied or moved into the node */
   Bool Put(const T& value, Double timeout = -1) {
-    return Put(new Node{Pair<T*, Bool>(const_cast<T*>(&value), False)});
+    Node* node = _Backlog > 0 ? Reserve(timeout) : Allocate();
+
+    if (!node) {
+      return False;
+    }
+
+    new (node->Value()) T(value);
+    return Put(node, timeout);
   }
 
   Bool Put(T&& value, Double timeout = -1) {
-    return Put(new Node{Pair<T*, Bool>(new T{value}, True)});
+    Node* node = _Backlog > 0 ? Reserve(timeout) : Allocate();
+
+    if (!node) {
+      return False;
+    }
+
+    new (node->Value()) T(std::move(value));
+    return Put(node, timeout);
   }
 
   /* @NOTE: This method is used to get a value from the queue. When a value is
    * picked, it will be moved to an internal cache and waiting in it to be 
-   * claimed done or be rejected back to our queue */
-  ULong Get(T& value, Double timeout = -1.0) {
-    TimeT begin{time(None)};
-    Double passing{0.0};
+   * claimed done or be rejected back to our queue. When the queue is empty:
+   * - timeout == 0: we return 0 immediately.
+   * - timeout < 0: we park until a value is put to the queue.
+   * - timeout > 0: we park at most timeout seconds, fractions are accepted.
+   * Parking consumers sleep on a futex so they don't burn CPU while the queue
+   * is idle and every Put wakes one of them up */
+  ULong Get(T& value, Double timeout = 0.0) {
+    ULong begin{Internal::Monotonic()};
 
-    while (timeout < 0.0 || (passing = difftime(time(None), begin)) > timeout) {
-      Node *head{_Head}, *next{head? head->Next: None}, *last{_Last};
+    while (True) {
+      UInt signal{READ_ONCE(_Signals[0])};
       ULong result{0};
 
       /* @NOTE: detect a freezing request so we will see the queue is hanging 
        * here until the timeout happen and this will break the queue from the
        * locked state */
 
-      if (!Enter(False, timeout - passing)) {
+      if (!Enter(False, Left(timeout, begin))) {
         return 0;
-      } else if (!CMPXCHG(&_Head, head, next)) {
-        goto again;
+      } else if ((result = Fetch(value))) {
+        return result;
       }
-      
-      if (!next) {
-        CMPXCHG(&_Last, last, None);
+
+      /* @NOTE: the signal is read before fetching, so if a value is put after
+       * our try the signal has changed and Park returns immediately */
+
+      if (!Wait(False, signal, timeout, begin)) {
+        return 0;
       }
+    }
+  }
+
+  /* @NOTE: This method is used to put many values at once, the whole range is
+   * linked (or pushed to the ring) with a single atomic operation per batch
+   * of QUEUE_BATCH values instead of one per value. It returns how many
+   * values are put, which is less than the range's size only when the ring
+   * is full and the timeout happens */
+  template <typename Iterator>
+  ULong PutMany(Iterator begin, Iterator end, Double timeout = -1) {
+    ULong result{0}, remain = std::distance(begin, end);
+
+    if (!Enter(True, timeout)) {
+      return 0;
+    }
 
-      /* @NOTE: so we successfully fetch a node out of the Queue's head and now
-       * we will process this node like adding it to our cache to remember it
-       * in the case user reject this node */
+    while (remain > 0) {
+      Node* nodes[QUEUE_BATCH];
+      ULong count = remain < QUEUE_BATCH ? remain : QUEUE_BATCH;
 
-      if (head && head->Slot.Left) {
-        if ((result = _Cache.Add(head))) {
-          Vertex<void> escaping{[](){}, [&]() { Exit(False); }};
-          value = *(head->Slot.Left);
+      if (_Backlog > 0) {
+        if (!(count = Reserve(nodes, count, timeout))) {
+          break;
         }
+      } else {
+        for (ULong i = 0; i < count; ++i) {
+          nodes[i] = Allocate();
+        }
+      }
 
+      for (ULong i = 0; i < count; ++i, ++begin) {
+        new (nodes[i]->Value()) T(*begin);
+      }
+
+      result += Link(nodes, count);
+      remain -= count;
+    }
+
+    return result;
+  }
+
+  /* @NOTE: This method is used to get at most max values at once, tasks will
+   * keep the tasks' ids which should be passed to DoneMany later. It waits
+   * like Get does when the queue is empty and returns how many values are
+   * picked */
+  ULong GetMany(T* values, ULong* tasks, ULong max, Double timeout = 0.0) {
+    ULong begin{Internal::Monotonic()};
+
+    while (max > 0) {
+      UInt signal{READ_ONCE(_Signals[0])};
+      ULong result{0};
+
+      if (!Enter(False, Left(timeout, begin))) {
+        return 0;
+      } else if ((result = Fetch(values, tasks, max))) {
         return result;
       }
 
-      break;
-again:
-      BARRIER();
+      if (!Wait(False, signal, timeout, begin)) {
+        return 0;
+      }
     }
 
     return 0;
   }
 
+  /* @NOTE: This method is used to confirm many tasks at once, it returns how
+   * many tasks are confirmed. Preallocated nodes are given back to the free
+   * ring in batches so producers are woken up once per batch */
+  ULong DoneMany(const ULong* tasks, ULong count) {
+    Node* nodes[QUEUE_BATCH];
+    ULong result{0}, ready{0};
+
+    for (ULong i = 0; i < count; ++i) {
+      Node* node = At(tasks[i]);
+
+      if (!node || !Del(tasks[i], node)) {
+        continue;
+      }
+
+      WRITE_ONCE(node->Status, EFinished);
+
+      if (_Backlog == 0) {
+        Free(node);
+      } else if ((nodes[ready++] = node) && ready == QUEUE_BATCH) {
+        Recycle(nodes, ready);
+        ready = 0;
+      }
+
+      result++;
+    }
+
+    if (ready > 0) {
+      Recycle(nodes, ready);
+    }
+
+    return result;
+  }
+
   /* @NOTE: This method shows the actual backlog size of our queue */
   Int QSize() {
     return _Size;
@@ -179,70 +734,243 @@ again:
   }
 
  protected:
+  /* @NOTE: this method is used to put a rejected node back to the queue,
+   * when value is given it replaces the node's value before the node is put
+   * back */
+  Bool Requeue(ULong task, T* value) {
+    Node* node = At(task);
+
+    /* @NOTE: like Done, Del is the only claim and the old id is dropped
+     * before the node becomes visible again so a late Done or Reject with it
+     * fails there and never touches the node. When Put fails the node is
+     * freed through Epoch since an unguarded At() might still see it */
+
+    if (!node || !Del(task, node)) {
+      return False;
+    }
+
+    WRITE_ONCE(node->Status, ERejected);
+
+    if (value) {
+      *(node->Value()) = std::move(*value);
+    }
+
+    return Put(node);
+  }
+
   /* @NOTE: this method is used to mock the new node into our serial  */
   Bool Put(Node* node, Double timeout = -1) {
-    Vertex<void> escaping{[](){}, [&]() { Exit(True); }};
-    TimeT begin{time(None)};
-    Double passing{0.0};
-
     if (!CMPXCHG(&node->Status, ERejected, EWaiting)) {
       return False;
     }
 
-    /* @NOTE: we must make sure that the inserted node doesn't connect to any node
-     * to prevent unexpected behavior */
-    node->Next = None;
+    /* @NOTE: detect a freezing request so we will see the queue is hanging 
+     * here until the timeout happen and this will break the queue from the
+     * locked state */
 
-    while (timeout < 0.0 || (passing = difftime(time(None), begin)) > timeout) {
-      Node *last{_Last}, *head{_Head};
+    if (!Enter(True, timeout)) {
+      Free(node);
+      return False;
+    }
 
+    Push(node);
+    return True;
+  }
 
-      /* @NOTE: detect a freezing request so we will see the queue is hanging 
-       * here until the timeout happen and this will break the queue from the
-       * locked state */
+  /* @NOTE: this method is used to push a waiting node to the queue's tail, it
+   * never blocks. The critical section is kept here only, so a producer
+   * which parks inside Enter doesn't stop the epoch from moving forward */
+  void Push(Node* node) {
+    Vertex<void> escaping{[](){}, [&]() { Exit(True); }};
 
-      if (!Enter(True, timeout - passing)) {
-        goto fail;
+    if (_Backlog > 0) {
+      /* @NOTE: there are only _Backlog nodes and the ring can keep all of
+       * them, pushing only fails when a consumer hasn't released its cell yet
+       * so we just need to try again. Preallocated nodes are never retired
+       * so we don't need any critical section here */
+
+      while (!_Ring->Push(node)) {
+        BARRIER();
       }
+    } else {
+      Epoch::Guard guard{};
+
+      /* @NOTE: we must make sure that the inserted node doesn't connect to
+       * any node to prevent unexpected behavior */
+
+      node->Next = None;
+      Splice(node, node);
+    }
+
+    Signal(False);
+  }
+
+  /* @NOTE: this method is used to append a chain of nodes to the queue's
+   * tail. Producers never retry, they swap the tail with a single atomic
+   * exchange and link the previous tail to the chain afterward. Between
+   * these steps the previous tail looks like the last node, consumers must
+   * wait until the link is done before they can move over it */
+  void Splice(Node* first, Node* last) {
+    Node* prev = ACK(&_Last, last);
+
+    if (prev) {
+      WRITE_ONCE(prev->Next, first);
+    } else {
+      WRITE_ONCE(_Head, first);
+    }
+  }
 
-      if (!CMPXCHG(&_Head, None, node)) {
-        if (head == None) {
-          goto again;
+  /* @NOTE: this method is used to claim at most max nodes from the queue's
+   * head with a single CAS, it never waits for new nodes and returns how
+   * many nodes are claimed */
+  ULong Claim(Node** nodes, ULong max) {
+    ULong count{0};
+
+    if (_Backlog > 0) {
+      return _Ring->Pop(nodes, max);
+    }
+
+    while (True) {
+      Node *head{READ_ONCE(_Head)}, *tail{head}, *next{None};
+
+      if (!head) {
+        return 0;
+      }
+
+      /* @NOTE: walk at most max nodes from the head, these nodes can't be
+       * released while we are inside the critical section even if another
+       * consumer claims them before us */
+
+      for (count = 1; count < max && (next = READ_ONCE(tail->Next));
+           ++count) {
+        tail = next;
+      }
+
+      if ((next = READ_ONCE(tail->Next))) {
+        if (!CMPXCHG(&_Head, head, next)) {
+          BARRIER();
+          continue;
+        }
+      } else if (READ_ONCE(_Last) != tail) {
+        /* @NOTE: a producer has swapped the tail but hasn't linked it to
+         * our tail yet, just try again */
+
+        BARRIER();
+        continue;
+      } else if (!CMPXCHG(&_Head, head, None)) {
+        BARRIER();
+        continue;
+      } else if (!CMPXCHG(&_Last, tail, None)) {
+        /* @NOTE: a producer came right after we took the head so it will
+         * link its chain to our tail, hand this chain over to the head */
+
+        while (!(next = READ_ONCE(tail->Next))) {
+          BARRIER();
         }
+
+        WRITE_ONCE(_Head, next);
       }
 
-      if (!CMPXCHG(&_Last, last, node)) {
-        goto again;
+      for (ULong i = 0; i < count; ++i, head = head->Next) {
+        nodes[i] = head;
       }
 
-      if (last) {
-        last->Next = node;
+      return count;
+    }
+  }
+
+  /* @NOTE: this method is used to fetch a value out of the queue's head, it
+   * never waits and returns 0 when the queue is empty. The critical section
+   * is kept here so consumers never park while they are still holding it */
+  ULong Fetch(T& value) {
+    Epoch::Guard guard{};
+    Node* node{None};
+    ULong result{0};
+
+    if (!Claim(&node, 1)) {
+      return 0;
+    }
+
+    Vertex<void> escaping{[](){}, [&]() { Exit(False); }};
+
+    /* @NOTE: so we successfully fetch a node out of the Queue's head and now
+     * we will process this node like adding it to our cache to remember it
+     * in the case user reject this node */
+
+    if ((result = _Cache.Add(node))) {
+      Pick(value, node);
+    } else {
+      Push(node);
+    }
+
+    return result;
+  }
+
+  /* @NOTE: this method is used to fetch at most max values at once, the
+   * whole batch is claimed with a single CAS on the queue's head or on the
+   * ring's head */
+  ULong Fetch(T* values, ULong* tasks, ULong max) {
+    Epoch::Guard guard{};
+    Node* nodes[QUEUE_BATCH];
+    ULong count{0}, result{0};
+
+    count = Claim(nodes, max < QUEUE_BATCH ? max : QUEUE_BATCH);
+    ADD(&_Size, -Int(count));
+
+    for (ULong i = 0; i < count; ++i) {
+      ULong task = _Cache.Add(nodes[i]);
+
+      if (task) {
+        Pick(values[result], nodes[i]);
+        tasks[result++] = task;
+      } else {
+        Push(nodes[i]);
       }
+    }
 
-      return True;
-again:
-      BARRIER();
+    return result;
+  }
+
+  /* @NOTE: this method is used to link many fresh nodes to the queue at once,
+   * the nodes are chained locally first so we only need one atomic operation
+   * like what we do with a single node */
+  ULong Link(Node** nodes, ULong count) {
+    Epoch::Guard guard{};
+
+    if (count == 0) {
+      return 0;
     }
 
-fail:
-    if (node->Slot.Right) {
-      delete node->Slot.Left;
+    for (ULong i = 0; i < count; ++i) {
+      nodes[i]->Status = EWaiting;
+      nodes[i]->Next = i + 1 < count ? nodes[i + 1] : None;
     }
 
-    delete node;
+    if (_Backlog > 0) {
+      for (ULong done = 0; done < count;) {
+        done += _Ring->Push(nodes + done, count - done);
+      }
+    } else {
+      Splice(nodes[0], nodes[count - 1]);
+    }
 
-    return False;
+    ADD(&_Size, Int(count));
+    Signal(False);
+    return count;
   }
 
   /* @NOTE: this method is used to release the node after we fetch it from the
-   * queue. The slot should be moved to cache, waiting to be claimed by users */
+   * queue. The slot should be moved to cache, waiting to be claimed by users.
+   * Another thread might still read this node inside Get or Put so we retire
+   * it instead of deleting it directly */
   Bool Free(Node* node) {
-    if (node && node->Slot.Left) {
-      if (node->Slot.Right) {
-        delete node->Slot.Left;
+    if (node) {
+      if (_Backlog > 0) {
+        Recycle(node);
+      } else {
+        node->Value()->~T();
+        Epoch::Retire(node, Queue<T>::Deallocate);
       }
-
-      delete node;
     } else {
       return False;
     }
@@ -250,6 +978,172 @@ fail:
     return True;
   }
 
+  /* @NOTE: this method is used to take a preallocated node, if every node is
+   * taken we will park until a node is returned or the timeout happens */
+  Node* Reserve(Double timeout) {
+    ULong begin{Internal::Monotonic()};
+    Node* node{None};
+
+    while (True) {
+      UInt signal{READ_ONCE(_Signals[1])};
+
+      if (_Free->Pop(node)) {
+        break;
+      } else if (!Wait(True, signal, timeout, begin)) {
+        return None;
+      }
+    }
+
+    node->Status = ERejected;
+    node->Next = None;
+    return node;
+  }
+
+  /* @NOTE: this method is used to take many preallocated nodes at once, it
+   * only waits when there is no free node at all */
+  ULong Reserve(Node** nodes, ULong count, Double timeout) {
+    ULong begin{Internal::Monotonic()}, result{0};
+
+    while (True) {
+      UInt signal{READ_ONCE(_Signals[1])};
+
+      if ((result = _Free->Pop(nodes, count))) {
+        break;
+      } else if (!Wait(True, signal, timeout, begin)) {
+        return 0;
+      }
+    }
+
+    for (ULong i = 0; i < result; ++i) {
+      nodes[i]->Status = ERejected;
+      nodes[i]->Next = None;
+    }
+
+    return result;
+  }
+
+  /* @NOTE: this method is used to return a preallocated node after its value
+   * is destroyed so it can be reused by another Put */
+  void Recycle(Node* node) { Recycle(&node, 1); }
+
+  void Recycle(Node** nodes, ULong count) {
+    for (ULong i = 0; i < count; ++i) {
+      nodes[i]->Value()->~T();
+    }
+
+    for (ULong done = 0; done < count;) {
+      ULong pushed = _Free->Push(nodes + done, count - done);
+
+      if (pushed == 0) {
+        BARRIER();
+      }
+
+      done += pushed;
+    }
+
+    Signal(True);
+  }
+
+  /* @NOTE: this method is used to park the current thread on a channel until
+   * the channel is signaled or the timeout happens. The channel input is used
+   * by producers waiting for free nodes and the other one is used by
+   * consumers waiting for values. It returns False when we shouldn't wait
+   * anymore */
+  Bool Wait(Bool input, UInt signal, Double timeout, ULong begin) {
+    Long remain{-1};
+
+    if (timeout == 0.0) {
+      return False;
+    } else if (timeout > 0.0) {
+      remain = Long(timeout * 1e9) - Long(Internal::Monotonic() - begin);
+
+      if (remain <= 0) {
+        return False;
+      }
+    }
+
+    INC(&_Sleepers[Int(input)]);
+    Internal::Park(&_Signals[Int(input)], signal, remain);
+    DEC(&_Sleepers[Int(input)]);
+
+    return True;
+  }
+
+  /* @NOTE: this method is used to notify a channel, the futex is only touched
+   * when somebody is parking on it so the fast path stays in userspace */
+  void Signal(Bool input, ULong count = 1) {
+    INC(&_Signals[Int(input)]);
+
+    if (READ_ONCE(_Sleepers[Int(input)]) > 0) {
+      Internal::Wake(&_Signals[Int(input)], Int(count));
+    }
+  }
+
+  /* @NOTE: this method shows how many seconds are left before the timeout
+   * happens, negative timeouts are kept as they are since they mean forever */
+  static Double Left(Double timeout, ULong begin) {
+    Double passing{0.0};
+
+    if (timeout <= 0.0) {
+      return timeout;
+    }
+
+    passing = Double(Internal::Monotonic() - begin) / 1e9;
+    return passing < timeout ? timeout - passing : 0.0;
+  }
+
+  /* @NOTE: nodes of unbounded queues are taken from a pool which is shared
+   * by every queue of the same type, so Put doesn't allocate anything once
+   * the pool is warm. The pool is never released since Epoch might give
+   * nodes back after every queue has gone */
+  static Internal::Ring<Node*>* Pool() {
+    static Internal::Ring<Node*>* pool = new Internal::Ring<Node*>(QUEUE_POOL);
+
+    return pool;
+  }
+
+  static Node* Allocate() {
+    Node* node{None};
+
+    if (!Pool()->Pop(node)) {
+      return new Node{};
+    }
+
+    node->Status = ERejected;
+    node->Next = None;
+    return node;
+  }
+
+  /* @NOTE: this callback is called by Epoch when no thread can see the node
+   * anymore, its value has been destroyed already */
+  static void Deallocate(Void* pointer) {
+    if (!Pool()->Push((Node*)pointer)) {
+      delete (Node*)pointer;
+    }
+  }
+
+  /* @NOTE: this method is used to destroy the value of a node which nobody
+   * can see and give the node back to the pool directly */
+  static void Release(Node* node) {
+    node->Value()->~T();
+    Deallocate(node);
+  }
+
+  /* @NOTE: these methods are used to pass the value of a picked node to the
+   * user, copyable values are copied so the node still keeps the value in
+   * the case the task is rejected while move-only values are moved out */
+  static void Pick(T& value, Node* node) {
+    Pick(value, node, typename std::is_copy_assignable<T>::type{});
+  }
+
+  static void Pick(T& value, Node* node, std::true_type) {
+    value = *(node->Value());
+  }
+
+  static void Pick(T& value, Node* node, std::false_type) {
+    value = std::move(*(node->Value()));
+  }
+
   /* @NOTE: this method is used to check if we enter a freezed channel or not
    * If it's true, we should lock it and wait until it's unlocked by another
    * threads. If we set timeout, it should break after a certain time */
@@ -275,31 +1169,17 @@ fail:
     }
   }
 
-  Node* At(ULong index) {
-    Node* result{None};
-
-    //_Locks[2].Safe([&]() {
-        result = _Cache.At<Node>(index, True);
-    //  });
-
-    return result;
-  }
-
-  Bool Del(ULong index, Node* node) {
-    Bool result{False};
+  Node* At(ULong task) { return _Cache.At(task); }
 
-    //_Locks[2].Safe([&]() {
-        result = _Cache.Del(index, node);
-    // });
-
-    return result;
-  }
+  Bool Del(ULong task, Node* node) { return _Cache.Del(task, node); }
 
  private:
   Int _Size;
+  UInt _Backlog, _Signals[2], _Sleepers[2];
   Lock _Locks[3];
-  List _Cache;
-  Node *_Head, *_Last;
+  Internal::Table<Node> _Cache;
+  Node *_Head, *_Last, *_Nodes;
+  Internal::Ring<Node*> *_Ring, *_Free;
 };
 } // namespace Base
 #endif // BASE_QUEUE_H_
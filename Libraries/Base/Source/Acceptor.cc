@@ -0,0 +1,367 @@
+#include <Acceptor.h>
+#include <Atomic.h>
+#include <Exception.h>
+#include <Logcat.h>
+#include <Macro.h>
+#include <Utils.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Base {
+namespace Internal {
+namespace Accepting {
+/* @NOTE: shard types which are taken by living acceptors, a type can be
+ * taken again when its acceptor is gone since its HEAD is gone too */
+static Bool Taken[Monitor::ELastShard - Monitor::EShard + 1];
+
+UInt Take() {
+  for (UInt i = 0; i <= Monitor::ELastShard - Monitor::EShard; ++i) {
+    if (CMPXCHG(&Taken[i], False, True)) {
+      return Monitor::EShard + i;
+    }
+  }
+
+  throw Except(EDrainMem, "every shard type is taken");
+}
+
+void Give(UInt type) { WRITE_ONCE(Taken[type - Monitor::EShard], False); }
+
+/* @NOTE: cores which we are allowed to run on, a container usually gives us
+ * only a part of the machine */
+Vector<Int> Cores() {
+  Vector<Int> result{};
+
+#if LINUX
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+
+  if (!sched_getaffinity(0, sizeof(set), &set)) {
+    for (Int core = 0; core < CPU_SETSIZE; ++core) {
+      if (CPU_ISSET(core, &set)) {
+        result.push_back(core);
+      }
+    }
+  }
+#endif
+
+  if (result.size() == 0) {
+    Long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    for (Long core = 0; core < (online > 0 ? online : 1); ++core) {
+      result.push_back(core);
+    }
+  }
+
+  return result;
+}
+
+void Pin(Int core) {
+#if LINUX
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+    WARNING << Format{"can\'t pin a shard to core {}"}.Apply(core)
+            << Base::EOL;
+  }
+#else
+  (void)core;
+#endif
+}
+
+#if !LINUX
+/* @NOTE: only Linux can make a socket non-blocking and closed on exec when
+ * it's created, other systems set these flags after that */
+Bool Prepare(Int fd) {
+  Int flags = fcntl(fd, F_GETFL);
+
+  return flags >= 0 && !fcntl(fd, F_SETFL, flags | O_NONBLOCK) &&
+         !fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+#endif
+
+/* @NOTE: open a listening socket, the first socket of an acceptor may bind
+ * port 0 so `address` is updated to the port which the kernel gives */
+ErrorCodeE Open(sockaddr_in *address, Int backlog, Int *result) {
+  socklen_t size = sizeof(sockaddr_in);
+  Int fd, enable{1};
+
+#if LINUX
+  fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+#else
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+#endif
+
+  if (fd < 0) {
+    return WatchErrno(Format{"socket: {}"} << strerror(errno)).code();
+  }
+
+#if !LINUX
+  if (!Prepare(fd)) {
+    ErrorCodeE error =
+        WatchErrno(Format{"fcntl: {}"} << strerror(errno)).code();
+
+    close(fd);
+    return error;
+  }
+#endif
+
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) ||
+      setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable))) {
+    close(fd);
+    return WatchErrno(Format{"setsockopt: {}"} << strerror(errno)).code();
+  }
+
+  if (bind(fd, (sockaddr *)address, sizeof(sockaddr_in)) ||
+      listen(fd, backlog) ||
+      getsockname(fd, (sockaddr *)address, &size)) {
+    ErrorCodeE error =
+        WatchErrno(Format{"bind: {}"} << strerror(errno)).code();
+
+    close(fd);
+    return error;
+  }
+
+  *result = fd;
+  return ENoError;
+}
+} // namespace Accepting
+} // namespace Internal
+
+struct Acceptor::Shard {
+  UInt Type;
+  Int Socket, Core;
+  ULong Accepted;
+  Shared<Monitor> Head;
+  Thread *Worker;
+  Bool Stalled;
+};
+
+Acceptor::Acceptor(UInt shards) : _Shards{}, _Port{0}, _Stopping{False} {
+  using namespace Internal::Accepting;
+
+  auto cores = Cores();
+
+  if (shards == 0) {
+    shards = cores.size();
+  }
+
+  for (UInt i = 0; i < shards; ++i) {
+    Shard *shard{None};
+
+    try {
+      shard = new Shard{Take(), -1, cores[i % cores.size()], 0, None, None,
+                         False};
+    } catch (Base::Exception &) {
+      Release();
+      throw;
+    }
+
+    _Shards.push_back(shard);
+
+    if (!(shard->Head = Monitor::Make(Format{"shard-{}"}.Apply(i),
+                                      shard->Type))) {
+      Release();
+      throw Except(EBadAccess, "can\'t make a Monitor for a shard");
+    }
+  }
+}
+
+Acceptor::~Acceptor() {
+  Stop();
+  Release();
+}
+
+void Acceptor::Release() {
+  for (auto shard : _Shards) {
+    shard->Head = None;
+
+    Internal::Accepting::Give(shard->Type);
+    delete shard;
+  }
+
+  _Shards.clear();
+}
+
+ErrorCodeE Acceptor::Listen(String address, UInt port, Accept accept,
+                            Int backlog) {
+  using namespace Internal::Accepting;
+
+  ErrorCodeE error{ENoError};
+  sockaddr_in addr;
+
+  if (_Port != 0) {
+    return BadLogic("the acceptor is listening already").code();
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+
+  if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+    return BadLogic(Format{"address {}"} << address).code();
+  }
+
+  _Accept = accept;
+  _Stopping = False;
+
+  /* @NOTE: every socket is bound before any shard starts, so the kernel
+   * knows the whole group when the first connection comes */
+  for (auto shard : _Shards) {
+    if ((error = Open(&addr, backlog, &shard->Socket))) {
+      break;
+    }
+
+    error = shard->Head->Trigger(Auto::As<Int>(shard->Socket),
+                                 [this, shard](Auto, Auto &) -> ErrorCodeE {
+                                   return OnAccepting(shard);
+                                 });
+
+    if (error) {
+      break;
+    }
+  }
+
+  _Port = ntohs(addr.sin_port);
+
+  for (auto shard : _Shards) {
+    if (error) {
+      break;
+    }
+
+    shard->Worker = new Thread{};
+
+    if (!shard->Worker->Start([this, shard]() {
+          Pin(shard->Core);
+
+          shard->Head->Loop([this, shard](Monitor &) -> Bool {
+            if (shard->Stalled) {
+              OnAccepting(shard);
+            }
+
+            return !READ_ONCE(_Stopping);
+          }, 10);
+        })) {
+      error = BadAccess("can\'t start a shard").code();
+    }
+  }
+
+  if (error) {
+    Stop();
+  }
+
+  return error;
+}
+
+ErrorCodeE Acceptor::Stop() {
+  WRITE_ONCE(_Stopping, True);
+
+  for (auto shard : _Shards) {
+    if (shard->Worker) {
+      delete shard->Worker;
+      shard->Worker = None;
+    }
+  }
+
+  for (auto shard : _Shards) {
+    if (shard->Socket >= 0) {
+      shard->Head->Remove(Auto::As<Int>(shard->Socket));
+
+      close(shard->Socket);
+      shard->Socket = -1;
+    }
+  }
+
+  _Port = 0;
+  return ENoError;
+}
+
+UInt Acceptor::Port() { return _Port; }
+
+UInt Acceptor::Size() { return _Shards.size(); }
+
+Monitor &Acceptor::At(UInt index) {
+  if (index >= _Shards.size()) {
+    throw Except(EOutOfRange, Format{"shard {}"}.Apply(index));
+  }
+
+  return *_Shards[index]->Head;
+}
+
+ULong Acceptor::Accepted(UInt index) {
+  if (index >= _Shards.size()) {
+    throw Except(EOutOfRange, Format{"shard {}"}.Apply(index));
+  }
+
+  return READ_ONCE(_Shards[index]->Accepted);
+}
+
+ErrorCodeE Acceptor::OnAccepting(Shard *shard) {
+  /* @NOTE: our sockets are watched edge-triggered, so we must accept until
+   * the backlog is empty or we won't be woken up again */
+
+  while (True) {
+#if LINUX
+    Int socket = accept4(shard->Socket, None, None,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    Int socket = accept(shard->Socket, None, None);
+#endif
+
+    if (socket < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      } else if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+                 errno == ENOMEM) {
+        /* @NOTE: connections are still queued in the backlog but no new edge
+         * comes for them until another client connects, so we try again on
+         * every tick of our Loop until the backlog is drained */
+
+        if (!shard->Stalled) {
+          WARNING << Format{"accept: {}, try again later"}
+                         .Apply(String(strerror(errno)))
+                  << Base::EOL;
+        }
+
+        shard->Stalled = True;
+        return ENoError;
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        WARNING << Format{"accept: {}"}.Apply(String(strerror(errno)))
+                << Base::EOL;
+      }
+
+      break;
+    }
+
+#if !LINUX
+    if (!Internal::Accepting::Prepare(socket)) {
+      WARNING << Format{"fcntl: {}"}.Apply(String(strerror(errno)))
+              << Base::EOL;
+
+      close(socket);
+      continue;
+    }
+#endif
+
+    INC(&shard->Accepted);
+
+    if (_Accept(socket, *shard->Head)) {
+      close(socket);
+    }
+  }
+
+  shard->Stalled = False;
+  return ENoError;
+}
+} // namespace Base
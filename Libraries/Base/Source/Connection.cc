@@ -0,0 +1,624 @@
+#include <Atomic.h>
+#include <Connection.h>
+#include <Exception.h>
+#include <Logcat.h>
+#include <Macro.h>
+#include <Magazine.h>
+#include <Utils.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* @NOTE: a chunk is 16KB including its header and chunks are carved from
+ * slabs of 16 chunks. A thread keeps up to 32 free chunks in its pool before
+ * it returns half of them to the depot */
+#define CHUNK_SIZE 16384
+#define SLAB_CHUNKS 16
+#define POOL_SIZE 32
+
+/* @NOTE: default watermarks of the output queue of a connection */
+#define LOW_WATERMARK (64 << 10)
+#define HIGH_WATERMARK (1 << 20)
+
+/* @NOTE: modes of Fildes, a socket is watched for reading or for writing */
+enum { EWaiting = 0, ELooping = 1 };
+
+namespace Base {
+struct Buffer::Chunk {
+  Chunk *Next, *Prev;
+  UInt Refs, Reserved;
+  Char Data[CHUNK_SIZE - 2 * sizeof(Void *) - 2 * sizeof(UInt)];
+};
+
+namespace Internal {
+namespace Buffering {
+using Chunk = Buffer::Chunk;
+
+/* @NOTE: free chunks are kept in magazines, see Magazine.h. Chunks live
+ * inside slabs so they are never given back to the system and the depot has
+ * no limit, it keeps every free chunk instead */
+using Pool = Magazine<Chunk, POOL_SIZE>;
+
+ULong Allocated{0};
+
+Pool *Local() {
+  thread_local Pool pool{};
+
+  return &pool;
+}
+
+/* @NOTE: carve a new slab, the first chunk is returned and the others go to
+ * `pool` or to the depot when `pool` is full */
+Chunk *Carve(Pool *pool) {
+  Chunk *slab = new Chunk[SLAB_CHUNKS];
+
+  ADD(&Allocated, SLAB_CHUNKS);
+
+  for (UInt i = 1; i < SLAB_CHUNKS; ++i) {
+    slab[i].Next = i + 1 < SLAB_CHUNKS ? &slab[i + 1] : None;
+  }
+
+  pool->Stock(&slab[1]);
+  return &slab[0];
+}
+} // namespace Buffering
+} // namespace Internal
+
+Buffer::Buffer() : _Pieces{}, _Size{0} {}
+
+Buffer::Buffer(const Buffer &src) : _Pieces{src._Pieces}, _Size{src._Size} {
+  for (auto &piece : _Pieces) {
+    Ref(piece.Owner);
+  }
+}
+
+Buffer::Buffer(Buffer &&src)
+    : _Pieces{std::move(src._Pieces)}, _Size{src._Size} {
+  src._Pieces.clear();
+  src._Size = 0;
+}
+
+Buffer::~Buffer() { Clear(); }
+
+Buffer &Buffer::operator=(const Buffer &src) {
+  if (this != &src) {
+    for (auto &piece : src._Pieces) {
+      Ref(piece.Owner);
+    }
+
+    Clear();
+
+    _Pieces = src._Pieces;
+    _Size = src._Size;
+  }
+
+  return *this;
+}
+
+Buffer &Buffer::operator=(Buffer &&src) {
+  if (this != &src) {
+    Clear();
+
+    _Pieces = std::move(src._Pieces);
+    _Size = src._Size;
+
+    src._Pieces.clear();
+    src._Size = 0;
+  }
+
+  return *this;
+}
+
+ULong Buffer::Size() { return _Size; }
+
+UInt Buffer::Count() { return _Pieces.size(); }
+
+View Buffer::At(UInt index) {
+  if (index >= _Pieces.size()) {
+    throw Except(EOutOfRange, Format{"piece {}"}.Apply(index));
+  }
+
+  return View(_Pieces[index].Owner->Data + _Pieces[index].Begin,
+              _Pieces[index].End - _Pieces[index].Begin);
+}
+
+Buffer Buffer::Slice(ULong offset, ULong size) {
+  Buffer result{};
+
+  for (auto &piece : _Pieces) {
+    ULong length = piece.End - piece.Begin;
+
+    if (size == 0) {
+      break;
+    } else if (offset >= length) {
+      offset -= length;
+    } else {
+      ULong taken = length - offset < size ? length - offset : size;
+
+      result.Append(piece.Owner, piece.Begin + offset,
+                    piece.Begin + offset + taken);
+      size -= taken;
+      offset = 0;
+    }
+  }
+
+  return result;
+}
+
+void Buffer::Consume(ULong size) {
+  UInt dropped{0};
+
+  for (; dropped < _Pieces.size() && size > 0; ++dropped) {
+    Piece &piece = _Pieces[dropped];
+    ULong length = piece.End - piece.Begin;
+
+    if (size < length) {
+      piece.Begin += size;
+      _Size -= size;
+      break;
+    }
+
+    Unref(piece.Owner);
+    size -= length;
+    _Size -= length;
+  }
+
+  if (dropped > 0) {
+    _Pieces.erase(_Pieces.begin(), _Pieces.begin() + dropped);
+  }
+}
+
+ULong Buffer::Copy(Char *output, ULong size, ULong offset) {
+  ULong copied{0};
+
+  for (auto &piece : _Pieces) {
+    ULong length = piece.End - piece.Begin;
+
+    if (copied == size) {
+      break;
+    } else if (offset >= length) {
+      offset -= length;
+    } else {
+      ULong taken = length - offset < size - copied ? length - offset
+                                                    : size - copied;
+
+      memcpy(output + copied, piece.Owner->Data + piece.Begin + offset, taken);
+      copied += taken;
+      offset = 0;
+    }
+  }
+
+  return copied;
+}
+
+String Buffer::ToString() {
+  String result{};
+
+  for (auto &piece : _Pieces) {
+    result.append(piece.Owner->Data + piece.Begin, piece.End - piece.Begin);
+  }
+
+  return result;
+}
+
+Long Buffer::Find(Char c, ULong offset) {
+  ULong position{0};
+
+  for (auto &piece : _Pieces) {
+    ULong length = piece.End - piece.Begin;
+
+    if (offset < length) {
+      const Char *begin = piece.Owner->Data + piece.Begin;
+      const Char *found = (const Char *)memchr(begin + offset, c,
+                                               length - offset);
+
+      if (found) {
+        return position + (found - begin);
+      }
+
+      offset = 0;
+    } else {
+      offset -= length;
+    }
+
+    position += length;
+  }
+
+  return -1;
+}
+
+void Buffer::Clear() {
+  for (auto &piece : _Pieces) {
+    Unref(piece.Owner);
+  }
+
+  /* @NOTE: the vector keeps its capacity so a long-living Buffer doesn't
+   * allocate again */
+  _Pieces.clear();
+  _Size = 0;
+}
+
+Buffer::Statistic Buffer::Statistics() {
+  using namespace Internal::Buffering;
+
+  auto counters = Local()->Statistics();
+
+  return Statistic{READ_ONCE(Allocated), counters.Hits, counters.Misses};
+}
+
+void Buffer::Append(Chunk *chunk, UInt begin, UInt end) {
+  /* @NOTE: bytes which come right after the last piece just extend it, so a
+   * chunk which is filled by many reads is still a single piece */
+
+  if (_Pieces.size() > 0 && _Pieces.back().Owner == chunk &&
+      _Pieces.back().End == begin) {
+    _Pieces.back().End = end;
+  } else {
+    Ref(chunk);
+    _Pieces.push_back(Piece{chunk, begin, end});
+  }
+
+  _Size += end - begin;
+}
+
+Buffer::Chunk *Buffer::Take() {
+  using namespace Internal::Buffering;
+
+  Pool *pool = Local();
+  Chunk *chunk = pool->Take();
+
+  if (!chunk) {
+    chunk = Carve(pool);
+  }
+
+  chunk->Next = None;
+  chunk->Prev = None;
+  chunk->Refs = 1;
+  return chunk;
+}
+
+void Buffer::Ref(Chunk *chunk) { INC(&chunk->Refs); }
+
+void Buffer::Unref(Chunk *chunk) {
+  if (DEC(&chunk->Refs) > 0) {
+    return;
+  }
+
+  /* @NOTE: the chunk goes back to the pool of the thread which releases it,
+   * not the one which has taken it. The depot has no limit so it never
+   * refuses a chunk */
+
+  Internal::Buffering::Local()->Give(chunk);
+}
+
+Char *Buffer::Data(Chunk *chunk) { return chunk->Data; }
+
+UInt Buffer::Capacity() { return sizeof(Chunk::Data); }
+
+Connection::Connection(Monitor &monitor, Int socket, Receive receive)
+    : _Monitor{&monitor}, _Receive{receive}, _Resume{None}, _Input{},
+      _Output{}, _Tail{None}, _Outgoing{None}, _Received{0}, _Sent{0},
+      _Low{LOW_WATERMARK}, _High{HIGH_WATERMARK}, _Filled{0}, _Written{0},
+      _Socket{socket}, _Closed{False}, _Blocked{False}, _Paused{False},
+      _Busy{False} {}
+
+Connection::~Connection() {
+  if (_Tail) {
+    Buffer::Unref(_Tail);
+  }
+
+  if (_Outgoing) {
+    Buffer::Unref(_Outgoing);
+  }
+}
+
+Shared<Connection> Connection::Make(Monitor &monitor, Int socket,
+                                    Receive receive) {
+  Shared<Connection> result{None};
+  Int flags{0};
+
+  if (!receive) {
+    BadLogic("a connection needs a callback to receive");
+    return None;
+  }
+
+  if ((flags = fcntl(socket, F_GETFL)) < 0 ||
+      fcntl(socket, F_SETFL, flags | O_NONBLOCK)) {
+    WatchErrno(Format{"fcntl: {}"} << strerror(errno));
+    return None;
+  }
+
+  result = Shared<Connection>(new Connection(monitor, socket, receive));
+
+  /* @NOTE: the Monitor keeps the connection alive as long as it watches the
+   * socket, the caller may keep it too. We read whatever the Monitor hasn't
+   * read for us, so direct reads are asked for where they are supported */
+  if (monitor.Trigger(Auto::As<Int>(socket),
+                      [result](Auto, Auto &) -> ErrorCodeE {
+                        return result->OnEvent();
+                      })) {
+    return None;
+  } else if (monitor.Modify(Auto::As<Int>(socket),
+                            EWaiting | Monitor::EDirect)) {
+    return None;
+  }
+
+  return result;
+}
+
+Int Connection::Socket() { return _Socket; }
+
+Bool Connection::Closed() { return _Closed; }
+
+ULong Connection::Received() { return _Received; }
+
+ULong Connection::Sent() { return _Sent; }
+
+ULong Connection::Pending() { return _Output.Size(); }
+
+Bool Connection::Writable() { return !_Paused; }
+
+void Connection::Watermarks(ULong low, ULong high, Resume resume) {
+  _Low = low < high ? low : high;
+  _High = high;
+  _Resume = resume;
+}
+
+ErrorCodeE Connection::Write(const Char *data, ULong size) {
+  if (_Socket < 0) {
+    return EBadAccess;
+  }
+
+  /* @NOTE: small writes are copied right after each other, Append merges
+   * them into one piece so they are sent with a single segment */
+  while (size > 0) {
+    ULong room = Reserve(&_Outgoing, &_Written);
+    ULong taken = size < room ? size : room;
+
+    memcpy(_Outgoing->Data + _Written, data, taken);
+    _Output.Append(_Outgoing, _Written, _Written + taken);
+
+    _Written += taken;
+    data += taken;
+    size -= taken;
+  }
+
+  return Queue();
+}
+
+ErrorCodeE Connection::Write(Buffer &buffer) {
+  if (_Socket < 0) {
+    return EBadAccess;
+  }
+
+  for (auto &piece : buffer._Pieces) {
+    _Output.Append(piece.Owner, piece.Begin, piece.End);
+  }
+
+  return Queue();
+}
+
+ErrorCodeE Connection::Queue() {
+  if (_Output.Size() >= _High) {
+    _Paused = True;
+  }
+
+  /* @NOTE: inside our callbacks, the queue is flushed once when they return
+   * so pipelined replies are sent together */
+  return _Busy ? ENoError : Flush();
+}
+
+ErrorCodeE Connection::Flush() {
+  struct iovec vectors[IOV_MAX];
+  ErrorCodeE error{ENoError};
+  Bool busy{_Busy};
+
+  if (_Socket < 0) {
+    return EBadAccess;
+  } else if (_Blocked) {
+    return ENoError;
+  }
+
+  _Busy = True;
+
+  while (_Output.Size() > 0) {
+    struct msghdr message;
+    UInt count{0};
+    Long size{0};
+
+    for (; count < IOV_MAX && count < _Output.Count(); ++count) {
+      Buffer::Piece &piece = _Output._Pieces[count];
+
+      vectors[count].iov_base = piece.Owner->Data + piece.Begin;
+      vectors[count].iov_len = piece.End - piece.Begin;
+    }
+
+    /* @NOTE: sendmsg is writev for sockets, it lets us ignore SIGPIPE when
+     * the peer is gone */
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = vectors;
+    message.msg_iovlen = count;
+
+    if ((size = sendmsg(_Socket, &message, MSG_NOSIGNAL)) > 0) {
+      _Output.Consume(size);
+      _Sent += size;
+
+      if (_Paused && _Output.Size() <= _Low) {
+        _Paused = False;
+
+        if (_Resume) {
+          _Resume(*this);
+        }
+      }
+    } else if (size < 0 && errno == EINTR) {
+      continue;
+    } else if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      /* @NOTE: the socket is full, we wait for EPOLLOUT. Fildes watches an
+       * fd for one direction only so we stop reading until then, which is
+       * what we want when the peer doesn't read its replies */
+      _Blocked = True;
+      error = _Monitor->Modify(Auto::As<Int>(_Socket), ELooping);
+      break;
+    } else {
+      error = EBadAccess;
+      break;
+    }
+  }
+
+  _Busy = busy;
+  return error;
+}
+
+UInt Connection::Reserve(Buffer::Chunk **tail, UInt *filled) {
+  /* @NOTE: when nobody uses the tail anymore, we fill it from the beginning
+   * again so a request-response connection keeps using the same hot chunk */
+  if (*tail && READ_ONCE((*tail)->Refs) == 1) {
+    *filled = 0;
+  }
+
+  if (!*tail || *filled == Buffer::Capacity()) {
+    if (*tail) {
+      Buffer::Unref(*tail);
+    }
+
+    *tail = Buffer::Take();
+    *filled = 0;
+  }
+
+  return Buffer::Capacity() - *filled;
+}
+
+ErrorCodeE Connection::OnReading(Bool *drained) {
+  ErrorCodeE error{ENoError};
+  Bool pending{False};
+  String data{};
+
+  /* @NOTE: io_uring has read some bytes already, they are copied once more
+   * into our chunks */
+  if (!_Monitor->Receive(Auto::As<Int>(_Socket), data)) {
+    ULong offset{0};
+
+    if (data.size() == 0) {
+      _Closed = True;
+    }
+
+    while (offset < data.size()) {
+      ULong size = data.size() - offset, room = Reserve(&_Tail, &_Filled);
+
+      if (size > room) {
+        size = room;
+      }
+
+      memcpy(_Tail->Data + _Filled, data.c_str() + offset, size);
+      _Input.Append(_Tail, _Filled, _Filled + size);
+
+      _Filled += size;
+      _Received += size;
+      offset += size;
+      pending = True;
+    }
+  }
+
+  /* @NOTE: the socket is watched edge-triggered, so we must read until it's
+   * empty or we won't be woken up again. A full chunk is given to the
+   * callback before we read more, otherwise a fast peer makes us keep
+   * everything it sends until it stops. We stop early when the output queue
+   * reaches its high watermark and tell the caller that we haven't drained
+   * the socket */
+  *drained = False;
+
+  while (!_Closed && !error && !_Paused) {
+    UInt room = Reserve(&_Tail, &_Filled);
+    Long size = read(_Socket, _Tail->Data + _Filled, room);
+
+    if (size > 0) {
+      _Input.Append(_Tail, _Filled, _Filled + size);
+      _Filled += size;
+      _Received += size;
+      pending = True;
+
+      if (_Filled == Buffer::Capacity()) {
+        error = _Receive(*this, _Input);
+        pending = False;
+      }
+    } else if (size == 0) {
+      _Closed = True;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      *drained = True;
+      break;
+    } else {
+      _Closed = True;
+    }
+  }
+
+  if (!error && (pending || _Closed)) {
+    error = _Receive(*this, _Input);
+  }
+
+  return error;
+}
+
+ErrorCodeE Connection::OnEvent() {
+  ErrorCodeE error{ENoError};
+  Bool blocked{_Blocked}, drained{False};
+
+  if (_Socket < 0) {
+    return EDoNothing;
+  }
+
+  /* @NOTE: we are called for EPOLLOUT too, what has been queued is sent
+   * first so the peer can read and we may read again */
+  _Busy = True;
+  _Blocked = False;
+
+  if (!blocked || !(error = Flush())) {
+    while (!error && !_Blocked && !drained && !_Closed) {
+      if (!(error = OnReading(&drained))) {
+        error = Flush();
+      }
+    }
+  }
+
+  _Busy = False;
+
+  /* @NOTE: returning an error makes the Monitor release the socket and close
+   * it, what we have queued has been sent as much as the socket could take.
+   * Our chunks are released here since the callback won't be called again */
+  if (_Closed || error) {
+    _Closed = True;
+    _Socket = -1;
+    _Input.Clear();
+    _Output.Clear();
+
+    if (_Tail) {
+      Buffer::Unref(_Tail);
+      _Tail = None;
+    }
+
+    if (_Outgoing) {
+      Buffer::Unref(_Outgoing);
+      _Outgoing = None;
+    }
+
+    return EDoNothing;
+  }
+
+  /* @NOTE: the poll switches an fd back to EPOLLIN when we return ENoError
+   * for EPOLLOUT, so we must keep it from doing that while we are still
+   * waiting. When the queue is empty, Fildes is told to read again */
+  if (_Blocked) {
+    return EKeepContinue;
+  } else if (blocked) {
+    return _Monitor->Modify(Auto::As<Int>(_Socket), EWaiting);
+  }
+
+  return ENoError;
+}
+} // namespace Base
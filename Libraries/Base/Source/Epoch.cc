@@ -0,0 +1,273 @@
+#include <Atomic.h>
+#include <Epoch.h>
+#include <Exception.h>
+#include <Logcat.h>
+#include <Macro.h>
+
+/* @NOTE: how many pointers should be retired before we try to collect them */
+#define COLLECT_STEP 64
+
+using TimeSpec = struct timespec;
+
+namespace Base {
+namespace Internal {
+void Idle(TimeSpec* spec);
+
+namespace Reclaim {
+struct Retired {
+  Void* Pointer;
+  void (*Release)(Void*);
+  ULong Epoch;
+};
+
+struct Batch {
+  Vector<Retired> Items;
+  Batch* Next;
+};
+
+struct Record {
+  /* @NOTE: State keeps the epoch observed by this record and the lowest bit
+   * tells if its owner is inside a critical section or not */
+  ULong State, Steps;
+  UInt Nested;
+  Bool Occupied;
+
+  Vector<Retired> Items;
+  Record* Next;
+};
+
+struct Owner {
+  Record* Self;
+
+  ~Owner();
+};
+
+static ULong Global{0};
+static ULong Pending{0};
+static Record* Records{None};
+static Batch* Orphans{None};
+
+thread_local Owner Current{None};
+
+Record* Acquire() {
+  Record* record = Current.Self;
+
+  if (record) {
+    return record;
+  }
+
+  /* @NOTE: records are never released, when a thread exits its record will be
+   * marked as free so the next thread can reuse it. With that, the chain of
+   * records only grows with the maximum number of threads running at the
+   * same time */
+
+  for (record = READ_ONCE(Records); record; record = record->Next) {
+    if (!READ_ONCE(record->Occupied) &&
+        CMPXCHG(&record->Occupied, False, True)) {
+      goto done;
+    }
+  }
+
+  record = new Record{};
+  record->Occupied = True;
+
+  do {
+    record->Next = READ_ONCE(Records);
+  } while (!CMPXCHG(&Records, record->Next, record));
+
+done:
+  Current.Self = record;
+  return record;
+}
+
+Bool Advance(ULong epoch) {
+  /* @NOTE: the global epoch can only move forward when every active record
+   * has observed it */
+
+  for (auto record = READ_ONCE(Records); record; record = record->Next) {
+    ULong state = READ_ONCE(record->State);
+
+    if ((state & 1) && (state >> 1) != epoch) {
+      return False;
+    }
+  }
+
+  return CMPXCHG(&Global, epoch, epoch + 1) || READ_ONCE(Global) != epoch;
+}
+
+ULong Drain(Vector<Retired>& items) {
+  ULong epoch{READ_ONCE(Global)}, count{0};
+  Vector<Retired> ready{};
+
+  /* @NOTE: pointers are retired in order so we only need to release the
+   * beginning part of this vector, the release callbacks might retire more
+   * pointers so we should move them out before calling */
+
+  while (count < items.size() && items[count].Epoch + 2 <= epoch) {
+    count++;
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  ready.assign(items.begin(), items.begin() + count);
+  items.erase(items.begin(), items.begin() + count);
+
+  for (auto& item : ready) {
+    item.Release(item.Pointer);
+  }
+
+  ADD(&Pending, -count);
+  return count;
+}
+
+void Adopt(Batch* batch) {
+  do {
+    batch->Next = READ_ONCE(Orphans);
+  } while (!CMPXCHG(&Orphans, batch->Next, batch));
+}
+
+Owner::~Owner() {
+  Record* record = Self;
+
+  if (!record) {
+    return;
+  }
+
+  /* @NOTE: the thread is exiting, pointers which can't be released yet will
+   * be moved to the orphan batches and they will be released by another
+   * thread later */
+
+  Advance(READ_ONCE(Global));
+  Drain(record->Items);
+
+  if (record->Items.size() > 0) {
+    Batch* batch = new Batch{};
+
+    batch->Items.swap(record->Items);
+    Adopt(batch);
+  }
+
+  record->Nested = 0;
+  record->Steps = 0;
+
+  WRITE_ONCE(record->State, 0);
+  WRITE_ONCE(record->Occupied, False);
+
+  Self = None;
+}
+} // namespace Reclaim
+} // namespace Internal
+
+Epoch::Guard::Guard() { Epoch::Enter(); }
+
+Epoch::Guard::~Guard() { Epoch::Leave(); }
+
+void Epoch::Enter() {
+  using namespace Internal::Reclaim;
+
+  Record* record = Acquire();
+
+  if (record->Nested++ == 0) {
+    WRITE_ONCE(record->State, (READ_ONCE(Global) << 1) | 1);
+    BARRIER();
+  }
+}
+
+void Epoch::Leave() {
+  using namespace Internal::Reclaim;
+
+  Record* record = Current.Self;
+
+  if (!record || record->Nested == 0) {
+    throw Except(EBadLogic, "leave an epoch without entering it");
+  }
+
+  if (--record->Nested == 0) {
+    BARRIER();
+    WRITE_ONCE(record->State, record->State & ~ULong(1));
+  }
+}
+
+void Epoch::Retire(Void* pointer, void (*release)(Void*)) {
+  using namespace Internal::Reclaim;
+
+  Record* record = Acquire();
+
+  if (!pointer || !release) {
+    return;
+  }
+
+  /* @NOTE: the pointer must be unlinked before we observe the global epoch,
+   * this barrier makes sure that nobody can see the pointer at the moment
+   * we tag it */
+
+  BARRIER();
+
+  record->Items.push_back(Retired{pointer, release, READ_ONCE(Global)});
+  INC(&Internal::Reclaim::Pending);
+
+  if (++record->Steps % COLLECT_STEP == 0) {
+    Collect();
+  }
+}
+
+ULong Epoch::Collect() {
+  using namespace Internal::Reclaim;
+
+  Record* record = Acquire();
+  Batch* batches = None;
+  ULong result = 0;
+
+  Advance(READ_ONCE(Global));
+  result += Drain(record->Items);
+
+  /* @NOTE: take every orphan batch at once so nobody else touches them and
+   * put back the ones which are still not safe to be released */
+
+  batches = ACK(&Orphans, None);
+
+  while (batches) {
+    Batch* next = batches->Next;
+
+    result += Drain(batches->Items);
+
+    if (batches->Items.size() > 0) {
+      Adopt(batches);
+    } else {
+      delete batches;
+    }
+
+    batches = next;
+  }
+
+  return result;
+}
+
+ErrorCodeE Epoch::Synchronize() {
+  using namespace Internal::Reclaim;
+
+  Record* record = Acquire();
+  ULong target = READ_ONCE(Global) + 2;
+  TimeSpec spec{.tv_sec = 0, .tv_nsec = 1};
+
+  if (record->Nested > 0) {
+    return BadLogic("can\'t synchronize inside a critical section").code();
+  }
+
+  /* @NOTE: moving the global epoch twice makes sure that every reader which
+   * was active when we were called has left its critical section */
+
+  while (READ_ONCE(Global) < target) {
+    if (!Advance(READ_ONCE(Global))) {
+      spec.tv_nsec = (spec.tv_nsec * 2) % ULong(1e6);
+      Internal::Idle(&spec);
+    }
+  }
+
+  return ENoError;
+}
+
+ULong Epoch::Pending() { return READ_ONCE(Internal::Reclaim::Pending); }
+}  // namespace Base
@@ -0,0 +1,386 @@
+#include <Atomic.h>
+#include <Epoch.h>
+#include <Exception.h>
+#include <Executor.h>
+#include <Logcat.h>
+#include <Macro.h>
+
+#include <limits.h>
+#include <unistd.h>
+
+namespace Base {
+namespace Internal {
+namespace Executing {
+/* @NOTE: the worker which runs on the current thread, it's used to detect
+ * if a task is submitted from inside a worker or not */
+thread_local Void* Current{None};
+} // namespace Executing
+
+Deque::Deque(ULong capacity) : _Top{0}, _Bottom{0}, _Array{None} {
+  ULong size = 1;
+
+  while (size < capacity) {
+    size <<= 1;
+  }
+
+  _Array = Build(size);
+}
+
+Deque::~Deque() {
+  Array* array = _Array;
+
+  delete[] array->Items;
+  delete array;
+}
+
+Deque::Array* Deque::Build(ULong capacity) {
+  Array* result = new Array{};
+
+  result->Mask = capacity - 1;
+  result->Items = new Task*[capacity];
+  return result;
+}
+
+void Deque::Release(Void* pointer) {
+  Array* array = (Array*)pointer;
+
+  delete[] array->Items;
+  delete array;
+}
+
+void Deque::Push(Task* task) {
+  Long bottom{READ_ONCE(_Bottom)}, top{READ_ONCE(_Top)};
+  Array* array{_Array};
+
+  if (bottom - top > Long(array->Mask)) {
+    Array* bigger = Build((array->Mask + 1) * 2);
+
+    /* @NOTE: copy the waiting tasks to the new array at the same positions,
+     * thieves which still see the old array read the same tasks there so we
+     * only need to retire it */
+
+    for (Long i = top; i < bottom; ++i) {
+      bigger->Items[i & bigger->Mask] = array->Items[i & array->Mask];
+    }
+
+    BARRIER();
+    WRITE_ONCE(_Array, bigger);
+
+    Epoch::Retire(array, Deque::Release);
+    array = bigger;
+  }
+
+  array->Items[bottom & array->Mask] = task;
+  BARRIER();
+  WRITE_ONCE(_Bottom, bottom + 1);
+}
+
+Deque::Task* Deque::Take() {
+  Long bottom{READ_ONCE(_Bottom) - 1}, top{0};
+  Array* array{_Array};
+  Task* result{None};
+
+  /* @NOTE: reserve the last task first, the barrier makes sure that thieves
+   * see the new bottom before we read top */
+
+  WRITE_ONCE(_Bottom, bottom);
+  BARRIER();
+  top = READ_ONCE(_Top);
+
+  if (top <= bottom) {
+    result = array->Items[bottom & array->Mask];
+
+    if (top == bottom) {
+      /* @NOTE: this is the last task, a thief might try to steal it at the
+       * same time so we must win the race on top */
+
+      if (!CMPXCHG(&_Top, top, top + 1)) {
+        result = None;
+      }
+
+      WRITE_ONCE(_Bottom, bottom + 1);
+    }
+  } else {
+    WRITE_ONCE(_Bottom, bottom + 1);
+  }
+
+  return result;
+}
+
+Deque::Task* Deque::Steal() {
+  Epoch::Guard guard{};
+  Long top{READ_ONCE(_Top)}, bottom{0};
+  Task* result{None};
+
+  BARRIER();
+  bottom = READ_ONCE(_Bottom);
+
+  if (top < bottom) {
+    Array* array = READ_ONCE(_Array);
+
+    result = array->Items[top & array->Mask];
+
+    if (!CMPXCHG(&_Top, top, top + 1)) {
+      return None;
+    }
+  }
+
+  return result;
+}
+
+ULong Deque::Size() {
+  Long size = READ_ONCE(_Bottom) - READ_ONCE(_Top);
+
+  return size > 0 ? size : 0;
+}
+} // namespace Internal
+
+struct Executor::Worker {
+  Internal::Deque Tasks;
+  Statistic Counters;
+  Base::Thread Self;
+  Executor* Owner;
+  ULong Started, Seed;
+  UInt Index;
+
+  Worker(Executor* owner, UInt index)
+      : Tasks{}, Counters{0, 0, 0, 0, 0, 0}, Self{}, Owner{owner}, Started{0},
+        Seed{ULong(index) * 0x9e3779b97f4a7c15ULL + 1}, Index{index} {}
+
+  /* @NOTE: a tiny xorshift is enough to pick victims randomly */
+  ULong Random() {
+    Seed ^= Seed << 13;
+    Seed ^= Seed >> 7;
+    Seed ^= Seed << 17;
+
+    return Seed;
+  }
+};
+
+Executor::Executor(UInt workers)
+    : _Workers{}, _Shared{}, _Signal{0}, _Sleepers{0}, _Idle{0}, _Waiters{0},
+      _Pending{0}, _Running{True} {
+  if (workers == 0) {
+    Long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    workers = online > 0 ? UInt(online) : 1;
+  }
+
+  for (UInt i = 0; i < workers; ++i) {
+    _Workers.push_back(new Worker(this, i));
+  }
+
+  /* @NOTE: workers are started after every one is created since they steal
+   * tasks from each other */
+
+  for (auto worker : _Workers) {
+    if (!worker->Self.Start([this, worker]() { Run(worker); })) {
+      throw Except(EBadLogic, "can\'t start a worker");
+    }
+  }
+}
+
+Executor::~Executor() {
+  Wait();
+
+  WRITE_ONCE(_Running, False);
+  INC(&_Signal);
+  Internal::Wake(&_Signal, INT_MAX);
+
+  /* @NOTE: deleting a worker joins its thread */
+
+  for (auto worker : _Workers) {
+    delete worker;
+  }
+}
+
+ErrorCodeE Executor::Submit(Task task) {
+  Worker* worker = (Worker*)Internal::Executing::Current;
+  Task* item{None};
+
+  if (!READ_ONCE(_Running)) {
+    return BadLogic("can\'t submit a task while the executor is stopping")
+        .code();
+  } else if (!task) {
+    return BadLogic("submit an empty task").code();
+  }
+
+  item = new Task(std::move(task));
+  INC(&_Pending);
+
+  /* @NOTE: a task which is submitted by a worker stays in the worker's deque
+   * so it's likely done by the same worker, the others only take it when
+   * they have nothing to do */
+
+  if (worker && worker->Owner == this) {
+    worker->Tasks.Push(item);
+    worker->Counters.Submitted++;
+  } else if (!_Shared.Put(item)) {
+    DEC(&_Pending);
+    delete item;
+
+    return DrainMem("can\'t put the task to the shared queue").code();
+  }
+
+  Signal();
+  return ENoError;
+}
+
+ErrorCodeE Executor::Wait(Double timeout) {
+  Worker* worker = (Worker*)Internal::Executing::Current;
+  ULong begin{Internal::Monotonic()};
+
+  if (worker && worker->Owner == this) {
+    return BadLogic("can\'t wait for the executor inside its worker").code();
+  }
+
+  while (True) {
+    UInt idle{READ_ONCE(_Idle)};
+    Long remain{-1};
+
+    if (READ_ONCE(_Pending) == 0) {
+      break;
+    } else if (timeout >= 0.0) {
+      remain = Long(timeout * 1e9) - Long(Internal::Monotonic() - begin);
+
+      if (remain <= 0) {
+        return EDoAgain;
+      }
+    }
+
+    INC(&_Waiters);
+    Internal::Park(&_Idle, idle, remain);
+    DEC(&_Waiters);
+  }
+
+  return ENoError;
+}
+
+Executor::Statistic Executor::Statistics(UInt index) {
+  Statistic result{0, 0, 0, 0, 0, 0};
+
+  if (index < _Workers.size()) {
+    Statistic& counters = _Workers[index]->Counters;
+
+    result.Submitted = READ_ONCE(counters.Submitted);
+    result.Executed = READ_ONCE(counters.Executed);
+    result.Stolen = READ_ONCE(counters.Stolen);
+    result.Injected = READ_ONCE(counters.Injected);
+    result.Failed = READ_ONCE(counters.Failed);
+    result.Parked = READ_ONCE(counters.Parked);
+  }
+
+  return result;
+}
+
+Vector<UInt> Executor::Stucks(Double threshold) {
+  ULong now{Internal::Monotonic()};
+  Vector<UInt> result{};
+
+  for (auto worker : _Workers) {
+    ULong started = READ_ONCE(worker->Started);
+
+    if (started > 0 && now > started && (now - started) / 1e9 >= threshold) {
+      result.push_back(worker->Index);
+    }
+  }
+
+  return result;
+}
+
+UInt Executor::Size() { return _Workers.size(); }
+
+ULong Executor::Pending() { return READ_ONCE(_Pending); }
+
+void Executor::Run(Worker* worker) {
+  Internal::Executing::Current = worker;
+
+  while (True) {
+    UInt signal{READ_ONCE(_Signal)};
+    Task* task{Find(worker)};
+
+    if (task) {
+      WRITE_ONCE(worker->Started, Internal::Monotonic());
+
+      try {
+        (*task)();
+      } catch (Base::Exception& except) {
+        worker->Counters.Failed++;
+      } catch (std::exception& except) {
+        worker->Counters.Failed++;
+      } catch (...) {
+        worker->Counters.Failed++;
+      }
+
+      WRITE_ONCE(worker->Started, 0);
+      worker->Counters.Executed++;
+      delete task;
+
+      /* @NOTE: wake up everyone who is waiting for the executor to be idle */
+
+      if (DEC(&_Pending) == 0) {
+        INC(&_Idle);
+
+        if (READ_ONCE(_Waiters) > 0) {
+          Internal::Wake(&_Idle, INT_MAX);
+        }
+      }
+    } else if (!READ_ONCE(_Running)) {
+      break;
+    } else {
+      /* @NOTE: the signal is read before finding, so if a task is submitted
+       * after that Park returns immediately */
+
+      worker->Counters.Parked++;
+
+      INC(&_Sleepers);
+      Internal::Park(&_Signal, signal, -1);
+      DEC(&_Sleepers);
+    }
+  }
+
+  Internal::Executing::Current = None;
+}
+
+Executor::Task* Executor::Find(Worker* worker) {
+  ULong size{_Workers.size()}, begin{0}, id{0};
+  Task* result{None};
+
+  if ((result = worker->Tasks.Take())) {
+    return result;
+  }
+
+  if ((id = _Shared.Get(result))) {
+    _Shared.Done(id);
+    worker->Counters.Injected++;
+
+    return result;
+  }
+
+  /* @NOTE: steal from randomized victims, every victim is visited once so a
+   * busy worker isn't hammered by every thief at the same time */
+
+  begin = worker->Random() % size;
+
+  for (ULong i = 0; i < size; ++i) {
+    Worker* victim = _Workers[(begin + i) % size];
+
+    if (victim == worker) {
+      continue;
+    } else if ((result = victim->Tasks.Steal())) {
+      worker->Counters.Stolen++;
+      return result;
+    }
+  }
+
+  return None;
+}
+
+void Executor::Signal() {
+  INC(&_Signal);
+
+  if (READ_ONCE(_Sleepers) > 0) {
+    Internal::Wake(&_Signal, 1);
+  }
+}
+} // namespace Base
@@ -1,13 +1,23 @@
 #include <Atomic.h>
+#include <Epoch.h>
 #include <Exception.h>
+#include <Hashtable.h>
 #include <Macro.h>
 #include <Monitor.h>
 #include <Logcat.h>
 #include <Lock.h>
 #include <Vertex.h>
+#include <Wheel.h>
 
+#if LINUX
+#include <sys/timerfd.h>
+#endif
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <new>
+
 #define INIT 0
 #define IDLE 1
 #define RUNNING 2
@@ -37,6 +47,7 @@ typedef struct Pool {
   Int (*Flush)(Void* ptr, Int socket);
   Int (*Run)(struct Pool*, Int, Int);
   Void* (*Build)(struct Pool* pool); 
+  Int (*Receive)(Void* ptr, Int socket, Char** data);
 } Pool;
 
 enum Mode {
@@ -49,6 +60,7 @@ typedef Int (*Handler)(Pool*, Int, Int);
 
 #if LINUX
 Handler EPoll(Pool* pool, Int backlog);
+Handler URing(Pool* pool, Int backlog);
 Handler Poll(Pool* pool);
 Handler Select(Pool* pool);
 #elif MACOS || BSD
@@ -69,6 +81,8 @@ static Vertex<Mutex, True> Secure([](Mutex* mutex) { Locker::Lock(*mutex); },
                                   [](Mutex* mutex) { Locker::Unlock(*mutex); },
                                   CreateMutex());
 void Idle(TimeSpec* spec);
+ErrorCodeE Park(UInt* address, UInt expected, Long timeout);
+void Wake(UInt* address, Int count);
 Bool IsPipeAlive(Int pipe);
 Bool IsPipeWaiting(Int pipe);
 ULong GetUniqueId();
@@ -88,7 +102,9 @@ class Fildes: public Monitor {
 #else
   explicit Fildes(String name, UInt type, Int system) :
 #endif
-      Monitor(name, type), _Tid{-1} {
+      Monitor(name, type), _Slots(EMaxFd >> ESlotBits, None), _Tid{-1},
+      _First{0}, _Worker{0}, _Armed{~0ULL}, _Count{0}, _Pending{0},
+      _Signal{0}, _Current{-1}, _Clock{-1}, _Wheel{Milliseconds()} {
     using namespace std::placeholders;  // for _1, _2, _3...
 
     TimeSpec spec{.tv_sec=0, .tv_nsec=0};
@@ -162,6 +178,22 @@ class Fildes: public Monitor {
             _Pool.Run = Select(&_Pool);
 #else
             throw Except(ENoSupport, "");
+#endif
+            break;
+
+          case 3:
+#if LINUX
+            /* @NOTE: io_uring may be missing or disabled, epoll does the same
+             * job except that callbacks must read the data by themselves */
+
+            if (!(_Pool.Run = URing(&_Pool, backlog))) {
+              DEBUG("io_uring isn\'t supported, fallback to epoll");
+
+              memset(&_Pool.ll, 0, sizeof(_Pool.ll));
+              _Pool.Run = EPoll(&_Pool, backlog);
+            }
+#else
+            throw Except(ENoSupport, "");
 #endif
             break;
           }
@@ -186,8 +218,12 @@ class Fildes: public Monitor {
             _Pool.ll = pool->ll;
             _Pool.Run = pool->Run;
             _Pool.Build = pool->Build;
+            _Pool.Receive = pool->Receive;
 
-            if (!_Pool.ll.Append || !_Pool.ll.Modify || !_Pool.ll.Probe) {
+            /* @NOTE: Probe is optional, epoll doesn't have it and Flush
+             * checks our callbacks instead */
+
+            if (!_Pool.ll.Append || !_Pool.ll.Modify) {
               need_retry = True;
             } else {
               DEBUG(Format("Mitigate lowlevel with referral {}").Apply(
@@ -238,16 +274,55 @@ class Fildes: public Monitor {
      * event -> callbacks */
     Registry(std::bind(&Fildes::OnChecking, this, _1, _2, _3),
              std::bind(&Fildes::OnSelecting, this, _1, _2));
+
+#if LINUX
+    if (type == Monitor::ETimer) {
+      /* @NOTE: timers are kept inside our wheel and a single timerfd wakes
+       * the polling system up when the earliest of them is due */
+
+      _Clock = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+      if (_Clock < 0) {
+        throw Except(EBadAccess, "can\'t create timerfd");
+      } else if (_Append(Auto::As<Int>(_Clock), EWaiting)) {
+        close(_Clock);
+        throw Except(EBadAccess, "can\'t watch timerfd");
+      }
+
+      Watch(_Clock, std::bind(&Fildes::OnTicking, this, _1, _2));
+    }
+#endif
   }
 
   ~Fildes() {
     TimeSpec spec{.tv_sec=0, .tv_nsec=0};
 
+    /* @NOTE: our timerfd lives inside the shared polling system, it must be
+     * removed before we leave since HEAD can't release a poll which still
+     * has fds */
+    if (_Clock >= 0) {
+      if (_Pool.ll.Release(&_Pool, _Clock)) {
+        close(_Clock);
+      }
+
+      Drop(_Clock);
+    }
+
     while (!Detach()) {
+      /* @NOTE: jobs which were routed to us keep us claimed, run them here
+       * since our Loop might have stopped already */
+      _Flush();
+
       spec.tv_nsec = (spec.tv_nsec * 2) % ULong(1e9);
 
       Internal::Idle(&spec);
     }
+
+    for (auto page: _Slots) {
+      if (page) {
+        Release(page);
+      }
+    }
   }
 
  protected:
@@ -278,8 +353,8 @@ class Fildes: public Monitor {
             return error;
           }
 
-          _Read[fork.Output()] = perform;
-          _Read[fork.Error()] = perform;
+          Watch(fork.Output(), perform);
+          Watch(fork.Error(), perform);
           return ENoError;
         } else {
           return BadAccess("fork can\'t create process as expected").code();
@@ -289,10 +364,11 @@ class Fildes: public Monitor {
           return error;
         }
 
-        _Read[event.Get<Int>()] = perform;
+        Watch(event.Get<Int>(), perform);
         return ENoError;
       }
-    } else if (_Type == Monitor::EIOSync) {
+    } else if (_Type == Monitor::EIOSync || _Type == Monitor::EIOUring ||
+               (_Type >= Monitor::EShard && _Type <= Monitor::ELastShard)) {
       /* @NOTE: if we are monitoring socket, we don't need to register anything
        * more to help to watch our sockets because the polling system should
        * detect when a socket is closed or not */
@@ -302,18 +378,41 @@ class Fildes: public Monitor {
           return error;
         }
 
-        _Read[event.Get<Int>()] = perform;
+        Watch(event.Get<Int>(), perform);
         return ENoError;
       }
+    } else if (_Type == Monitor::ETimer) {
+      /* @NOTE: timers don't have fds, their callbacks receive the id of the
+       * timer instead */
+
+      if (event.Type() == typeid(Monitor::Timer)) {
+        return Schedule(event.Get<Monitor::Timer>(), perform);
+      }
     }
 
     return ENoSupport;
   }
 
   /* @NOTE: this function is used to enqueue callback into our pipeline, waiting
-   * to be handled asynchronously */
-  ErrorCodeE _Route(Auto UNUSED(fd), Perform& UNUSED(callback)) {
-    return ENoSupport;
+   * to be handled asynchronously. A child keeps the callbacks of its own fds,
+   * HEAD hands its callbacks to a child and runs them itself only when no
+   * child can take them */
+  ErrorCodeE _Route(Auto& fd, Perform& callback) final {
+    Int socket = fd.Get<Int>();
+
+    if (!Owns(socket)) {
+      return NotFound(Format{"fd {}"} << socket).code();
+    }
+
+    Job job{socket, callback, Context(socket), this};
+
+    if (Head() == dynamic_cast<Monitor*>(this)) {
+      return Dispatch(job);
+    } else if (Enqueue(job)) {
+      return ENoSupport;
+    }
+
+    return ENoError;
   }
 
   /* @NOTE: this function is used to append a new fd to polling system */
@@ -325,18 +424,25 @@ class Fildes: public Monitor {
     }
 
     try {
+      Slot* slot{None};
+
       if (fd.Get<Int>() < 0) {
         return BadLogic("fd shouldn\'t be negative").code();
-      } else if (_Entries.find(fd) != _Entries.end()) {
+      } else if (!(slot = Locate(fd.Get<Int>(), True))) {
+        return OutOfRange(Format{"fd {} is too large"} << fd).code();
+      } else if (slot->State & EOwned) {
         return BadLogic(Format{"duplicate fd {}"} << fd).code();
       } else {
-        auto error = _Pool.ll.Append(_Pool.ll.Poll, fd.Get<Int>(), mode);
+        auto error = _Pool.ll.Append(_Pool.ll.Poll, fd.Get<Int>(),
+                                     Lower(mode));
 
         if (error) {
           return (ErrorCodeE) error;
         }
 
-        _Entries[fd.Get<Int>()] = Auto{};
+        slot->State = EOwned;
+
+        INC(&_Count);
         return ENoError;
       }
     } catch(Base::Exception& except) {
@@ -355,20 +461,25 @@ class Fildes: public Monitor {
 
     try {
       if (mode != ERelease) {
-        Int error = _Pool.ll.Modify(_Pool.ll.Poll, fd.Get<Int>(), mode);
+        Int error = _Pool.ll.Modify(_Pool.ll.Poll, fd.Get<Int>(),
+                                    Lower(mode));
 
         if (error) {
           return (ErrorCodeE) error;
         }
 
-        if (mode == ELooping && _Read.find(fd.Get<Int>()) != _Read.end()) {
-          _Write[fd.Get<Int>()] = _Read[fd.Get<Int>()];
-          _Read.erase(fd.Get<Int>());
+        mode &= ~Monitor::EDirect;
+
+        /* @NOTE: the callback stays where it is, only the mode which it's
+         * called on is changed */
+        Slot* slot = Locate(fd.Get<Int>());
+
+        if (slot && mode == ELooping && (slot->State & EReading)) {
+          slot->State = (slot->State & ~EReading) | EWriting;
         }
 
-        if (mode == EWaiting && _Write.find(fd.Get<Int>()) != _Write.end()) {
-          _Read[fd.Get<Int>()] = _Write[fd.Get<Int>()];
-          _Write.erase(fd.Get<Int>());
+        if (slot && mode == EWaiting && (slot->State & EWriting)) {
+          slot->State = (slot->State & ~EWriting) | EReading;
         }
 
         return (ErrorCodeE) error;
@@ -381,9 +492,14 @@ class Fildes: public Monitor {
   }
 
   /* @NOTE: this function is used to find the fd inside Fildes */
-  ErrorCodeE _Find(Auto fd) final {
+  ErrorCodeE _Find(Auto& fd) final {
     try {
-      if (_Entries.find(fd.Get<Int>()) == _Entries.end()) {
+      if (IsTimer(fd)) {
+        Bool found{False};
+
+        _Timing.Safe([&]() { found = _Timers.Find(fd.Get<ULong>()) != None; });
+        return found? ENoError: ENotFound;
+      } else if (!Owns(fd.Get<Int>())) {
         return ENotFound;
       }
 
@@ -396,12 +512,27 @@ class Fildes: public Monitor {
   /* @NOTE: this function is used to remove fd out of polling system */
   ErrorCodeE _Remove(Auto fd) final {
     try {
+      if (IsTimer(fd)) {
+        ErrorCodeE error{ENotFound};
+
+        /* @NOTE: a one-shot timer which is firing has left _Timers already,
+         * so it's too late to cancel it */
+        _Timing.Safe([&]() {
+          ULong* handle = _Timers.Find(fd.Get<ULong>());
+
+          if (handle && !(error = _Wheel.Cancel(*handle))) {
+            _Timers.Del(fd.Get<ULong>());
+          }
+        });
+
+        return error;
+      }
+
       DEBUG(Format{"remove fd {}"}.Apply(fd));
 
-      _Entries.erase(fd.Get<Int>());
-      _Read.erase(fd.Get<Int>());
-      _Write.erase(fd.Get<Int>());
+      Drop(fd.Get<Int>());
 
+      Purge(fd.Get<Int>(), Head() == dynamic_cast<Monitor*>(this));
       return ENoError;
     } catch(Base::Exception& except) {
       return except.code();
@@ -416,7 +547,7 @@ class Fildes: public Monitor {
         /* @NOTE: state online only happens when fd is set and i will check
          * if the fd is existed inside the monitor or not */
 
-        if (_Entries.find(fd.Get<Int>()) != _Entries.end()) {
+        if (Owns(fd.Get<Int>())) {
           return ENoError;
         }
       } else if (fd.Get<Int>() >= 0) {
@@ -452,13 +583,13 @@ class Fildes: public Monitor {
       /* @NOTE: state idle would mean we don't have any fd waiting or working
        * from another side */
 
-      if (_Entries.size() > 0) {
+      if (READ_ONCE(_Count) > 0) {
         return EInterrupted;
       } else {
         ErrorCodeE result{ENoError};
 
         ForEach([&](Monitor* next) -> ErrorCodeE {
-          if (dynamic_cast<Fildes*>(next)->_Entries.size() > 0) {
+          if (READ_ONCE(dynamic_cast<Fildes*>(next)->_Count) > 0) {
             result = EInterrupted;
           }
 
@@ -473,12 +604,28 @@ class Fildes: public Monitor {
   }
 
   /* @NOTE: access context of each fd */
-  Auto& _Access(Auto fd) {
+  Auto& _Access(Auto& fd) {
     if (_Find(fd)) {
       throw Except(ENotFound, ToString(fd.Get<Int>()));
     }
 
-    return _Entries[fd.Get<Int>()];
+    return Context(fd.Get<Int>());
+  }
+
+  /* @NOTE: take what io_uring has read for a fd */
+  ErrorCodeE _Receive(Auto& fd, String& data) final {
+    Slot* slot = Locate(fd.Get<Int>());
+    String* received{None};
+
+    if (!slot || !(received = __atomic_exchange_n(&slot->Received,
+                                                  (String*)None,
+                                                  __ATOMIC_ACQ_REL))) {
+      return ENotFound;
+    }
+
+    data = std::move(*received);
+    delete received;
+    return ENoError;
   }
 
   /* @NOTE: this method is used to interact with lowlevel */
@@ -508,7 +655,10 @@ class Fildes: public Monitor {
       }
 
       if (fildes->_Pool.Status == INTERRUPTED) {
-        if (_Entries.size() == 0) {
+        /* @NOTE: fds of children are polled by us too, so we are only idle
+         * when nobody has anything to wait */
+
+        if (_Status("idle", Auto::As<Int>(-1)) == ENoError) {
           fildes->_Pool.Status = IDLE;
         }
       }
@@ -519,45 +669,512 @@ class Fildes: public Monitor {
     }
   }
 
-  ErrorCodeE _Handle(Monitor* UNUSED(child), Int UNUSED(timeout),
-                     Int UNUSED(backlog) = 100) final {
-    return ENoSupport;
+  /* @NOTE: this method is used by children to run the callbacks which HEAD
+   * has routed to them, it waits `timeout` milliseconds for new jobs like
+   * epoll_wait does and runs at most `backlog` of them */
+  ErrorCodeE _Handle(Monitor* child, Int timeout, Int backlog = 100) final {
+    Fildes* fildes = dynamic_cast<Fildes*>(child);
+
+    if (!fildes) {
+      return BadLogic("child should be Fildes").code();
+    } else if (fildes->Drain(backlog) == 0 && timeout != 0) {
+      UInt signal = READ_ONCE(fildes->_Signal);
+
+      /* @NOTE: check again after reading the signal, a job which comes
+       * after this point changes the signal so Park won't sleep */
+
+      if (fildes->Drain(backlog) == 0) {
+        Internal::Park(&fildes->_Signal, signal,
+                       timeout < 0? -1: Long(timeout)*1000000);
+        fildes->Drain(backlog);
+      }
+    }
+
+    return ENoError;
   }
 
  private:
+  /* @NOTE: a job which is routed to a child, the callback and the context
+   * are copied from the Monitor which owns the fd since the owner may remove
+   * the fd, e.g. on a heartbeat, while the job is still waiting */
+  struct Job {
+    Int Fd;
+    Perform Callback;
+    Auto Context;
+    Fildes* Owner;
+  };
+
+  /* @NOTE: everything which is used on every event of a fd fits in one cache
+   * line. The context is big and every live Auto makes Refcount slower, so
+   * it's allocated only when a callback of the fd needs it. State tells if
+   * we own the fd and which mode its callback is called on, Route is the
+   * child which runs its callbacks and Received keeps what io_uring has read
+   * until a callback takes it */
+  struct alignas(64) Slot {
+    Byte State;
+    Fildes* Route;
+    Perform Callback;
+    Auto* Context;
+    String* Received;
+  };
+
+  enum SlotStateE { EOwned = 1, EReading = 2, EWriting = 4 };
+
+  /* @NOTE: slots are indexed by fd and allocated by pages which never move,
+   * so pointers to slots stay valid while fds are added by other threads.
+   * Pages are aligned by hand since new doesn't respect alignas before C++17 */
+  enum { ESlotBits = 8, ESlotPage = 1 << ESlotBits, EMaxFd = 1 << 20 };
+
+  /* @NOTE: find the slot of a fd, its page is allocated if `create` is set */
+  Slot* Locate(Int fd, Bool create = False) {
+    Slot* page;
+
+    if (fd < 0 || fd >= EMaxFd) {
+      return None;
+    } else if (!(page = READ_ONCE(_Slots[fd >> ESlotBits])) && create) {
+      Void* memory{None};
+
+      if (posix_memalign(&memory, sizeof(Slot), ESlotPage*sizeof(Slot))) {
+        throw Except(EDrainMem, "can\'t allocate slots");
+      }
+
+      page = (Slot*)memory;
+
+      for (UInt i = 0; i < ESlotPage; ++i) {
+        new (&page[i]) Slot{};
+      }
+
+      if (!CMPXCHG(&_Slots[fd >> ESlotBits], (Slot*)None, page)) {
+        Release(page);
+        page = READ_ONCE(_Slots[fd >> ESlotBits]);
+      }
+    }
+
+    return page? &page[fd & (ESlotPage - 1)]: None;
+  }
+
+  static void Release(Slot* page) {
+    for (UInt i = 0; i < ESlotPage; ++i) {
+      delete page[i].Context;
+      delete page[i].Received;
+      page[i].~Slot();
+    }
+
+    free(page);
+  }
+
+  Bool Owns(Int fd) {
+    Slot* slot = Locate(fd);
+
+    return slot && (slot->State & EOwned);
+  }
+
+  Auto& Context(Int fd) {
+    Slot* slot = Locate(fd, True);
+
+    if (!READ_ONCE(slot->Context)) {
+      Auto* context = new Auto{};
+
+      /* @NOTE: HEAD may set the context of a child's fd while the child is
+       * reading it */
+      if (!CMPXCHG(&slot->Context, (Auto*)None, context)) {
+        delete context;
+      }
+    }
+
+    return *slot->Context;
+  }
+
+  /* @NOTE: keep what io_uring has read until a callback takes it, data which
+   * hasn't been taken yet is kept in front of it. We are the only writer,
+   * a callback which finds nothing here is called again after we return */
+  void Deliver(Int fd, Char* data, Int size) {
+    Slot* slot = Locate(fd, True);
+    String* received = __atomic_exchange_n(&slot->Received, (String*)None,
+                                           __ATOMIC_ACQ_REL);
+
+    if (received) {
+      received->append(data, size);
+    } else {
+      received = new String(data, size);
+    }
+
+    __atomic_store_n(&slot->Received, received, __ATOMIC_RELEASE);
+  }
+
+  /* @NOTE: a mode without the flags which our polling system doesn't know */
+  Int Lower(Int mode) {
+    return _Pool.Receive? mode: (mode & ~Monitor::EDirect);
+  }
+
+  /* @NOTE: install the callback which is called when a fd is readable */
+  void Watch(Int fd, Perform perform) {
+    Slot* slot = Locate(fd, True);
+
+    slot->Callback = perform;
+    slot->State = (slot->State & ~EWriting) | EReading;
+  }
+
+  /* @NOTE: forget everything about a fd */
+  void Drop(Int fd) {
+    Slot* slot = Locate(fd);
+
+    if (slot) {
+      if (slot->State & EOwned) {
+        DEC(&_Count);
+      }
+
+      delete slot->Context;
+      delete __atomic_exchange_n(&slot->Received, (String*)None,
+                                 __ATOMIC_ACQ_REL);
+
+      slot->Context = None;
+      slot->State = 0;
+      slot->Route = None;
+      slot->Callback = None;
+    }
+  }
+
+  /* @NOTE: a timer which is kept inside our wheel */
+  struct Alarm {
+    ULong Id;
+    Perform Callback;
+    Bool Periodic;
+  };
+
+  /* @NOTE: the monotonic clock in milliseconds, it's the tick of our wheel */
+  static ULong Milliseconds() {
+    TimeSpec spec;
+
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return ULong(spec.tv_sec)*1000 + ULong(spec.tv_nsec)/1000000;
+  }
+
+  Bool IsTimer(Auto& fd) {
+    return _Type == Monitor::ETimer && fd != nullptr &&
+           fd.Type() == typeid(ULong);
+  }
+
+  /* @NOTE: put a timer to our wheel. The expiry is rounded up to a multiple
+   * of the largest power of 2 which fits inside the slack, so timers which are
+   * close to each other share their tick and wake us up only once */
+  ErrorCodeE Schedule(Monitor::Timer timer, Perform& perform) {
+    ErrorCodeE error{ENoError};
+    ULong expiry = Milliseconds() + timer.Delay;
+
+    if (_Clock < 0) {
+      return BadAccess("timerfd isn\'t ready").code();
+    } else if (timer.Slack > 0) {
+      ULong align = 1ULL << (63 - __builtin_clzll(timer.Slack));
+
+      expiry = (expiry + align - 1) & ~(align - 1);
+    }
+
+    _Timing.Safe([&]() {
+      if (_Timers.Find(timer.Id)) {
+        error = BadLogic(Format{"duplicate timer {}"}.Apply(timer.Id)).code();
+      } else {
+        ULong handle = _Wheel.Put(expiry,
+                                  Alarm{timer.Id, perform, timer.Period > 0},
+                                  timer.Period);
+
+        _Timers.Put(ULong{timer.Id}, ULong{handle});
+
+        if (expiry < _Armed) {
+          Rearm();
+        }
+      }
+    });
+
+    return error;
+  }
+
+  /* @NOTE: arm our timerfd to the tick when the wheel has something to do,
+   * it must be called while _Timing is locked */
+  void Rearm() {
+#if LINUX
+    struct itimerspec spec;
+    ULong next = _Wheel.Next();
+
+    if (next == _Armed) {
+      return;
+    }
+
+    memset(&spec, 0, sizeof(spec));
+
+    if (next != ~0ULL) {
+      spec.it_value.tv_sec = next/1000;
+      spec.it_value.tv_nsec = (next % 1000)*1000000;
+    }
+
+    if (!timerfd_settime(_Clock, TFD_TIMER_ABSTIME, &spec, None)) {
+      _Armed = next;
+    }
+#endif
+  }
+
+  /* @NOTE: this callback is called when our timerfd expires, callbacks of the
+   * timers which are due are collected inside the lock and run outside of it
+   * so they can put or remove timers */
+  ErrorCodeE OnTicking(Auto UNUSED(fd), Auto& UNUSED(context)) {
+    Vector<Pair<ULong, Alarm>> fired{};
+    ULong expirations{0};
+
+    while (read(_Clock, &expirations, sizeof(expirations)) > 0) {}
+
+    _Timing.Safe([&]() {
+      _Wheel.Advance(Milliseconds(), [&](ULong handle, Alarm& alarm) {
+        if (!alarm.Periodic) {
+          _Timers.Del(alarm.Id);
+        }
+
+        fired.push_back(Pair<ULong, Alarm>(handle, alarm));
+      });
+
+      _Armed = ~0ULL;
+      Rearm();
+    });
+
+    for (auto& item: fired) {
+      ErrorCodeE error{ENoError};
+      Auto context{};
+
+      try {
+        error = item.Right.Callback(Auto::As<ULong>(item.Right.Id), context);
+      } catch (Base::Exception& except) {
+        error = except.code();
+      }
+
+      /* @NOTE: a periodic timer stops when its callback fails */
+      if (error && item.Right.Periodic) {
+        _Timing.Safe([&]() {
+          if (!_Wheel.Cancel(item.Left)) {
+            _Timers.Del(item.Right.Id);
+          }
+        });
+      }
+    }
+
+    return ENoError;
+  }
+
+  /* @NOTE: HEAD picks a child for its own fd. A fd sticks to the child which
+   * took it first so its callbacks never run on 2 threads at the same time,
+   * new fds go to the child which has the fewest pending jobs */
+  ErrorCodeE Dispatch(Job& job) {
+    Epoch::Guard guard{};
+    Fildes *sticky{None}, *least{None}, *target{None};
+    Slot* slot = Locate(job.Fd);
+
+    ForEach([&](Monitor* next) -> ErrorCodeE {
+      Fildes* child = dynamic_cast<Fildes*>(next);
+
+      if (!child) {
+        return ENoError;
+      } else if (slot && slot->Route == child) {
+        sticky = child;
+      }
+
+      if (!least || READ_ONCE(child->_Pending) < READ_ONCE(least->_Pending)) {
+        least = child;
+      }
+
+      return ENoError;
+    });
+
+    /* @NOTE: children can't be released while we are inside the guard, so
+     * the pointers above are still valid even if they are leaving */
+
+    if (!(target = sticky? sticky: least)) {
+      return ENoSupport;
+    } else if (target->Enqueue(job)) {
+      if (slot) {
+        slot->Route = None;
+      }
+
+      return ENoSupport;
+    }
+
+    if (slot) {
+      slot->Route = target;
+    }
+
+    return ENoError;
+  }
+
+  /* @NOTE: put a job to our run queue, we and the owner are claimed until the
+   * job is done so neither of us can be detached while it's waiting */
+  ErrorCodeE Enqueue(Job& job) {
+    if (Claim()) {
+      return EBadAccess;
+    } else if (job.Owner != this && job.Owner->Claim()) {
+      Done();
+      return EBadAccess;
+    }
+
+    _Queue.Safe([&]() { _Jobs.push_back(job); });
+
+    INC(&_Pending);
+    INC(&_Signal);
+    Internal::Wake(&_Signal, 1);
+    return ENoError;
+  }
+
+  /* @NOTE: run jobs of our run queue one by one, the fd of the running job
+   * is published so Purge can wait for it */
+  UInt Drain(Int backlog) {
+    UInt count{0};
+
+    if (READ_ONCE(_Pending) == 0) {
+      return 0;
+    }
+
+    _Worker = Internal::GetUniqueId();
+
+    while (backlog <= 0 || count < UInt(backlog)) {
+      Bool found{False};
+      Job job{};
+
+      _Queue.Safe([&]() {
+        if (_First < _Jobs.size()) {
+          job = std::move(_Jobs[_First++]);
+          found = True;
+
+          WRITE_ONCE(_Current, job.Fd);
+        }
+
+        if (_First == _Jobs.size()) {
+          _Jobs.clear();
+          _First = 0;
+        }
+      });
+
+      if (!found) {
+        break;
+      }
+
+      Execute(job);
+      count++;
+    }
+
+    return count;
+  }
+
+  /* @NOTE: drop the waiting jobs of a fd which is removed and wait until its
+   * running callback finishes, so the fd isn't closed under our feet. HEAD
+   * purges its children too since they run callbacks of its fds */
+  void Purge(Int fd, Bool children = False) {
+    Vector<Job> dropped{};
+    TimeSpec spec{.tv_sec=0, .tv_nsec=1000};
+
+    _Queue.Safe([&]() {
+      auto end = std::stable_partition(
+          _Jobs.begin() + _First, _Jobs.end(),
+          [&](const Job& job) -> Bool { return job.Fd != fd; });
+
+      for (auto it = end; it != _Jobs.end(); ++it) {
+        dropped.push_back(std::move(*it));
+      }
+
+      _Jobs.erase(end, _Jobs.end());
+    });
+
+    for (auto& job : dropped) {
+      Finish(job);
+    }
+
+    while (READ_ONCE(_Current) == fd && _Worker != Internal::GetUniqueId()) {
+      Internal::Idle(&spec);
+    }
+
+    if (children) {
+      ForEach([&](Monitor* next) -> ErrorCodeE {
+        Fildes* child = dynamic_cast<Fildes*>(next);
+
+        if (child) {
+          child->Purge(fd);
+        }
+
+        return ENoError;
+      });
+    }
+  }
+
+  void Execute(Job& job) {
+    ErrorCodeE error{ENoError};
+
+    if (job.Owner == this && _State >= EStopping) {
+      /* @NOTE: we are leaving, our fds and whatever their callbacks use are
+       * going away with us so only jobs of HEAD are still run */
+
+      WRITE_ONCE(_Current, -1);
+      Finish(job);
+      return;
+    }
+
+    try {
+      do {
+        error = job.Callback(Auto::As<Int>(job.Fd), job.Context);
+      } while (error == EDoAgain);
+    } catch (Base::Exception& except) {
+      error = except.code();
+    }
+
+    if (error && error != EBadAccess && error != EKeepContinue) {
+      DEBUG(Format{"fd {} got error {} on {}"}.Apply(job.Fd, error, _Name));
+    }
+
+    WRITE_ONCE(_Current, -1);
+    Finish(job);
+  }
+
+  void Finish(Job& job) {
+    if (job.Owner != this && job.Owner->Done()) {
+      Bug(EBadAccess, "can\'t finish a job of the owner");
+    }
+
+    DEC(&_Pending);
+
+    if (Done()) {
+      Bug(EBadAccess, "can\'t finish a routed job");
+    }
+  }
+
   Bool IsIdle(Monitor** next) {
     if (next) {
       *next = Next();    
     }
 
-    if (_Entries.size() > 0) {
-      return False;
-    } else {
-      return True;
-    }
+    return READ_ONCE(_Count) == 0;
   }
 
   Int IsWaiting(Int socket) {
-    return _Read.find(socket) != _Read.end();
+    Slot* slot = Locate(socket);
+
+    return slot && (slot->State & EReading);
   }
 
   /* @NOTE: this method is called automatically to check if the event should be
    * going on or not. By default, i think we should accept everything since the
    * flow has been handle very good to prevent */
-  ErrorCodeE OnChecking(Auto fd, Auto& UNUSED(context), Int mode) {
-    auto sk = fd.Get<Int>();
+  ErrorCodeE OnChecking(Auto& fd, Auto& UNUSED(context), Int mode) {
+    Slot* slot = Locate(fd.Get<Int>());
 
     DEBUG(Format{"checking event {} of fd {}"}.Apply(mode, fd.Get<Int>()));
 
+    if (!slot) {
+      return ENoSupport;
+    }
+
     switch(mode) {
     case EWaiting:
-      if (_Read.find(sk) != _Read.end()) {
+      if (slot->State & EReading) {
         return ENoError;
       }
       break;
 
     case ELooping:
-      if (_Write.find(sk) != _Read.end()) {
+      if (slot->State & EWriting) {
         return ENoError;
       }
       break;
@@ -572,69 +1189,77 @@ class Fildes: public Monitor {
   /* @NOTE: this method is called automatically after passing the checking step,
    * it would use to pick handling callback which help to solve the specific events
    */
-  Perform* OnSelecting(Auto& fd, Int mode) {
-    return &(mode == EWaiting? _Read[fd.Get<Int>()]: _Write[fd.Get<Int>()]);
+  Perform* OnSelecting(Auto& fd, Int UNUSED(mode)) {
+    return &Locate(fd.Get<Int>(), True)->Callback;
   }
 
   /* @NOTE: this method is used to collect jobs appear at mode waiting */
   ErrorCodeE OnWaiting(Int socket) {
-    Vector<Pair<Monitor*, Monitor::Perform*>> jobs{};
-    Bool passed{False};
-    Auto fd{Auto::As<Int>(socket)};
-
-    /* @NOTE: collect jobs from HEAD */
-    if (!_Find(fd)) {
-      ErrorCodeE error;
-
-      if ((error = Scan(fd, EWaiting, jobs)) &&
-           error != ENotFound) {
-        return error;
-      }
-
-      for (auto& job: jobs) {
-        if ((error = Reroute(job.Left, fd, *job.Right))) {
-          if (error == ENoSupport) {
-            return (*job.Right)(Auto::As(socket), _Entries[socket]);
-          } else {
-            return error;
-          }
-        }
-      }
-
-      return ENoError;
-    }
-
-    return passed? ENoError: NotFound(Format{"fd {}"} << socket).code();
+    return OnEvent(socket, EWaiting);
   }
 
   /* @NOTE: this function is called by callback Trigger when the fd is on the
    * Looping events */
   ErrorCodeE OnLooping(Int socket) {
-    Vector<Pair<Monitor*, Monitor::Perform*>> jobs{};
-    Bool passed{False};
+    return OnEvent(socket, ELooping);
+  }
+
+  /* @NOTE: collect jobs from HEAD and children who own the fd and route them
+   * to children, a job is run here only when no child can take it */
+  ErrorCodeE OnEvent(Int socket, Int mode) {
+    Monitor::Batch jobs{};
     Auto fd{Auto::As<Int>(socket)};
+    ErrorCodeE error;
 
-    /* @NOTE: collect jobs from HEAD and route them to consumers */
-    if (!_Find(fd)) {
-      ErrorCodeE error;
+    if ((error = Scan(fd, mode, jobs)) && error != ENotFound) {
+      return error;
+    } else if (jobs.Size() == 0 && !IsOwned(fd)) {
+      return NotFound(Format{"fd {}"} << socket).code();
+    }
 
-      if ((error = Scan(fd, ELooping, jobs)) && error != ENotFound) {
-        return error;
-      } else {
-        passed = True;
-      }
+    /* @NOTE: io_uring may have read the data already, it's copied to the
+     * owners since the buffer is reused after we return. The context is left
+     * to the callbacks */
+    if (mode == EWaiting && _Pool.Receive) {
+      Char* data{None};
+      Int size{_Pool.Receive(_Pool.ll.Poll, socket, &data)};
 
       for (auto& job: jobs) {
-        if ((error = Reroute(this, fd, *job.Right))) {
+        Fildes* owner = dynamic_cast<Fildes*>(job.Left);
+
+        if (size >= 0 && owner) {
+          owner->Deliver(socket, data, size);
+        }
+      }
+    }
+
+    for (auto& job: jobs) {
+      if ((error = Reroute(job.Left, fd, *job.Right))) {
+        Fildes* owner = dynamic_cast<Fildes*>(job.Left);
+
+        if (error != ENoSupport || !owner) {
+          return error;
+        } else if ((error = (*job.Right)(fd, owner->Context(socket)))) {
           return error;
         }
       }
     }
 
-    return passed? ENoError: NotFound(Format{"fd {}"} << socket).code();
+    return ENoError;
   }
 
-  Void _Flush() final { }
+  Bool IsOwned(Auto& fd) {
+    Bool result{!_Find(fd)};
+
+    ForEach([&](Monitor* next) -> ErrorCodeE {
+      result = result || !next->Find(fd);
+      return ENoError;
+    });
+
+    return result;
+  }
+
+  Void _Flush() final { Drain(-1); }
 
   Bool _Clean() final {
     if (!DEC(_Pool.Referral)) {
@@ -665,9 +1290,13 @@ class Fildes: public Monitor {
     Bool passed{False};
 
     if ((passed = !Find(fd))) {
-      _Entries.erase(socket);
+      Drop(socket);
+    } else if (Locate(socket)) {
+      Locate(socket)->Route = None;
     }
 
+    Purge(socket, True);
+
     ForEach([&](Monitor* next) -> ErrorCodeE {
       /* @NOTE: we only enter here if we have claimed successfully a new job
        * so we will perform it on parallel while make sure that the node 
@@ -685,16 +1314,23 @@ class Fildes: public Monitor {
     return passed? ENoError: NotFound(Format{"fd {}"} << socket).code();
   }
 
-  Map<Int, Auto> _Entries;
-  Map<Int, Perform> _Read, _Write;
+  Vector<Slot*> _Slots;
+  Vector<Job> _Jobs;
+  Base::Lock _Queue;
+  Base::Lock _Timing;
   Long _Tid;
+  ULong _First, _Worker, _Armed, _Count;
+  UInt _Pending, _Signal;
+  Int _Current, _Clock;
+  Wheel<Alarm> _Wheel;
+  Hashtable<ULong, ULong> _Timers{{}, Hashtable<ULong, ULong>::ESwiss};
   Pool _Pool;
 };
 
 namespace Internal {
 namespace Fildes {
 Bool Create(String name, UInt type, Int system, Monitor** result){
-  if (system < 2 && result) {
+  if ((system < 2 || system == 3) && result) {
     (*result) = new Base::Fildes(name, type, system);
 
     DEBUG(Format{"Allocate {}"}.Apply(name));
@@ -727,8 +1363,10 @@ Int Heartbeat(Void* ptr, Int* socket) {
 
   if (pool) {
     if (*socket > 0) {
+      Auto fd{Auto::As<Int>(*socket)};
+
       return (Int)(reinterpret_cast<class Fildes*>(pool->Pool))
-        ->Heartbeat(Auto::As<Int>(*socket));
+        ->Heartbeat(fd);
     } else {
       return ENoError;
     }
@@ -0,0 +1,209 @@
+#include <Hash.h>
+
+#include <string.h>
+
+#if __amd64__ || __x86_64__ || __i386__
+#include <cpuid.h>
+#endif
+
+namespace Base {
+namespace Internal {
+namespace Hashing {
+const ULong Secrets[] = {0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+                         0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL};
+
+/* @NOTE: multiply 2 words to 128 bits, left keeps the low half and right
+ * keeps the high half */
+inline void Multiply(ULong& left, ULong& right) {
+#if __SIZEOF_INT128__
+  __uint128_t result = (__uint128_t)left*right;
+
+  left = ULong(result);
+  right = ULong(result >> 64);
+#else
+  ULong lo = (left & 0xffffffff)*(right & 0xffffffff);
+  ULong mid1 = (left >> 32)*(right & 0xffffffff);
+  ULong mid2 = (left & 0xffffffff)*(right >> 32);
+  ULong hi = (left >> 32)*(right >> 32);
+  ULong carry = ((lo >> 32) + (mid1 & 0xffffffff) + (mid2 & 0xffffffff)) >> 32;
+
+  left = lo + (mid1 << 32) + (mid2 << 32);
+  right = hi + (mid1 >> 32) + (mid2 >> 32) + carry;
+#endif
+}
+
+/* @NOTE: multiply and fold the halves, this is where every bit of the input
+ * is mixed with every other bit */
+inline ULong Fold(ULong left, ULong right) {
+  Multiply(left, right);
+  return left ^ right;
+}
+
+/* @NOTE: reading with memcpy is the only portable way to load unaligned
+ * words, compilers turn it to a single mov */
+inline ULong Read64(const uint8_t* data) {
+  ULong result;
+
+  memcpy(&result, data, sizeof(result));
+  return result;
+}
+
+inline ULong Read32(const uint8_t* data) {
+  UInt result;
+
+  memcpy(&result, data, sizeof(result));
+  return result;
+}
+
+/* @NOTE: the table of the software CRC32C, it's built once by the first
+ * caller since it's only used on CPUs without SSE4.2 */
+struct Table {
+  UInt Items[256];
+
+  Table() {
+    for (UInt i = 0; i < 256; ++i) {
+      UInt crc = i;
+
+      for (auto k = 0; k < 8; ++k) {
+        crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+      }
+
+      Items[i] = crc;
+    }
+  }
+};
+
+UInt Software(const uint8_t* data, ULong size, UInt crc) {
+  static Table table{};
+
+  for (ULong i = 0; i < size; ++i) {
+    crc = table.Items[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+
+  return crc;
+}
+
+#if __amd64__ || __x86_64__ || __i386__
+__attribute__((target("sse4.2")))
+UInt Hardware(const uint8_t* data, ULong size, UInt crc) {
+  /* @NOTE: feed bytes until data is aligned so the main loop does aligned
+   * 8-byte loads, the tail is done byte by byte again */
+  for (; size > 0 && (ULong(data) & 7); ++data, --size) {
+    crc = __builtin_ia32_crc32qi(crc, *data);
+  }
+
+#if __amd64__ || __x86_64__
+  for (; size >= 8; data += 8, size -= 8) {
+    crc = UInt(__builtin_ia32_crc32di(crc, Read64(data)));
+  }
+#endif
+
+  for (; size >= 4; data += 4, size -= 4) {
+    crc = __builtin_ia32_crc32si(crc, UInt(Read32(data)));
+  }
+
+  for (; size > 0; ++data, --size) {
+    crc = __builtin_ia32_crc32qi(crc, *data);
+  }
+
+  return crc;
+}
+#endif
+
+typedef UInt (*Checksum)(const uint8_t*, ULong, UInt);
+
+/* @NOTE: choose the implementation of CRC32C with cpuid, it runs once when
+ * the function is called the first time */
+Checksum Select() {
+#if __amd64__ || __x86_64__ || __i386__
+  UInt eax{0}, ebx{0}, ecx{0}, edx{0};
+
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2)) {
+    return Hardware;
+  }
+#endif
+
+  return Software;
+}
+
+Checksum Implementation() {
+  static Checksum result = Select();
+
+  return result;
+}
+} // namespace Hashing
+} // namespace Internal
+
+namespace Hash {
+ULong Digest(const Void* data, ULong size, ULong seed) {
+  using namespace Internal::Hashing;
+
+  const uint8_t* input = (const uint8_t*)data;
+  ULong left{0}, right{0};
+
+  seed ^= Fold(seed ^ Secrets[0], Secrets[1]);
+
+  if (size <= 16) {
+    if (size >= 4) {
+      /* @NOTE: 2 pairs of overlapping 4-byte loads cover 4..16 bytes */
+      ULong shift = (size >> 3) << 2;
+
+      left = (Read32(input) << 32) | Read32(input + shift);
+      right = (Read32(input + size - 4) << 32) |
+              Read32(input + size - 4 - shift);
+    } else if (size > 0) {
+      left = (ULong(input[0]) << 16) | (ULong(input[size >> 1]) << 8) |
+             input[size - 1];
+    }
+  } else {
+    ULong remain = size;
+
+    /* @NOTE: 3 independent lanes let the CPU run the multiplications of a
+     * 48-byte block in parallel */
+    if (remain > 48) {
+      ULong first = seed, second = seed;
+
+      do {
+        seed = Fold(Read64(input) ^ Secrets[1], Read64(input + 8) ^ seed);
+        first = Fold(Read64(input + 16) ^ Secrets[2],
+                     Read64(input + 24) ^ first);
+        second = Fold(Read64(input + 32) ^ Secrets[3],
+                      Read64(input + 40) ^ second);
+
+        input += 48;
+        remain -= 48;
+      } while (remain > 48);
+
+      seed ^= first ^ second;
+    }
+
+    for (; remain > 16; input += 16, remain -= 16) {
+      seed = Fold(Read64(input) ^ Secrets[1], Read64(input + 8) ^ seed);
+    }
+
+    /* @NOTE: the last 16 bytes are always read, they overlap with what we
+     * have read if remain < 16 */
+    left = Read64(input + remain - 16);
+    right = Read64(input + remain - 8);
+  }
+
+  left ^= Secrets[1];
+  right ^= seed;
+  Multiply(left, right);
+
+  return Fold(left ^ Secrets[0] ^ size, right ^ Secrets[1]);
+}
+
+UInt CRC32C(const Void* data, ULong size, UInt crc) {
+  return ~Internal::Hashing::Implementation()((const uint8_t*)data, size, ~crc);
+}
+
+Bool Accelerated() {
+#if __amd64__ || __x86_64__ || __i386__
+  return Internal::Hashing::Implementation() == Internal::Hashing::Hardware;
+#else
+  return False;
+#endif
+}
+} // namespace Hash
+} // namespace Base
@@ -0,0 +1,135 @@
+#include <Atomic.h>
+#include <Macro.h>
+#include <Type.h>
+
+#include <errno.h>
+#include <time.h>
+
+#if LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <pthread.h>
+
+/* @NOTE: how many buckets are used to emulate futexes on systems which don't
+ * support them, addresses are hashed so unrelated words may share a bucket */
+#define PARKING_BUCKETS 64
+#endif
+
+using TimeSpec = struct timespec;
+
+namespace Base {
+namespace Internal {
+#if !LINUX
+struct Bucket {
+  pthread_mutex_t Mutex;
+  pthread_cond_t Cond;
+};
+
+static Bucket* Pick(UInt* address) {
+  static Bucket buckets[PARKING_BUCKETS];
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+  pthread_once(&once, []() {
+    for (auto i = 0; i < PARKING_BUCKETS; ++i) {
+      pthread_mutex_init(&buckets[i].Mutex, None);
+      pthread_cond_init(&buckets[i].Cond, None);
+    }
+  });
+
+  return &buckets[(ULong(address) >> 2) % PARKING_BUCKETS];
+}
+#endif
+
+ULong Monotonic() {
+  TimeSpec spec;
+
+  clock_gettime(CLOCK_MONOTONIC, &spec);
+  return ULong(spec.tv_sec) * ULong(1e9) + ULong(spec.tv_nsec);
+}
+
+ErrorCodeE Park(UInt* address, UInt expected, Long timeout) {
+  TimeSpec spec{.tv_sec = 0, .tv_nsec = 0};
+
+  if (timeout == 0) {
+    return EDoAgain;
+  } else if (timeout > 0) {
+    spec.tv_sec = timeout / Long(1e9);
+    spec.tv_nsec = timeout % Long(1e9);
+  }
+
+#if LINUX
+  /* @NOTE: the kernel checks *address == expected and puts us to sleep
+   * atomically, so a Wake which happens after the caller changed the word
+   * can't be lost */
+
+  if (syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected,
+              timeout < 0 ? None : &spec, None, 0) < 0) {
+    switch (errno) {
+    case EAGAIN:
+      return ENoError;
+
+    case ETIMEDOUT:
+      return EDoAgain;
+
+    default:
+      return EInterrupted;
+    }
+  }
+#else
+  Bucket* bucket = Pick(address);
+  ErrorCodeE error{ENoError};
+  TimeSpec deadline;
+
+  if (timeout > 0) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    deadline.tv_sec += spec.tv_sec;
+    deadline.tv_nsec += spec.tv_nsec;
+
+    if (deadline.tv_nsec >= Long(1e9)) {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= Long(1e9);
+    }
+  }
+
+  pthread_mutex_lock(&bucket->Mutex);
+
+  if (READ_ONCE(*address) == expected) {
+    if (timeout < 0) {
+      pthread_cond_wait(&bucket->Cond, &bucket->Mutex);
+    } else if (pthread_cond_timedwait(&bucket->Cond, &bucket->Mutex,
+                                      &deadline) == ETIMEDOUT) {
+      error = EDoAgain;
+    }
+  }
+
+  pthread_mutex_unlock(&bucket->Mutex);
+
+  if (error) {
+    return error;
+  }
+#endif
+
+  return ENoError;
+}
+
+void Wake(UInt* address, Int count) {
+#if LINUX
+  syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, count, None, None, 0);
+#else
+  Bucket* bucket = Pick(address);
+
+  /* @NOTE: a bucket is shared by many words so we must wake everyone, the
+   * ones who aren't targeted will check their words and sleep again */
+
+  (void) count;
+
+  pthread_mutex_lock(&bucket->Mutex);
+  pthread_cond_broadcast(&bucket->Cond);
+  pthread_mutex_unlock(&bucket->Mutex);
+#endif
+}
+} // namespace Internal
+} // namespace Base
@@ -0,0 +1,855 @@
+/* @NOTE: syscall() and MAP_POPULATE aren't declared by -std=c11 */
+#define _GNU_SOURCE 1
+
+#include <Atomic.h>
+#include <Macro.h>
+#include <Logcat.h>
+#include <Type.h>
+#include <Utils.h>
+
+#if LINUX
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+/* @NOTE: io_uring is used with raw syscalls, the kernel headers must be new
+ * enough to wait with a timeout (5.11) or URing() always falls back */
+#if defined(__NR_io_uring_setup) && defined(IORING_ENTER_EXT_ARG)
+#define USE_IO_URING 1
+#else
+#define USE_IO_URING 0
+#endif
+#endif
+
+#if LINUX && USE_IO_URING
+#define INIT 0
+#define IDLE 1
+#define RUNNING 2
+#define INTERRUPTED 3
+#define RELEASING 4
+#define PANICING 5
+
+/* @NOTE: size of the buffer which a fd reads to when direct reads are on */
+#ifndef URING_BUFFER_SIZE
+#define URING_BUFFER_SIZE 8192
+#endif
+
+#define URING_IGNORED 0xffffffffffffffffULL
+
+enum Mode {
+  EWaiting = 0,
+  ELooping = 1,
+  EReleasing = 2
+};
+
+/* @NOTE: the same as Monitor::EDirect, a fd which is appended or modified
+ * with it is read directly while it's waiting for input */
+#define EDirect 0x100
+
+/* @NOTE: every fd has a slot, the generation is put to user_data with the fd
+ * so the completions of a request which is cancelled are dropped */
+typedef struct Slot {
+  Int mode, armed, direct, events, size;
+  UInt generation;
+  Char* buffer;
+} Slot;
+
+typedef struct Context {
+  Mutex* mutex;
+  Slot* slots;
+  Int fd, nevent, nslot, backlog, multishot;
+
+  struct {
+    UInt *head, *tail, *array, *flags, mask, entries;
+    struct io_uring_sqe* sqes;
+    Void* ring;
+    ULong size;
+  } sq;
+
+  struct {
+    UInt *head, *tail, mask;
+    struct io_uring_cqe* cqes;
+    Void* ring;
+    ULong size;
+  } cq;
+} Context;
+
+typedef struct Pool {
+  Void* Pool;
+  Int Status, *Referral;
+
+  struct {
+    Context* Poll;
+
+    Int(*Append)(Void* ptr, Int socket, Int mode);
+    Int(*Modify)(Void* ptr, Int socket, Int mode);
+    Int(*Probe)(Void* ptr, Int socket, Int mode);
+    Int(*Release)(Void* ptr, Int socket);
+  } ll;
+
+  Int (*Trigger)(Void* ptr, Int socket, Bool waiting);
+  Int (*Heartbeat)(Void* ptr, Int* socket);
+  Int (*Remove)(Void* ptr, Int socket);
+  Int (*Flush)(Void* ptr, Int socket);
+  Int (*Run)(struct Pool*, Int, Int);
+  Context* (*Build)(struct Pool* pool);
+  Int (*Receive)(Void* ptr, Int socket, Char** data);
+} Pool;
+
+typedef Int (*Handler)(Pool*, Int, Int);
+
+static Int URingEnter(Int fd, UInt submit, UInt wait, UInt flags,
+                      Void* argument, ULong size) {
+  return syscall(__NR_io_uring_enter, fd, submit, wait, flags, argument, size);
+}
+
+/* @NOTE: get a free entry of the submission queue, the queue is flushed when
+ * it's full. The caller must hold the mutex */
+static struct io_uring_sqe* URingNext(Context* ring) {
+  UInt head, tail;
+
+  while (True) {
+    head = __atomic_load_n(ring->sq.head, __ATOMIC_ACQUIRE);
+    tail = *ring->sq.tail;
+
+    if (tail - head < ring->sq.entries) {
+      struct io_uring_sqe* sqe = &ring->sq.sqes[tail & ring->sq.mask];
+
+      memset(sqe, 0, sizeof(struct io_uring_sqe));
+      return sqe;
+    } else if (URingEnter(ring->fd, ring->sq.entries, 0, 0, None, 0) < 0 &&
+               errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      return None;
+    }
+  }
+}
+
+/* @NOTE: publish an entry which URingNext has given, the kernel sees it on
+ * the next io_uring_enter */
+static Void URingPush(Context* ring) {
+  UInt tail = *ring->sq.tail;
+
+  ring->sq.array[tail & ring->sq.mask] = tail & ring->sq.mask;
+  __atomic_store_n(ring->sq.tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static Void URingSubmit(Context* ring) {
+  while (URingEnter(ring->fd, ring->sq.entries, 0, 0, None, 0) < 0) {
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      break;
+    }
+  }
+}
+
+static ULong URingTag(Slot* slot, Int socket) {
+  return (((ULong)slot->generation) << 32) | (UInt)socket;
+}
+
+static Int URingGrow(Context* ring, Int socket) {
+  Int nslot = ring->nslot > 0? ring->nslot: 64;
+  Slot* slots;
+
+  if (socket < ring->nslot) {
+    return 0;
+  }
+
+  while (nslot <= socket) {
+    nslot *= 2;
+  }
+
+  if (!(slots = (Slot*)realloc(ring->slots, sizeof(Slot)*nslot))) {
+    return Error(EDrainMem, "when use realloc to grow io_uring slots");
+  }
+
+  memset(slots + ring->nslot, 0, sizeof(Slot)*(nslot - ring->nslot));
+
+  for (Int i = ring->nslot; i < nslot; ++i) {
+    slots[i].mode = -1;
+  }
+
+  ring->slots = slots;
+  ring->nslot = nslot;
+  return 0;
+}
+
+/* @NOTE: submit what a slot waits for. A fd which has asked for direct
+ * reads and is waiting for input is read to the slot's buffer so the
+ * completion carries the data, the others are polled for readiness like
+ * epoll does. The caller must hold the mutex */
+static Int URingArm(Context* ring, Int socket) {
+  Slot* slot = &ring->slots[socket];
+  struct io_uring_sqe* sqe;
+
+  if (slot->armed || slot->mode < 0) {
+    return 0;
+  }
+
+  if (slot->mode == EWaiting && slot->direct && !slot->buffer) {
+    if (!(slot->buffer = (Char*)malloc(URING_BUFFER_SIZE))) {
+      slot->direct = 0;
+    }
+  }
+
+  if (!(sqe = URingNext(ring))) {
+    return Error(EBadAccess, "io_uring's submission queue is broken");
+  }
+
+  sqe->fd = socket;
+  sqe->user_data = URingTag(slot, socket);
+
+  if (slot->mode == EWaiting && slot->direct) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->addr = (ULong)slot->buffer;
+    sqe->len = URING_BUFFER_SIZE;
+  } else {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->poll32_events = slot->mode == EWaiting? POLLIN | POLLPRI: POLLOUT;
+
+    if (ring->multishot) {
+      sqe->len = IORING_POLL_ADD_MULTI;
+    }
+  }
+
+  URingPush(ring);
+  slot->armed = 1;
+  return 0;
+}
+
+/* @NOTE: cancel what a slot waits for, the generation is bumped so whatever
+ * still comes with the old tag is dropped. The caller must hold the mutex */
+static Int URingCancel(Context* ring, Int socket) {
+  Slot* slot = &ring->slots[socket];
+  struct io_uring_sqe* sqe;
+
+  if (slot->armed) {
+    if (!(sqe = URingNext(ring))) {
+      return Error(EBadAccess, "io_uring's submission queue is broken");
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = URingTag(slot, socket);
+    sqe->user_data = URING_IGNORED;
+
+    URingPush(ring);
+  }
+
+  slot->armed = 0;
+  slot->events = 0;
+  slot->generation++;
+  return 0;
+}
+
+Context* URingBuildW(Pool* pool, Int backlog);
+
+Int URingAppend(void* ptr, Int socket, Int mode) {
+  Context* ring = (Context*)(ptr);
+  Int error = 0, direct = (mode & EDirect) != 0;
+
+  mode &= ~EDirect;
+
+  if (mode != EWaiting && mode != ELooping) {
+    return Error(ENoSupport, "socket type only adapts value 0 or 1");
+  } else if (!ring) {
+    return Error(EBadLogic, "context is not null");
+  } else if (socket < 0) {
+    return Error(EBadLogic, "socket shouldn\'t be negative");
+  }
+
+  BSLockMutex(ring->mutex);
+
+  if (!(error = URingGrow(ring, socket))) {
+    if (ring->slots[socket].mode >= 0) {
+      error = Error(EBadLogic, "socket has been appended");
+    } else {
+      ring->slots[socket].mode = mode;
+      ring->slots[socket].direct = direct;
+
+      if (!(error = URingArm(ring, socket))) {
+        INC(&ring->nevent);
+      } else {
+        ring->slots[socket].mode = -1;
+      }
+    }
+  }
+
+  BSUnlockMutex(ring->mutex);
+
+  if (!error) {
+    URingSubmit(ring);
+  }
+
+  return error;
+}
+
+Int URingModify(void* ptr, Int socket, Int mode) {
+  Context* ring = (Context*)(ptr);
+  Int error = 0, direct = (mode & EDirect) != 0;
+
+  mode &= ~EDirect;
+
+  if (mode != EWaiting && mode != ELooping && mode != EReleasing) {
+    return Error(ENoSupport, "mode isn\'t supported");
+  }
+
+  BSLockMutex(ring->mutex);
+
+  if (socket < 0 || socket >= ring->nslot || ring->slots[socket].mode < 0) {
+    error = Error(ENotFound, "socket isn\'t watched by io_uring");
+  } else if (mode == EReleasing) {
+    if (!(error = URingCancel(ring, socket))) {
+      ring->slots[socket].mode = -1;
+      ring->slots[socket].size = 0;
+
+      free(ring->slots[socket].buffer);
+      ring->slots[socket].buffer = None;
+    }
+  } else if (ring->slots[socket].mode != mode || !ring->slots[socket].armed ||
+             (direct && !ring->slots[socket].direct)) {
+    /* @NOTE: direct reads stay on until the kernel can't do them, a mode
+     * without EDirect doesn't turn them off */
+
+    if (!(error = URingCancel(ring, socket))) {
+      ring->slots[socket].mode = mode;
+      ring->slots[socket].direct |= direct;
+      error = URingArm(ring, socket);
+    }
+  }
+
+  BSUnlockMutex(ring->mutex);
+
+  if (!error) {
+    URingSubmit(ring);
+  }
+
+  return error;
+}
+
+Int URingProbe(void* ptr, Int socket, Int mode) {
+  Context* ring = (Context*)(ptr);
+  Int result = 0;
+
+  BSLockMutex(ring->mutex);
+
+  if (socket < 0 || socket >= ring->nslot || ring->slots[socket].mode < 0) {
+    result = -Error(ENotFound, "socket isn\'t watched by io_uring");
+  } else if (mode == EWaiting) {
+    result = ring->slots[socket].size > 0 ||
+             (ring->slots[socket].events & (POLLIN | POLLPRI)) != 0;
+  } else if (mode == ELooping) {
+    result = (ring->slots[socket].events & POLLOUT) != 0;
+  }
+
+  BSUnlockMutex(ring->mutex);
+  return result;
+}
+
+/* @NOTE: give callbacks what the kernel has read to the slot's buffer, -1
+ * means the event doesn't carry any data */
+Int URingReceive(void* ptr, Int socket, Char** data) {
+  Context* ring = (Context*)(ptr);
+  Int result = -1;
+
+  BSLockMutex(ring->mutex);
+
+  if (socket >= 0 && socket < ring->nslot && ring->slots[socket].direct &&
+      ring->slots[socket].size >= 0 && ring->slots[socket].mode == EWaiting) {
+    *data = ring->slots[socket].buffer;
+    result = ring->slots[socket].size;
+  }
+
+  BSUnlockMutex(ring->mutex);
+  return result;
+}
+
+Int URingRelease(void* ptr, Int socket) {
+  Int error;
+  Pool* pool = (Pool*)ptr;
+  Context* ring = (Context*)pool->ll.Poll;
+
+  if (socket < 0) {
+    if (ring->nevent > 0) {
+      return Error(EBadLogic, "detach io_uring before closing");
+    } else if (ring->fd < 0) {
+      return Error(EDoNothing, "it seem we can't create io_uring as expected");
+    }
+
+    for (Int i = 0; i < ring->nslot; ++i) {
+      free(ring->slots[i].buffer);
+    }
+
+    if (ring->cq.ring && ring->cq.ring != ring->sq.ring) {
+      munmap(ring->cq.ring, ring->cq.size);
+    }
+
+    munmap(ring->sq.sqes, sizeof(struct io_uring_sqe)*ring->sq.entries);
+    munmap(ring->sq.ring, ring->sq.size);
+    close(ring->fd);
+
+    BSDestroyMutex(ring->mutex);
+    free(ring->slots);
+  } else if (!(error = pool->Remove(pool, socket))) {
+    if (!(error = pool->ll.Modify(ring, socket, EReleasing))) {
+      DEC(&ring->nevent);
+      close(socket);
+    } else {
+      return error;
+    }
+  } else {
+    return error;
+  }
+
+  return 0;
+}
+
+/* @NOTE: the same as EpollHandler, except that a completion may be the data
+ * of a direct read and not a readiness event */
+static Int URingComplete(Pool* pool, Context* ring, struct io_uring_cqe* cqe) {
+  Int error = 0, fd = (Int)(cqe->user_data & 0xffffffff), ev = 0;
+  Int res = cqe->res, more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+  UInt generation = (UInt)(cqe->user_data >> 32);
+  Int direct;
+
+  if (cqe->user_data == URING_IGNORED) {
+    return 0;
+  }
+
+  BSLockMutex(ring->mutex);
+
+  if (fd >= ring->nslot || ring->slots[fd].mode < 0 ||
+      ring->slots[fd].generation != generation) {
+    BSUnlockMutex(ring->mutex);
+    return 0;
+  }
+
+  direct = ring->slots[fd].direct && ring->slots[fd].mode == EWaiting;
+
+  if (!more) {
+    ring->slots[fd].armed = 0;
+  }
+
+  if (res == -EINTR || res == -EAGAIN || res == -ECANCELED) {
+    /* @NOTE: the socket is nonblocking or the request is interrupted, poll
+     * for readiness from now on */
+
+    if (direct && res == -EAGAIN) {
+      ring->slots[fd].direct = 0;
+    }
+
+    res = 0;
+    direct = -1;
+  } else if (res == -EINVAL && ring->multishot && !direct) {
+    ring->multishot = 0;
+    direct = -1;
+  } else if (direct && res == -ENOTSOCK) {
+    ring->slots[fd].direct = 0;
+    direct = -1;
+  } else if (direct) {
+    ring->slots[fd].size = res;
+  } else if (res >= 0) {
+    ring->slots[fd].events = ev = res;
+  }
+
+  BSUnlockMutex(ring->mutex);
+
+  if (direct < 0) {
+  } else if (direct) {
+    /* @NOTE: an end of file is given to callbacks as an empty buffer before
+     * the fd is released, an error releases it immediately */
+
+    if (res >= 0) {
+      switch (pool->Trigger(pool, fd, True)) {
+      case ENoError:
+      case EBadAccess:
+      case EKeepContinue:
+      case EDoAgain:
+        break;
+
+      default:
+        res = -1;
+      }
+    }
+
+    BSLockMutex(ring->mutex);
+
+    if (ring->slots[fd].generation == generation) {
+      ring->slots[fd].size = 0;
+    }
+
+    BSUnlockMutex(ring->mutex);
+
+    if (res <= 0) {
+      if ((error = pool->ll.Release(pool, fd))) {
+        pool->Status = PANICING;
+      }
+
+      return error;
+    }
+  } else if (res < 0 || (ev & ~(POLLIN | POLLOUT | POLLPRI))) {
+    if (pool->Flush) {
+      if (pool->Flush(pool, fd)) {
+        return 0;
+      }
+    }
+
+    if ((error = pool->ll.Release(pool, fd))) {
+      pool->Status = PANICING;
+    }
+
+    return error;
+  } else {
+    do {
+      if (ev & (POLLIN | POLLPRI)) {
+        switch (pool->Trigger(pool, fd, True)) {
+        default:
+          if ((error = pool->ll.Release(pool, fd))) {
+            pool->Status = PANICING;
+          }
+
+        case ENoError:
+        case EBadAccess:
+        case EKeepContinue:
+          ev &= ~(POLLIN | POLLPRI);
+          break;
+
+        case EDoAgain:
+          break;
+        }
+      }
+
+      if (ev & POLLOUT) {
+        switch (pool->Trigger(pool, fd, False)) {
+        default:
+          if ((error = pool->ll.Release(pool, fd))) {
+            pool->Status = PANICING;
+          }
+
+        case ENoError:
+          URingModify(ring, fd, EWaiting);
+
+        case EBadAccess:
+        case EKeepContinue:
+          ev &= ~POLLOUT;
+          break;
+
+        case EDoAgain:
+          break;
+        }
+      }
+    } while (ev & (POLLIN | POLLOUT | POLLPRI));
+  }
+
+  if ((error = pool->Heartbeat(pool, &fd))) {
+    if (pool->Flush) {
+      if (pool->Flush(pool, fd)) {
+        return 0;
+      }
+    }
+
+    if ((error = pool->ll.Release(pool, fd))) {
+      pool->Status = PANICING;
+      return error;
+    }
+  }
+
+  /* @NOTE: single-shot requests are armed again if the fd is still here and
+   * nobody has changed it while callbacks were running */
+  BSLockMutex(ring->mutex);
+
+  if (fd < ring->nslot && ring->slots[fd].generation == generation) {
+    ring->slots[fd].events = 0;
+    error = URingArm(ring, fd);
+  }
+
+  BSUnlockMutex(ring->mutex);
+  return error;
+}
+
+Int URingHandler(Pool* pool, Int timeout, Int backlog) {
+  Context* ring;
+
+  if (!pool->ll.Poll) {
+    ring = URingBuildW(pool, backlog);
+
+    if (!ring) {
+      return Error(EBadAccess, "");
+    } else if (ring->fd < 0) {
+      return Error(EBadAccess, "");
+    }
+  } else {
+    ring = (Context*)pool->ll.Poll;
+  }
+
+  if (pool->Status == IDLE && ring->nevent == 0) {
+    return EDoNothing;
+  }
+
+  do {
+    struct io_uring_getevents_arg argument;
+    struct __kernel_timespec spec;
+    Int error = 0, nevent = 0, fd = -1;
+    UInt head, tail;
+
+    memset(&argument, 0, sizeof(argument));
+
+    if (timeout >= 0) {
+      spec.tv_sec = timeout/1000;
+      spec.tv_nsec = (timeout % 1000)*1000000;
+      argument.ts = (ULong)&spec;
+    }
+
+    /* @NOTE: completions which don't fit the ring are kept by the kernel,
+     * a wait with a timeout may return before moving them back so they are
+     * flushed explicitly, otherwise they would stay there forever */
+    if (__atomic_load_n(ring->sq.flags, __ATOMIC_ACQUIRE) &
+        IORING_SQ_CQ_OVERFLOW) {
+      URingEnter(ring->fd, 0, 0, IORING_ENTER_GETEVENTS, None, 0);
+    }
+
+    /* @NOTE: entries which are armed again by the previous round are
+     * submitted by the same syscall which waits for completions */
+    if (URingEnter(ring->fd, ring->sq.entries, 1,
+                   IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                   &argument, sizeof(argument)) < 0) {
+      if (errno != ETIME && errno != EINTR && errno != EAGAIN &&
+          errno != EBUSY) {
+        pool->Status = PANICING;
+        return Error(EBadAccess, "io_uring_enter got an error");
+      }
+    }
+
+    head = *ring->cq.head;
+    tail = __atomic_load_n(ring->cq.tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail && nevent < backlog; ++head, ++nevent) {
+      struct io_uring_cqe cqe = ring->cq.cqes[head & ring->cq.mask];
+
+      /* @NOTE: the entry is copied so it can be given back to the kernel
+       * before callbacks run */
+      __atomic_store_n(ring->cq.head, head + 1, __ATOMIC_RELEASE);
+
+      if ((error = URingComplete(pool, ring, &cqe))) {
+        break;
+      }
+    }
+
+    if (nevent == 0) {
+      do {
+        if ((error = pool->Heartbeat(pool, &fd))) {
+          if (fd >= 0 && pool->Flush) {
+            if (pool->Flush(pool, fd)) {
+              continue;
+            }
+          }
+        }
+      } while (False);
+    }
+  } while (pool->Status < RELEASING && pool->Status != INTERRUPTED);
+
+  return 0;
+}
+
+Context* URingBuild(Pool* pool) {
+  if (pool->Status != INIT) {
+    return URingBuildW(pool, pool->ll.Poll->backlog);
+  } else {
+    return None;
+  }
+}
+
+/* @NOTE: create the rings and check if the kernel can do everything we
+ * need, this fails on old kernels and where io_uring is disabled */
+static Int URingSetup(Context* ring, Int backlog) {
+  struct io_uring_params params;
+  struct io_uring_probe* probe;
+  UInt entries = 64;
+  Int opcodes[] = {IORING_OP_POLL_ADD, IORING_OP_RECV, IORING_OP_ASYNC_CANCEL};
+  Int supported = 1;
+
+  while (entries < (UInt)backlog && entries < 4096) {
+    entries *= 2;
+  }
+
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries*4;
+
+  if ((ring->fd = syscall(__NR_io_uring_setup, entries, &params)) < 0) {
+    return -1;
+  } else if (!(params.features & IORING_FEAT_NODROP) ||
+             !(params.features & IORING_FEAT_EXT_ARG)) {
+    return -1;
+  }
+
+  probe = (struct io_uring_probe*)calloc(1, sizeof(struct io_uring_probe) +
+                                        256*sizeof(struct io_uring_probe_op));
+
+  if (!probe) {
+    return -1;
+  } else if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE,
+                     probe, 256) < 0) {
+    supported = 0;
+  } else {
+    for (UInt i = 0; i < sizeof(opcodes)/sizeof(opcodes[0]); ++i) {
+      if (opcodes[i] > probe->last_op ||
+          !(probe->ops[opcodes[i]].flags & IO_URING_OP_SUPPORTED)) {
+        supported = 0;
+      }
+    }
+  }
+
+  free(probe);
+
+  if (!supported) {
+    return -1;
+  }
+
+  ring->sq.size = params.sq_off.array + params.sq_entries*sizeof(UInt);
+  ring->cq.size = params.cq_off.cqes +
+                  params.cq_entries*sizeof(struct io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (ring->cq.size > ring->sq.size) {
+      ring->sq.size = ring->cq.size;
+    }
+
+    ring->cq.size = ring->sq.size;
+  }
+
+  ring->sq.ring = mmap(None, ring->sq.size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+
+  if (ring->sq.ring == MAP_FAILED) {
+    ring->sq.ring = None;
+    return -1;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq.ring = ring->sq.ring;
+  } else {
+    ring->cq.ring = mmap(None, ring->cq.size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring->fd,
+                         IORING_OFF_CQ_RING);
+
+    if (ring->cq.ring == MAP_FAILED) {
+      ring->cq.ring = None;
+      return -1;
+    }
+  }
+
+  ring->sq.sqes = (struct io_uring_sqe*)mmap(
+      None, params.sq_entries*sizeof(struct io_uring_sqe),
+      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+      IORING_OFF_SQES);
+
+  if (ring->sq.sqes == MAP_FAILED) {
+    ring->sq.sqes = None;
+    return -1;
+  }
+
+  ring->sq.head = (UInt*)((Char*)ring->sq.ring + params.sq_off.head);
+  ring->sq.tail = (UInt*)((Char*)ring->sq.ring + params.sq_off.tail);
+  ring->sq.array = (UInt*)((Char*)ring->sq.ring + params.sq_off.array);
+  ring->sq.flags = (UInt*)((Char*)ring->sq.ring + params.sq_off.flags);
+  ring->sq.mask = *(UInt*)((Char*)ring->sq.ring + params.sq_off.ring_mask);
+  ring->sq.entries = params.sq_entries;
+
+  ring->cq.head = (UInt*)((Char*)ring->cq.ring + params.cq_off.head);
+  ring->cq.tail = (UInt*)((Char*)ring->cq.ring + params.cq_off.tail);
+  ring->cq.mask = *(UInt*)((Char*)ring->cq.ring + params.cq_off.ring_mask);
+  ring->cq.cqes = (struct io_uring_cqe*)((Char*)ring->cq.ring +
+                                         params.cq_off.cqes);
+
+  ring->multishot = 1;
+  ring->backlog = backlog;
+  return 0;
+}
+
+static Void URingDestroy(Context* ring) {
+  if (ring->sq.sqes) {
+    munmap(ring->sq.sqes, sizeof(struct io_uring_sqe)*ring->sq.entries);
+  }
+
+  if (ring->cq.ring && ring->cq.ring != ring->sq.ring) {
+    munmap(ring->cq.ring, ring->cq.size);
+  }
+
+  if (ring->sq.ring) {
+    munmap(ring->sq.ring, ring->sq.size);
+  }
+
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+
+  if (ring->mutex) {
+    BSDestroyMutex(ring->mutex);
+  }
+
+  free(ring);
+}
+
+Context* URingBuildW(Pool* pool, Int backlog) {
+  Context* result;
+
+  if (pool->Status == INIT) {
+    if (!(result = (Context*)malloc(sizeof(Context)))) {
+      return None;
+    }
+
+    memset(result, 0, sizeof(Context));
+    result->fd = -1;
+
+    if (!(result->mutex = BSCreateMutex()) || URingSetup(result, backlog)) {
+      URingDestroy(result);
+      return None;
+    }
+  } else {
+    /* @NOTE: unlike epoll, the rings can't be rebuilt without losing every
+     * request which is on flight, so a panic keeps what we have */
+    return pool->ll.Poll;
+  }
+
+  pool->ll.Release = URingRelease;
+  pool->ll.Modify = URingModify;
+  pool->ll.Append = URingAppend;
+  pool->ll.Probe = URingProbe;
+
+  pool->Build = URingBuild;
+  pool->Run = URingHandler;
+  pool->Receive = URingReceive;
+  return result;
+}
+
+Handler URing(Pool* pool, Int backlog) {
+  if (pool) {
+    Context* ring = URingBuildW(pool, backlog);
+
+    if (!ring) {
+      return None;
+    }
+
+    pool->ll.Poll = ring;
+  }
+
+  return (Handler)URingHandler;
+}
+#elif LINUX
+typedef Int (*Handler)(Void*, Int, Int);
+
+/* @NOTE: the kernel headers don't know io_uring, Fildes uses epoll instead */
+Handler URing(Void* UNUSED(pool), Int UNUSED(backlog)) {
+  return None;
+}
+#endif
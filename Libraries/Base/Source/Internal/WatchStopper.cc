@@ -472,10 +472,16 @@ void UnwatchStopper(Base::Thread& thread) {
 }
 
 Bool UnwatchStopper(Base::Lock& lock) {
-  Vertex<Void> escaping{[](){}, []() { RemoveWatcherIfNeeded(False); }};
+  Vertex<Void> escaping{[](){}, []() { RemoveWatcherIfNeeded(True); }};
 
   if (Context(lock)) {
-    Watcher->OnUnregister<Implement::Lock>(lock.Identity());
+    /* @NOTE: static locks are released after exiting, Watcher might have
+     * been removed by the ones which were released before them */
+
+    if (Watcher) {
+      Watcher->OnUnregister<Implement::Lock>(lock.Identity());
+    }
+
     delete reinterpret_cast<Implement::Lock*>(Context(lock));
 
     Register(lock, None);
@@ -1825,15 +1831,17 @@ void SolveDeadlock() {
         // timeout = Watcher->Optimize(True, marks[1] - marks[0]);
       }
 
-      for (ULong i = 0; i < Watcher->Stucks.Size(); ++i) {
-        Implement::Lock* locker = Watcher->Stucks.At<Implement::Lock>(i + 1);
+      Watcher->Stucks.ForEach([&](ULong, Void* pointer) -> ErrorCodeE {
+        Implement::Lock* locker = (Implement::Lock*)pointer;
 
         if (!locker || !(checking = locker->Unlock())) {
           tracking = True;
         } else {
-          break;
+          return EDoNothing;
         }
-      }
+
+        return ENoError;
+      });
 
       if (tracking) {
         /* @NOTE: We could able to detect D-state issues and kill it directly
@@ -1913,13 +1921,14 @@ void DumpWatch(String parameter) {
   using namespace Internal::Debug;
 
   if (parameter == "Stucks") {
-    auto curr = Watcher->Stucks._Head[0];
+    Epoch::Guard guard{};
+    auto curr = Watcher->Stucks._Head;
 
     VERBOSE << "Dump information of list Watcher->Stucks:" << EOL;
     VERBOSE << (Format{" - List's count is {}"} << Watcher->Stucks._Count)
             << EOL;
     VERBOSE << (Format{" - List's head is {}"}
-                << ULong(Watcher->Stucks._Head[0]))
+                << ULong(Watcher->Stucks._Head))
             << EOL;
     VERBOSE << (Format{" - List has {} node(s):"} << Watcher->Stucks.Size())
             << EOL;
@@ -1,6 +1,8 @@
 #include <Atomic.h>
+#include <Epoch.h>
 #include <List.h>
 #include <Logcat.h>
+#include <Magazine.h>
 #include <Vertex.h>
 
 #include <iostream>
@@ -13,12 +15,36 @@
 #define REUSEABLE -2
 #define ALLOCATED -3
 
+#define CHUNK_SLOTS (sizeof(Chunk::Ptr) / sizeof(Void *))
+
+/* @NOTE: how many nodes a magazine can keep and how many batches the shared
+ * depot can keep before we start releasing them to the system */
+#define MAGAZINE_SIZE 64
+#define DEPOT_LIMIT 256
+
+/* @NOTE: how many times we try to collect a consistent snapshot */
+#define SNAPSHOT_RETRY 16
+
 using TimeSpec = struct timespec;
 
 namespace Base {
 namespace Internal {
 void Idle(TimeSpec *spec);
 Int Random(Int min, Int max);
+
+struct Changing {
+  /* @NOTE: this is used to mark the beginning and the end of a change, the
+   * snapshot of method ForEach is consistent only when nobody is changing the
+   * list during taking it */
+
+  ULong *Versions;
+
+  explicit Changing(ULong *versions) : Versions{versions} {
+    INC(&Versions[0]);
+  }
+
+  ~Changing() { INC(&Versions[1]); }
+};
 } // namespace Internal
 
 List::List
@@ -28,36 +54,39 @@ List::List
     (Int retry, Bool dumpable) {
   _Dumpable = dumpable;
 #endif
-  ABI::Memset(_Head, 0, 2 * sizeof(Node *));
+  ABI::Memset(_Segments, 0, sizeof(_Segments));
 
+  _Layout = ELinked;
+  _Detaching = False;
   _Count = 0;
+  _Version[0] = 0;
+  _Version[1] = 0;
   _Size[0] = 0;
   _Size[1] = 0;
-  _Head[1] = Allocate(None);
-  _Head[0] = Allocate(None);
+  _Head = Allocate(None);
   _Last = Allocate(None);
 
   /* @NOTE: since these nodes are immutable so it should be best to set their
    * index as zero to avoid accessing */
 
-  _Head[0]->Index = 0;
+  _Head->Index = 0;
   _Last->Index = 0;
 
   /* @NOTE: these nodes are set to be immutable so we could avoid
    * unexpected behaviour causes */
 
-  _Head[0]->State = False;
+  _Head->State = False;
   _Last->State = False;
 
   /* @NOTE: do this would help our list to be linkeable and easy to detach or
    * attach without consuming so much CPU */
 
-  _Head[0]->Next = _Last;
-  _Last->Prev[0] = _Head[0];
+  _Head->Next = _Last;
+  _Last->Prev = _Head;
 
   /* @NOTE: here is the explanation of how the nodes connect each-other:
-   * - We have 2 node A and B, A->Next --> B while B->Prev[0] --> A while
-   *   A->PNext --> &(B->Next) and B->PPrev --> &(A->Prev[0]). For more detail
+   * - We have 2 node A and B, A->Next --> B while B->Prev --> A while
+   *   A->PNext --> &(B->Next) and B->PPrev --> &(A->Prev). For more detail
    *   please check the image below.
    *
    *      +---------------+     +---------------+
@@ -77,38 +106,19 @@ List::List
    *
    * - With this designation, it can be easily to remove a node on parallel
    *   using our atomic operators. To do that, we just use MCOPY to write Next
-   *   to PNext and Prev[0] to PPrev. Doing that would cause rewrite the
-   * parameters Next of the previous node and Prev[0] of the next node
+   *   to PNext and Prev to PPrev. Doing that would cause rewrite the
+   * parameters Next of the previous node and Prev of the next node
    * respectively and the middle node will be detached before we do removing it.
    *
-   * - When a node is deleted, it doesn't actually remove from our list. Instead
-   *   this node will be moved to deleted stack so we could reuse it later. When
-   *   it happens, we will see the node's structure is changed like this.
-   *
-   *      +-------------+     +--------------+
-   *      |       A     |     |       B      |
-   *      |             |     |              |
-   *      |             |     |              |
-   *  ----|Prev[1]      |<----|Prev[1]       |<---
-   *      |             |     |              |
-   *      |             |     |              |
-   *      |             |     |              |
-   *      |             |     |              |
-   *      |             |     |              |
-   *      |             |     |              |
-   *      +-------------+     +--------------+
-   *
-   * - Since we use dynamic queue to manage reuseable nodes, we only need one
-   *   pointer to indicate where is the queue's head and one pointer for queue's
-   *   tail. Queue should be a better solution since we can reuse dead nodes
-   *   so we could reduce using malloc/free too much. This design intends to
-   *   overcome the race condition issue when a node is going to be deleted, it
-   *   could be accessed by so many thread at the same time. If we delete this
-   *   node during handling accessing on another threads.
+   * - When a node is detached, its Next still points to the rest of our list
+   *   so threads which are standing on it can keep walking. The node is
+   *   retired to Epoch and it will be released only when every thread which
+   *   might see it has left its critical section, so readers never need to
+   *   retry or wait for the writers.
    * ------------------------------------------------------------------------ */
 
-  _Head[0]->PPrev = &_Last->Prev[0];
-  _Last->PNext = &_Head[0]->Next;
+  _Head->PPrev = &_Last->Prev;
+  _Last->PNext = &_Head->Next;
 
   if (retry > 0) {
     _Retry = retry;
@@ -117,22 +127,37 @@ List::List
   }
 }
 
+List::List(LayoutE layout, Int retry) : List(retry) { _Layout = layout; }
+
 List::~List() {
   /* @NOTE: this destructor is unsafe since it's call by os and we can't
    * control it. The user should know that their thread should be done
    * before this method is called. Everything is handled easily by WatchStopper
    * but i can't control daemon threads since they are out of my scope */
 
-  Node *node = _Head[1]->Prev[0];
+  Node *node = _Head;
 
-  while (node != _Head[1]) {
-    Node *temp{node};
+  for (UInt segment = 0; segment < sizeof(_Segments) / sizeof(Chunk **);
+       ++segment) {
+    if (!_Segments[segment]) {
+      continue;
+    }
+
+    for (ULong offset = 0; offset < (ULong(1) << segment); ++offset) {
+      if (_Segments[segment][offset]) {
+        ABI::Free(_Segments[segment][offset]);
+      }
+    }
 
-    node = node->Prev[0];
-    delete temp;
+    ABI::Free(_Segments[segment]);
   }
 
-  delete _Head[1];
+  while (node) {
+    Node *temp{node};
+
+    node = node->Next;
+    Give(temp);
+  }
 }
 
 void List::Idle(Long nanosec) {
@@ -141,13 +166,53 @@ void List::Idle(Long nanosec) {
   Internal::Idle(&spec);
 }
 
+void List::Release(Void *node) { Give((Node *)node); }
+
+/* @NOTE: nodes are kept in magazines, see Magazine.h. The depot is limited
+ * so a burst of deletions doesn't keep its nodes forever */
+struct List::Magazine
+    : Internal::Magazine<List::Node, MAGAZINE_SIZE, DEPOT_LIMIT> {};
+
+List::Magazine *List::Local() {
+  thread_local Magazine magazine{};
+
+  return &magazine;
+}
+
+List::Node *List::Take() { return Local()->Take(); }
+
+void List::Give(Node *node) {
+  Node *refused = Local()->Give(node);
+
+  /* @NOTE: the depot is full so these nodes should be released directly */
+
+  while (refused) {
+    Node *next = refused->Next;
+
+    delete refused;
+    refused = next;
+  }
+}
+
+List::Statistic List::Statistics() {
+  auto counters = Local()->Statistics();
+
+  return Statistic{counters.Hits, counters.Misses, counters.Refills,
+                   counters.Flushes};
+}
+
 ULong List::Size(Bool type) { return _Size[type]; }
 
+List::LayoutE List::Layout() { return _Layout; }
+
 Int List::Exist(ULong key) {
+  Epoch::Guard guard{};
   ErrorCodeE error = ENoError;
   Node *node = None;
 
-  if ((node = Access(key, True, &error))) {
+  if (_Layout == EChunked) {
+    return Pick(key, True) ? 1 : 0;
+  } else if ((node = Access(key, True, &error))) {
     goto done;
   }
 
@@ -168,9 +233,22 @@ Int List::Exist(Void *pointer) {
 }
 
 ErrorCodeE List::IndexOf(Void *pointer, ULong *result) {
+  Epoch::Guard guard{};
   ErrorCodeE error = ENoError;
   Node *node = None;
 
+  if (_Layout == EChunked) {
+    ULong index = Locate(pointer);
+
+    if (!index) {
+      return ENotFound;
+    } else if (result) {
+      *result = index;
+    }
+
+    return ENoError;
+  }
+
   if ((node = Access(pointer, &error))) {
     if (result) {
       *result = node->Index;
@@ -183,10 +261,36 @@ ErrorCodeE List::IndexOf(Void *pointer, ULong *result) {
 }
 
 Long List::Add(Void *pointer, Int retry) {
+  Internal::Changing changing{_Version};
+  Epoch::Guard guard{};
   Node *node{None};
   ULong result{0};
   Long nsec{1};
 
+  if (_Layout == EChunked) {
+    Chunk *chunk{None};
+    Void **slot{None};
+
+    /* @NOTE: an empty slot is marked with None so we can't keep None inside
+     * a chunk. Each index is issued once by _Count but it still might be
+     * taken by method Add(index, pointer) so we should pick another one when
+     * it happens */
+
+    if (!pointer) {
+      return 0;
+    }
+
+    do {
+      if (!(slot = Slot((result = INC(&_Count)), True, &chunk))) {
+        return 0;
+      }
+    } while (!CMPXCHG(slot, None, pointer));
+
+    INC(&chunk->Count);
+    INC(&_Size[0]);
+    return result;
+  }
+
   node = Allocate(pointer);
 
 #if !DEV
@@ -217,17 +321,42 @@ Long List::Add(Void *pointer, Int retry) {
   }
 #endif
 
-  WRITE_ONCE(node->State, False);
+  /* @NOTE: the node has never been published so nobody can see it and we
+   * can release it directly */
+
+  DEC(&_Size[1]);
+  Give(node);
 
 finish:
   return result;
 }
 
 ErrorCodeE List::Add(ULong index, Void *pointer, Int retry) {
+  Internal::Changing changing{_Version};
+  Epoch::Guard guard{};
   ErrorCodeE error{EDoNothing};
   Node *node{None};
   Long nsec{1};
 
+  if (_Layout == EChunked) {
+    Chunk *chunk{None};
+    Void **slot{None};
+
+    if (!pointer) {
+      return BadLogic("can\'t keep None inside a chunk").code();
+    } else if (!index) {
+      return Add(pointer, retry) ? ENoError : EDrainMem;
+    } else if (!(slot = Slot(index, True, &chunk))) {
+      return DrainMem("can\'t allocate a new chunk").code();
+    } else if (!CMPXCHG(slot, None, pointer)) {
+      return EDoNothing;
+    }
+
+    INC(&chunk->Count);
+    INC(&_Size[0]);
+    return ENoError;
+  }
+
   node = Allocate(pointer);
   node->Index = index;
 
@@ -264,7 +393,11 @@ ErrorCodeE List::Add(ULong index, Void *pointer, Int retry) {
   }
 #endif
 
-  WRITE_ONCE(node->State, False);
+  /* @NOTE: the node has never been published so nobody can see it and we
+   * can release it directly */
+
+  DEC(&_Size[1]);
+  Give(node);
 
 finish:
   return error;
@@ -281,7 +414,7 @@ Long List::Attach(Node *node, ErrorCodeE *error) {
 
   if (node->Index == 0) {
     node->Index = INC(&_Count);
-  } else if (node->PHead != &_Head[0]) {
+  } else if (node->PHead != &_Head) {
     return -1; // <-- We detect a wrong node which isn't created by this list
   } else if (!error || *error != ENotFound) {
     /* @NOTE: this tricky way helps to reduce the number of using method Access
@@ -342,7 +475,7 @@ Long List::Attach(Node *node, ErrorCodeE *error) {
 
     last->Index = 0;
     last->Next = None;
-    last->Prev[0] = _Last;
+    last->Prev = _Last;
     last->State = False;
     last->PPrev = None;
     last->PNext = &_Last->Next;
@@ -355,7 +488,7 @@ Long List::Attach(Node *node, ErrorCodeE *error) {
        * stable, even if we are dealing with the high-loaded systems */
 
       WRITE_ONCE(_Last->Ptr, last->Ptr);
-      WRITE_ONCE(_Last->PPrev, &last->Prev[0]);
+      WRITE_ONCE(_Last->PPrev, &last->Prev);
       WRITE_ONCE(_Last->Next, last);
       WRITE_ONCE(_Last->State, True);
 
@@ -388,9 +521,17 @@ Long List::Attach(Node *node, ErrorCodeE *error) {
 }
 
 List::Node *List::Detach(Node *node) {
-  if (node && !CMP(&node, _Head[0]) && !CMP(&node, _Last)) {
+  if (node && !CMP(&node, _Head) && !CMP(&node, _Last)) {
+    /* @NOTE: readers never touch Prev so only writers which are detaching
+     * neighbor nodes can conflict with each other, we serialize them here
+     * since a node mustn't be retired while it's still reachable */
+
+    while (!CMPXCHG(&_Detaching, False, True)) {
+      BARRIER();
+    }
+
     auto next = node->Next;
-    auto prev = node->Prev[0];
+    auto prev = node->Prev;
     auto pprev = node->PPrev;
     auto pnext = node->PNext;
 
@@ -404,6 +545,7 @@ List::Node *List::Detach(Node *node) {
 
     WRITE_ONCE(next->PNext, pnext);
     WRITE_ONCE(prev->PPrev, pprev);
+    WRITE_ONCE(_Detaching, False);
   }
 
   return node;
@@ -411,20 +553,9 @@ List::Node *List::Detach(Node *node) {
 
 List::Node *List::Detach(ULong index) {
   Node *node = None;
-  Long nsec = 1;
-
-#if !DEV
-  for (auto retry = _Retry; retry > 0; --retry) {
-#endif
-    if ((node = Access(index, true))) {
-      return Detach(node);
-
-#if !DEV
-      break;
-    }
 
-    Idle((nsec = (nsec * Internal::Random(1, 10) % ULong(100))));
-#endif
+  if ((node = Access(index, true))) {
+    return Detach(node);
   }
 
   return None;
@@ -438,39 +569,62 @@ Bool List::Del(ULong index, Void *ptr, ErrorCodeE *code, Bool failable) {
     return False;
   }
 
-  /* @NOTE: This is my theory of how to delete a node. When a node is deleted,
-   * this node will be moved to the second queue. We will use backing pointers
-   * to handle this.
+  Internal::Changing changing{_Version};
+
+  /* @NOTE: This is my theory of how to delete a node. The node is detached
+   * first but we don't release it here, instead it's retired to Epoch and
+   * will be released when every thread which is walking through it is done.
    *
-   * +------+
-   * | head | <-- This node should be created but we don't use it.
-   * +------+
-   *    | ^
-   *    | .         +------+
-   *    v +.........| wait |
-   * ........       +------+
-   *    |               ^
-   *    |               .
-   *    v               .
-   * +------+           .
-   * | last |...........+ <-- This link happens during a deleted node is mocked
-   * +------+                 to this list. This node is effected when we update
-   *                          the pointer _Head[1]
+   * +------+       +------+       +------+
+   * | prev |------>| node |------>| next |
+   * +------+       +------+       +------+
+   *    |                             ^
+   *    +-----------------------------+
    *
-   * - These deleted nodes still allow another threads to be pass throught since
-   *   we only use pointer Prev[0] while method `Access` only use pointer Next
+   * - These detached nodes still allow another threads to be pass throught
+   *   since we only use pointer Prev while method `Access` only use pointer
+   *   Next. Only one thread can switch the node's State so the node is never
+   *   retired twice.
    * ------------------------------------------------------------------------ */
 
-  if ((node = Access(index, True, failable ? code : (&error)))) {
-    if (ptr == node->Ptr) {
-      if (!Detach(node)) {
-        if (code) {
-          *code = BadAccess("can't detach node as it should be").code();
-        }
+  if (_Layout == EChunked) {
+    Chunk *chunk{None};
+    Void **slot{Slot(index, False, &chunk)};
+
+    /* @NOTE: with layout EChunked, deleting is just swapping the slot back to
+     * None so only one thread can win if many threads try to delete the same
+     * pointer at the same time */
 
-        goto reattach;
+    if (ptr && slot && CMPXCHG(slot, ptr, None)) {
+      DEC(&chunk->Count);
+      goto preserve;
+    } else if (!slot || !READ_ONCE(*slot)) {
+      if (failable && code) {
+        *code = ENotFound;
       } else {
-        goto preserve;
+        error = ENotFound;
+      }
+    }
+
+    goto fail;
+  }
+
+  if (True) {
+    Epoch::Guard guard{};
+
+    if ((node = Access(index, True, failable ? code : (&error)))) {
+      if (ptr == node->Ptr && CMPXCHG(&node->State, True, False)) {
+        if (!Detach(node)) {
+          if (code) {
+            *code = BadAccess("can't detach node as it should be").code();
+          }
+
+          goto reattach;
+        } else {
+          Epoch::Retire(node, List::Release);
+          DEC(&_Size[1]);
+          goto preserve;
+        }
       }
     }
   }
@@ -499,7 +653,7 @@ preserve:
 }
 
 List::Node *List::Access(ULong &number, Bool is_index, ErrorCodeE *code) {
-  Node *node{_Head[0]};
+  Node *node{_Head};
 
   while ((!is_index && number > 0) ||
          (is_index && number != READ_ONCE(node->Index))) {
@@ -531,7 +685,7 @@ fail:
 }
 
 List::Node *List::Access(Void *pointer, ErrorCodeE *code) {
-  Node *node{_Head[0]};
+  Node *node{_Head};
 
   while (node && node->Ptr != pointer) {
     /* @NOTE: try to consult the permision to the next node within a certain
@@ -566,86 +720,261 @@ fail:
   return None;
 }
 
-List::Node *List::Allocate(Void *pointer) {
-  Node *result = _Head[1] ? _Head[1]->Prev[1] : None;
+ErrorCodeE List::ForEach(Function<ErrorCodeE(ULong, Void *)> callback,
+                         Bool snapshot) {
+  Vector<Pair<ULong, Void *>> items{};
+  Long nsec{1};
+  Function<ErrorCodeE(ULong, Void *)> collect{
+      [&](ULong index, Void *pointer) -> ErrorCodeE {
+        items.push_back(Pair<ULong, Void *>(index, pointer));
+        return ENoError;
+      }};
+
+  if (!snapshot) {
+    return Walk(callback);
+  }
 
-  if (result) {
-    while (!CMP(&result, _Head[1])) {
-      Node *next = result ? result->Prev[1] : None;
+  /* @NOTE: _Version[0] is increased before every Add/Del starts and
+   * _Version[1] is increased after it's finished so if they are the same and
+   * _Version[0] doesn't change during collecting, nobody touches our list and
+   * what we have collected is a consistent snapshot */
 
-      if (!next) {
-        break;
-      } else if (CMPXCHG(&result->State, False, True)) {
-        goto finish;
-      } else {
-        BARRIER();
+  for (auto retry = 0; retry < SNAPSHOT_RETRY; ++retry) {
+    ULong finished = READ_ONCE(_Version[1]);
+    ULong started = READ_ONCE(_Version[0]);
+
+    if (retry > 0) {
+      List::Idle((nsec = (nsec * 2) % ULong(1e6)));
+    }
+
+    if (started != finished) {
+      continue;
+    }
+
+    BARRIER();
+    Walk(collect);
+    BARRIER();
+
+    if (READ_ONCE(_Version[0]) == started) {
+      for (auto &item : items) {
+        ErrorCodeE error = callback(item.Left, item.Right);
+
+        if (error) {
+          return error;
+        }
       }
 
-      result = result->Prev[1];
+      return ENoError;
     }
+
+    items.clear();
   }
 
-  result = new Node(pointer, &_Head[0], &_Last);
-  INC(&_Size[1]);
+  return EDoAgain;
+}
 
-  /* @NOTE: even if we face high-loaded issue, we can't face any crash
-   * because we are maintaining a circuling queue so we might at least
-   * hiting to the _Head before the node is fully switch to the newest
-   * dead node. Like this:
-   *
-   * +------+
-   * | head |<-+  <- This node should be created but we don't use it.
-   * +------+  |
-   *     |     |
-   *     |     |
-   *     v     |
-   * ........  |  <- Even if switching is slow, we still safe becasue
-   *     |     |     these threads will hit back to the head which is
-   *     |     |     never killed, i call it a backing link.
-   *     v     |
-   * +------+  |
-   * | last |--+
-   * +------+
-   *     .          +-----------+
-   *     +.........>| switching |
-   *                +-----------+
+ErrorCodeE List::Walk(Function<ErrorCodeE(ULong, Void *)> &callback) {
+  ErrorCodeE error{ENoError};
+
+  if (_Layout == EChunked) {
+    for (UInt segment = 0; segment < sizeof(_Segments) / sizeof(Chunk **);
+         ++segment) {
+      Chunk **chunks = READ_ONCE(_Segments[segment]);
+
+      if (!chunks) {
+        continue;
+      }
+
+      for (ULong offset = 0; offset < (ULong(1) << segment); ++offset) {
+        Chunk *chunk = READ_ONCE(chunks[offset]);
+
+        if (!chunk || !READ_ONCE(chunk->Count)) {
+          continue;
+        }
+
+        for (UInt i = 0; i < CHUNK_SLOTS; ++i) {
+          Void *pointer = READ_ONCE(chunk->Ptr[i]);
+          ULong index = ((ULong(1) << segment) + offset - 1) * CHUNK_SLOTS + i;
+
+          if (pointer && (error = callback(index + 1, pointer))) {
+            return error;
+          }
+        }
+      }
+    }
+  } else {
+    Epoch::Guard guard{};
+
+    /* @NOTE: the node `last` is the only one which doesn't have Next so we
+     * stop there. Detached nodes still lead us to the rest of the list and
+     * they are skipped since their State are switched to False */
+
+    for (Node *node = READ_ONCE(_Head->Next); node && READ_ONCE(node->Next);
+         node = READ_ONCE(node->Next)) {
+      if (!READ_ONCE(node->State)) {
+        continue;
+      } else if ((error = callback(node->Index, READ_ONCE(node->Ptr)))) {
+        return error;
+      }
+    }
+  }
+
+  return ENoError;
+}
+
+Void **List::Slot(ULong index, Bool allocate, Chunk **chunk) {
+  ULong position{0}, offset{0};
+  Chunk **chunks{None}, *result{None};
+  UInt segment{0};
+
+  if (index == 0) {
+    return None;
+  }
+
+  /* @NOTE: the directory is split into segments, segment k-th keeps 2^k
+   * chunks so the directory never moves when it grows and we can calculate
+   * where an index lives without touching any other chunk:
    *
-   * - The backing link will be configured after the last node is fully
-   *   switched so in theory there is no exception here and we would see
-   *   the circular queue is expanded, even if we are dealing with high
-   *   loaded issues.
+   *   index -> position = (index - 1) / CHUNK_SLOTS + 1
+   *         -> segment  = log2(position)
+   *         -> offset   = position - 2^segment
    *
-   * -------------------------------------------------------------------- */
+   * - Segments and chunks are allocated on demand, if several threads try to
+   *   allocate the same place, only one of them wins and the others will
+   *   release their own memory and use the winner.
+   * ------------------------------------------------------------------------ */
 
-  if (_Head[1]) {
-    result->Prev[1] = _Head[1];
+  position = (index - 1) / CHUNK_SLOTS + 1;
+  segment = 63 - __builtin_clzl(position);
+  offset = position - (ULong(1) << segment);
 
-    WRITE_ONCE(*_Head[1]->PNext, result);
+  if (!(chunks = READ_ONCE(_Segments[segment]))) {
+    if (!allocate) {
+      return None;
+    }
+
+    chunks = (Chunk **)ABI::Calloc(ULong(1) << segment, sizeof(Chunk *));
+
+    if (!chunks) {
+      return None;
+    } else if (!CMPXCHG(&_Segments[segment], None, chunks)) {
+      ABI::Free(chunks);
+      chunks = READ_ONCE(_Segments[segment]);
+    }
   }
 
-finish:
-  result->Ptr = pointer;
-  result->PHead = &_Head[0];
-  result->PLast = &_Last;
-  result->Index = 0;
+  if (!(result = READ_ONCE(chunks[offset]))) {
+    if (!allocate) {
+      return None;
+    }
 
-  if (!_Head[1]) {
-    _Head[1] = result;
+    result = (Chunk *)ABI::Memallign(64, sizeof(Chunk) / 64.0);
 
-    /* @NOTE: by default, this node should be Imutable so user can't use it */
-    _Head[1]->Index = 0;
-    _Head[1]->State = False;
+    if (!result) {
+      return None;
+    }
 
-    /* @NOTE: do this would make a circular queue so we can prevent from
-     * touching undefined addresses */
+    ABI::Memset(result, 0, sizeof(Chunk));
 
-    _Head[1]->Prev[0] = _Head[1];
-    _Head[1]->Next = _Head[1];
+    if (!CMPXCHG(&chunks[offset], None, result)) {
+      ABI::Free(result);
+      result = READ_ONCE(chunks[offset]);
+    } else {
+      ADD(&_Size[1], CHUNK_SLOTS);
+    }
+  }
 
-    _Head[1]->PPrev = &_Head[1]->Prev[0];
-    _Head[1]->PNext = &_Head[1]->Next;
+  if (chunk) {
+    *chunk = result;
   }
 
+  return &result->Ptr[(index - 1) % CHUNK_SLOTS];
+}
+
+Void *List::Pick(ULong number, Bool is_index) {
+  if (is_index) {
+    Void **slot = Slot(number, False);
+
+    return slot ? READ_ONCE(*slot) : None;
+  } else if (number == 0) {
+    return None;
+  }
+
+  /* @NOTE: positional access jumps over the whole chunk using its counter and
+   * only walks through slots of the chunk which contains our position */
+
+  for (UInt segment = 0; segment < sizeof(_Segments) / sizeof(Chunk **);
+       ++segment) {
+    Chunk **chunks = READ_ONCE(_Segments[segment]);
+
+    if (!chunks) {
+      continue;
+    }
+
+    for (ULong offset = 0; offset < (ULong(1) << segment); ++offset) {
+      Chunk *chunk = READ_ONCE(chunks[offset]);
+
+      if (!chunk) {
+        continue;
+      } else if (number > READ_ONCE(chunk->Count)) {
+        number -= READ_ONCE(chunk->Count);
+        continue;
+      }
+
+      for (UInt i = 0; i < CHUNK_SLOTS; ++i) {
+        Void *pointer = READ_ONCE(chunk->Ptr[i]);
+
+        if (pointer && --number == 0) {
+          return pointer;
+        }
+      }
+    }
+  }
+
+  return None;
+}
+
+ULong List::Locate(Void *pointer) {
+  if (!pointer) {
+    return 0;
+  }
+
+  for (UInt segment = 0; segment < sizeof(_Segments) / sizeof(Chunk **);
+       ++segment) {
+    Chunk **chunks = READ_ONCE(_Segments[segment]);
+
+    if (!chunks) {
+      continue;
+    }
+
+    for (ULong offset = 0; offset < (ULong(1) << segment); ++offset) {
+      Chunk *chunk = READ_ONCE(chunks[offset]);
+
+      if (!chunk || !READ_ONCE(chunk->Count)) {
+        continue;
+      }
+
+      for (UInt i = 0; i < CHUNK_SLOTS; ++i) {
+        if (READ_ONCE(chunk->Ptr[i]) == pointer) {
+          return ((ULong(1) << segment) + offset - 1) * CHUNK_SLOTS + i + 1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+List::Node *List::Allocate(Void *pointer) {
+  Node *result = Take();
+
+  if (result) {
+    *result = Node(pointer, &_Head, &_Last);
+  } else {
+    result = new Node(pointer, &_Head, &_Last);
+  }
+
+  INC(&_Size[1]);
   return result;
 }
 } // namespace Base
@@ -1,4 +1,5 @@
 #include <Atomic.h>
+#include <Epoch.h>
 #include <Lock.h>
 #include <Monitor.h>
 #include <Utils.h>
@@ -13,19 +14,45 @@ namespace Internal {
 Mutex *CreateMutex();
 
 static Map<UInt, Lock> MLocks;
+static Map<UInt, List> Children;
 static Map<UInt, Pair<Monitor *, Monitor *>> Monitors;
 static Map<UInt, Bool (*)(String, UInt, Monitor **)> Builders;
 static Vertex<Mutex, True> Secure([](Mutex *mutex) { Locker::Lock(*mutex); },
                                   [](Mutex *mutex) { Locker::Unlock(*mutex); },
                                   CreateMutex());
 
-void CreateIfNeeded(UInt type) {
+void CreateIfNeeded(UInt type, Pair<Monitor *, Monitor *> **links,
+                    Lock **locker, List **children) {
   Secure.Circle([&]() {
     if (Monitors.find(type) == Monitors.end()) {
       Monitors[type] = Pair<Monitor *, Monitor *>(None, None);
       MLocks[type] = Lock();
+
+      /* @NOTE: every attached Monitor is also kept inside this list so we
+       * can walk through them with List::ForEach */
+      Children[type];
+    }
+
+    *links = &Monitors[type];
+    *locker = &MLocks[type];
+    *children = &Children[type];
+  });
+}
+
+/* @NOTE: look the entries of a type up, the tables may grow at any time so
+ * they are only read under Secure */
+Bool Lookup(UInt type, Pair<Monitor *, Monitor *> **links, Lock **locker) {
+  Bool found{False};
+
+  Secure.Circle([&]() {
+    if (Monitors.find(type) != Monitors.end()) {
+      *links = &Monitors[type];
+      *locker = &MLocks[type];
+      found = True;
     }
   });
+
+  return found;
 }
 
 void Idle(TimeSpec *spec);
@@ -37,7 +64,9 @@ Bool Create(String name, UInt type, Int system, Monitor **result);
 
 Monitor::Monitor(String name, UInt type)
     : _Name{name}, _Type{type}, _Shared{None}, _PNext{None}, _PLast{None},
-      _Head{None}, _Last{None}, _Next{None}, _Prev{None}, _State{0}, _Using{0} {
+      _Head{None}, _Last{None}, _Next{None}, _Prev{None}, _State{0}, _Using{0},
+      _Token{0}, _Links{None}, _Locker{None}, _Children{None} {
+  Internal::CreateIfNeeded(type, &_Links, &_Locker, &_Children);
 }
 
 Monitor::~Monitor() {}
@@ -66,6 +95,14 @@ ErrorCodeE Monitor::Modify(Auto fd, Int mode) {
 
 ErrorCodeE Monitor::Find(Auto fd) { return _Find(fd); }
 
+ErrorCodeE Monitor::Receive(Auto fd, String& data) {
+  return _Receive(fd, data);
+}
+
+ErrorCodeE Monitor::_Receive(Auto& UNUSED(fd), String& UNUSED(data)) {
+  return ENotFound;
+}
+
 ErrorCodeE Monitor::Remove(Auto fd) {
   using namespace Internal;
 
@@ -86,11 +123,16 @@ ErrorCodeE Monitor::Trigger(Auto event, Perform perform) {
 }
 
 void Monitor::Registry(Check check, Indicate indicate) {
-  if (_Indicators.find(GetAddress(check)) == _Indicators.end()) {
-    _Checks.push_back(check);
+  ULong address = GetAddress(check);
+
+  for (auto& dispatcher : _Dispatchers) {
+    if (dispatcher.Address == address) {
+      dispatcher.Indicator = indicate;
+      return;
+    }
   }
 
-  _Indicators[GetAddress(check)] = indicate;
+  _Dispatchers.push_back(Dispatcher{address, check, indicate});
 }
 
 void Monitor::Heartbeat(Fallback fallback) { _Fallbacks.push_back(fallback); }
@@ -99,21 +141,18 @@ ErrorCodeE Monitor::Status(String name) {
   using namespace Internal;
 
   if (name == "active") {
-    auto UNUSED(guranteer) = Secure.generate();
-
-    return Monitors[_Type].Left == this ? ENoError : EInterrupted;
+    return READ_ONCE(_Links->Left) == this ? ENoError : EInterrupted;
   } else {
     return Head()->_Status(name, Auto::As<Int>(-1));
   }
 }
 
-ErrorCodeE Monitor::Scan(Auto fd, Int mode,
-                         Vector<Pair<Monitor *, Perform *>> &callbacks) {
+ErrorCodeE Monitor::Scan(Auto &fd, Int mode, Batch &callbacks) {
   return ScanImpl(fd, mode, True, callbacks);
 }
 
-ErrorCodeE Monitor::ScanImpl(Auto fd, Int mode, Bool heading,
-                             Vector<Pair<Monitor *, Perform *>> &callbacks) {
+ErrorCodeE Monitor::ScanImpl(Auto &fd, Int mode, Bool heading,
+                             Batch &callbacks) {
   using namespace Internal;
 
   ErrorCodeE error = ENoError;
@@ -126,52 +165,69 @@ ErrorCodeE Monitor::ScanImpl(Auto fd, Int mode, Bool heading,
 
   if (heading && this != Head()) {
     return EBadAccess;
-  } else if (_Find(fd)) {
-    return ENotFound;
   }
 
   if (!ScanIter(fd, mode, &next, callbacks)) {
     passed = True;
   }
 
-  MLocks[_Type].Safe([&]() {
+  /* @NOTE: this runs on every event, so the lock is taken by hand instead of
+   * wrapping the loop inside a Function which would be allocated each time */
+  auto &lock = *_Locker;
+
+  lock(True);
+
+  try {
+    Epoch::Guard guard{};
+
     MCOPY(&next, &_Next, sizeof(_Next));
 
-    try {
-      while (next) {
-        if (!next->ScanIter(fd, mode, &next, callbacks)) {
-          passed = True;
-        }
+    while (next) {
+      if (!next->ScanIter(fd, mode, &next, callbacks)) {
+        passed = True;
       }
-    } catch (Base::Exception &except) {
-      error = except.code();
     }
-  });
+  } catch (Base::Exception &except) {
+    error = except.code();
+  } catch (...) {
+    lock(False);
+    throw;
+  }
 
+  lock(False);
   return passed ? error : ENotFound;
 }
 
-ErrorCodeE Monitor::ScanIter(Auto fd, Int mode, Monitor **next,
-                             Vector<Pair<Monitor *, Perform *>> &callbacks) {
+ErrorCodeE Monitor::ScanIter(Auto &fd, Int mode, Monitor **next,
+                             Batch &callbacks) {
   Bool passed = False;
 
   /* @NOTE: i assume we are in safe zone, or we might face core dump somewhere
    * here or when we remove the child while the head access it on parallel */
 
+  if (next) {
+    *next = _Next;
+  }
+
   if (_State != EStarted) {
     return EBadAccess;
+  } else if (_Find(fd)) {
+    /* @NOTE: HEAD polls fds of every Monitor, only the owners have callbacks
+     * for them */
+
+    return ENotFound;
   }
 
-  for (auto &check : _Checks) {
-    if (!check(fd, _Access(fd), mode)) {
-      auto callback = _Indicators[GetAddress(check)](fd, mode);
+  for (auto &dispatcher : _Dispatchers) {
+    if (!dispatcher.Checker(fd, _Access(fd), mode)) {
+      auto callback = dispatcher.Indicator(fd, mode);
 
       if (callback) {
         if (Claim()) {
           Bug(EBadLogic, "can\'t claim a new job as expected");
         }
 
-        callbacks.push_back(Pair<Monitor *, Perform *>(this, callback));
+        callbacks.Push(Batch::Item(this, callback));
         passed = True;
 
         Done();
@@ -179,20 +235,16 @@ ErrorCodeE Monitor::ScanIter(Auto fd, Int mode, Monitor **next,
     }
   }
 
-  if (next) {
-    *next = _Next;
-  }
-
   return passed ? ENoError : ENotFound;
 }
 
-ErrorCodeE Monitor::Heartbeat(Auto fd) {
+ErrorCodeE Monitor::Heartbeat(Auto &fd) {
   ErrorCodeE result{ENoError};
 
   if (_Find(fd)) {
     ForEach([&](Monitor *next) -> ErrorCodeE {
       if ((next)->_Find(fd)) {
-        for (auto fallback : next->_Fallbacks) {
+        for (auto &fallback : next->_Fallbacks) {
           result = fallback(fd);
         }
       }
@@ -202,7 +254,7 @@ ErrorCodeE Monitor::Heartbeat(Auto fd) {
 
     return result;
   } else {
-    for (auto fallback : _Fallbacks) {
+    for (auto &fallback : _Fallbacks) {
       if ((result = fallback(fd))) {
         return result;
       }
@@ -212,7 +264,7 @@ ErrorCodeE Monitor::Heartbeat(Auto fd) {
   return ENoError;
 }
 
-ErrorCodeE Monitor::Reroute(Monitor *child, Auto fd, Perform &callback) {
+ErrorCodeE Monitor::Reroute(Monitor *child, Auto &fd, Perform &callback) {
   auto error = child->_Route(fd, callback);
 
   if (error) {
@@ -227,6 +279,31 @@ ErrorCodeE Monitor::Reroute(Monitor *child, Auto fd, Perform &callback) {
   return error;
 }
 
+Monitor::Batch::Batch() : _Size{0} {}
+
+void Monitor::Batch::Push(Item item) {
+  if (_Size < EInline) {
+    _Inline[_Size].Left = item.Left;
+    _Inline[_Size].Right = item.Right;
+  } else {
+    if (_Size == EInline) {
+      _Spilled.assign(_Inline, _Inline + EInline);
+    }
+
+    _Spilled.push_back(item);
+  }
+
+  _Size++;
+}
+
+ULong Monitor::Batch::Size() { return _Size; }
+
+Monitor::Batch::Item *Monitor::Batch::begin() {
+  return _Size > EInline ? _Spilled.data() : _Inline;
+}
+
+Monitor::Batch::Item *Monitor::Batch::end() { return begin() + _Size; }
+
 ErrorCodeE Monitor::Claim(UInt retry) {
   ErrorCodeE result{EDoAgain};
 
@@ -269,22 +346,20 @@ UInt Monitor::State() { return _State; }
 
 Void *Monitor::Context() { return _Shared; }
 
-Monitor *&Monitor::Head() { return Internal::Monitors[_Type].Right; }
+Monitor *&Monitor::Head() { return _Links->Right; }
 
 Bool Monitor::Attach(UInt retry) {
   using namespace Internal;
 
   auto thiz = this;
-  auto plock = &Monitors[_Type].Left;
-  auto phead = &Monitors[_Type].Right;
+  auto plock = &_Links->Left;
+  auto phead = &_Links->Right;
   auto touched = False;
 
   if (!CMP(&_State, EOffline)) {
     return True;
   }
 
-  CreateIfNeeded(_Type);
-
   do {
     BARRIER();
 
@@ -292,7 +367,7 @@ Bool Monitor::Attach(UInt retry) {
       if (CMPXCHG(plock, None, this)) {
         _PLast = &_Last;
 
-        MCOPY(&(Monitors[_Type].Right), &thiz, sizeof(this));
+        MCOPY(&_Links->Right, &thiz, sizeof(this));
         MCOPY(&_Head, &thiz, sizeof(this));
         MCOPY(&_Last, &thiz, sizeof(this));
 
@@ -342,6 +417,10 @@ Bool Monitor::Attach(UInt retry) {
     retry--;
   } while (retry > 0);
 
+  if (touched) {
+    _Token = _Children->Add(this);
+  }
+
   CMPXCHG(plock, this, None);
 
   if (retry == 0 && !touched) {
@@ -362,8 +441,8 @@ Bool Monitor::Detach(UInt retry) {
   auto is_latest = False;
   auto is_locked = False;
   auto is_detached = False;
-  auto plock = &(Monitors[_Type].Left);
-  auto phead = &(Monitors[_Type].Right);
+  auto plock = &_Links->Left;
+  auto phead = &_Links->Right;
 
   if (!!CMP(&_State, EDetached)) {
     return True;
@@ -410,9 +489,10 @@ Bool Monitor::Detach(UInt retry) {
       auto pnext = _PNext;
 
       /* @NOTE: edit the next pointer of the previous node using pnext so we
-       * could optimize performance while keep everything safe */
+       * could optimize performance while keep everything safe. It's done
+       * even if we are the latest one, the previous node must not keep us */
 
-      if (pnext && next) {
+      if (pnext) {
         MCOPY(pnext, &next, sizeof(next));
       }
 
@@ -434,9 +514,10 @@ Bool Monitor::Detach(UInt retry) {
 
       /* @NOTE: if the head is going to detach, we should migrate to the next
        * one so the system still works well even if the head is changing on
-       * realtime */
+       * realtime. Every Monitor keeps itself as _Head so we must check the
+       * real head, or a child which leaves would steal the head's place */
 
-      if (CMP(&_Head, this)) {
+      if (CMP(phead, this)) {
         MCOPY(phead, &_Next, sizeof(_Next));
 
         if (_Next == None) {
@@ -444,6 +525,10 @@ Bool Monitor::Detach(UInt retry) {
         }
       }
 
+      if (_Token && _Children->Del(_Token, this)) {
+        _Token = 0;
+      }
+
       break;
     }
 
@@ -456,6 +541,12 @@ Bool Monitor::Detach(UInt retry) {
     return False;
   }
 
+  /* @NOTE: the head might still walk through this Monitor with ForEach or
+   * Scan, wait until they are done so the owner can release it safely. If
+   * we are called inside these methods, we can't wait so it's up to them */
+
+  Epoch::Synchronize();
+
   if (is_child) {
     goto finish;
   }
@@ -479,8 +570,8 @@ Bool Monitor::Devote(UInt retry) {
   using namespace Internal;
 
   auto thiz = this;
-  auto plock = &Monitors[_Type].Left;
-  auto phead = &Monitors[_Type].Right;
+  auto plock = &_Links->Left;
+  auto phead = &_Links->Right;
   auto touched = False;
 
   /* @NOTE: we assume that Devote is called when the old Head is abandoned
@@ -536,158 +627,58 @@ Bool Monitor::Devote(UInt retry) {
     retry--;
   } while (retry > 0);
 
+  if (touched && !_Token) {
+    _Token = _Children->Add(this);
+  }
+
   CMPXCHG(plock, this, None);
   return touched;
 }
 
 ErrorCodeE Monitor::ForEach(Function<ErrorCodeE(Monitor *)> callback,
                             UInt retry) {
-  Monitor **pnext{&Next()}, **pcurr{None}, *claiming{None};
+  using namespace Internal;
+
   ErrorCodeE result{ENoError};
-  UInt timeout{0};
-  Bool first{True};
+  Bool passed{this == Head()};
 
   /* @NOTE: check from children, we wouldn't know it without checking
    * them because some polling system don't support checking how many
-   * fd has waiting */
+   * fd has waiting. Children are attached to the end of the list so the
+   * ones behind us are the ones we should visit, the head visits everyone */
 
-  do {
-    Bool ceased{False};
-    TimeSpec spec{.tv_sec = 0, .tv_nsec = 1};
-    ErrorCodeE error{EBadAccess};
+  _Children->ForEach([&](ULong, Void *pointer) -> ErrorCodeE {
+    Monitor *child = (Monitor *)pointer;
 
-    if (pcurr && !claiming) {
-      /* @NOTE: this case only happens when we finish claiming a new job so
-       * we can close the old job here */
+    if (child == this) {
+      passed = True;
+      return ENoError;
+    } else if (!passed || child->Claim(retry)) {
+      /* @NOTE: the child is starting or stopping, just skip it since we
+       * shouldn't wait for anyone here */
 
-      if ((error = (*pcurr)->Done())) {
-        Bug(error, "can\'t close an unfinished job");
-      } else {
-        pcurr = None;
-        error = pnext ? ENoError : EBadAccess;
-      }
-    } else if (first) {
-      goto init;
+      return ENoError;
     }
 
-    BARRIER();
+    /* @NOTE: we have claimed a new job successfully so the child can't be
+     * detached until we mark this job `Done` */
 
-    if (claiming && pnext && !result) {
-      /* @NOTE: wait pnext switches to another Monitor since the current pnext
-       * is pointing to a detaching Monitor object */
-
-      for (timeout = 0; timeout < retry && CMP(pnext, claiming); ++timeout) {
-        BARRIER();
-
-        spec.tv_nsec = (spec.tv_nsec * 2) % ULong(1e9);
-        Internal::Idle(&spec);
-      }
-
-      if (timeout == retry) {
-        ceased = True;
-      }
-    init:
-      error = EBadAccess;
-
-      BARRIER();
-
-      /* @NOTE; everything is okay recently so we should try claiming again with
-       * the new Monitor object */
-
-      for (timeout = 0; timeout < retry && !ceased && (*pnext); ++timeout) {
-        if ((error = (*pnext)->Claim()) != EDoAgain) {
-          break;
-        }
-
-        BARRIER();
-
-        spec.tv_nsec = (spec.tv_nsec * 2) % ULong(1e9);
-        Internal::Idle(&spec);
-      }
-
-      if (timeout == retry) {
-        ceased = True;
-      }
-
-      /* @NOTE: at the begining, we should claim the next Monitor first, so we
-       * can init the flow */
-
-      first = False;
+    try {
+      result = callback(child);
+    } catch (Exception &except) {
+      result = except.code();
+    } catch (std::exception &except) {
+      result = EBadAccess;
+    } catch (...) {
+      result = EBadAccess;
     }
 
-    /* @NOTE: we have retried claiming again so if the issue happens, it
-     * isn't out of caring recently, just finish the task we have claimed
-     * to be done before */
-
-    if (pcurr) {
-      if ((*pcurr)->Done()) {
-        Bug(EBadAccess, "can\'t close an unfinished job");
-      } else {
-        pcurr = None;
-      }
+    if (child->Done()) {
+      Bug(EBadAccess, "can\'t close an unfinished job");
     }
 
-    if (!ceased && !error) {
-      /* @NOTE: we only enter here if we have claimed successfully a new job
-       * so we will perform it on parallel while make sure that the node
-       * can't be detached */
-
-      try {
-        result = callback(*pnext);
-        pcurr = pnext;
-        pnext = &((*pnext)->Next());
-        claiming = *pnext;
-      } catch (Exception &except) {
-        result = except.code();
-      } catch (std::exception &except) {
-        result = EBadAccess;
-      } catch (...) {
-        result = EBadAccess;
-      }
-
-      /* @NOTE: if we face any issue during testing just stop claiming new job
-       * and mark the current job is `Done` */
-
-      if (result) {
-        pnext = None;
-        claiming = None;
-        continue;
-      }
-
-      BARRIER();
-
-      if (*pnext) {
-        error = EBadAccess;
-
-        /* @NOTE: claim a new job so we could make sure that the loop can't
-         * be jump into unexpected states */
-
-        for (timeout = 0; timeout < retry && (*pnext); ++timeout) {
-          if ((error = (*pnext)->Claim()) != EDoAgain) {
-            break;
-          }
-
-          BARRIER();
-
-          spec.tv_nsec = (spec.tv_nsec * 2) % ULong(1e9);
-          Internal::Idle(&spec);
-        }
-
-        /* @NOTE; if we claim successfully the next job, we are in good flow
-         * where we have threads lining on the right direction. If not, we
-         * should report that we can't claim a new job. This only happen
-         * when we access the node too late and we should wait until the next
-         * child emerges */
-
-        if (!error) {
-          claiming = None;
-        }
-      } else {
-        claiming = None;
-        pnext = None;
-      }
-    }
-  } while (pcurr);
+    return result;
+  });
 
   return result;
 }
@@ -709,7 +700,7 @@ ErrorCodeE Monitor::Loop(Function<Bool(Monitor &)> status, Int timeout) {
   ErrorCodeE error = EBadAccess;
 
   do {
-    if (IsHead(_Type, dynamic_cast<Monitor *>(this))) {
+    if (CMP(&_Links->Right, dynamic_cast<Monitor *>(this))) {
       error = _Interact(this, timeout);
     } else {
       error = _Handle(this, timeout);
@@ -741,8 +732,28 @@ Shared<Monitor> Monitor::Make(String name, UInt type) {
       return None;
     }
 
+  case ETimer:
+    if (Internal::Fildes::Create(name, type, 0, &result)) {
+      return Shared<Monitor>(result);
+    } else {
+      return None;
+    }
+
+  case EIOUring:
+    if (Internal::Fildes::Create(name, type, 3, &result)) {
+      return Shared<Monitor>(result);
+    } else {
+      return None;
+    }
+
   default:
-    if (Internal::Builders.find(type) == Internal::Builders.end()) {
+    if (type >= EShard && type <= ELastShard) {
+      if (Internal::Fildes::Create(name, type, 0, &result)) {
+        return Shared<Monitor>(result);
+      } else {
+        return None;
+      }
+    } else if (Internal::Builders.find(type) == Internal::Builders.end()) {
       throw Except(ENoSupport, name);
     } else if (Internal::Builders[type](name, type, &result)) {
       return Shared<Monitor>(result);
@@ -755,7 +766,9 @@ Shared<Monitor> Monitor::Make(String name, UInt type) {
 Bool Monitor::Sign(UInt type, Bool (*builder)(String, UInt, Monitor **)) {
   using namespace Base::Internal;
 
-  if (type == EIOSync || type == EPipe || type == ETimer) {
+  if (type == EIOSync || type == EPipe || type == ETimer || type == EIOUring) {
+    return False;
+  } else if (type >= EShard && type <= ELastShard) {
     return False;
   } else if (Builders.find(type) != Builders.end()) {
     return False;
@@ -772,41 +785,60 @@ Bool Monitor::IsSupport(UInt type) {
     return True;
 
   case ETimer:
+  case EIOUring:
+#if LINUX
+    return True;
+#else
     return False;
+#endif
 
   default:
+    if (type >= EShard && type <= ELastShard) {
+      return True;
+    }
+
     return Internal::Builders.find(type) != Internal::Builders.end();
   }
 }
 
 Bool Monitor::IsHead(UInt type, Monitor *sample) {
-  if (Internal::Monitors.find(type) == Internal::Monitors.end()) {
+  Pair<Monitor *, Monitor *> *links{None};
+  Base::Lock *locker{None};
+
+  if (!Internal::Lookup(type, &links, &locker)) {
     return False;
   } else {
-    return CMP(&Internal::Monitors[type].Right, sample);
+    return CMP(&links->Right, sample);
   }
 }
 
 Monitor *Monitor::Head(UInt type) {
+  Pair<Monitor *, Monitor *> *links{None};
+  Base::Lock *locker{None};
   Monitor *result{None};
 
-  if (Internal::Monitors.find(type) != Internal::Monitors.end()) {
-    Internal::MLocks[type].Safe(
-        [&]() { result = Internal::Monitors[type].Right; });
+  if (Internal::Lookup(type, &links, &locker)) {
+    locker->Safe([&]() { result = links->Right; });
   }
 
   return result;
 }
 
 void Monitor::Lock(UInt type) {
-  if (Internal::MLocks.find(type) != Internal::MLocks.end()) {
-    Internal::MLocks[type](True);
+  Pair<Monitor *, Monitor *> *links{None};
+  Base::Lock *locker{None};
+
+  if (Internal::Lookup(type, &links, &locker)) {
+    (*locker)(True);
   }
 }
 
 void Monitor::Unlock(UInt type) {
-  if (Internal::MLocks.find(type) != Internal::MLocks.end()) {
-    Internal::MLocks[type](False);
+  Pair<Monitor *, Monitor *> *links{None};
+  Base::Lock *locker{None};
+
+  if (Internal::Lookup(type, &links, &locker)) {
+    (*locker)(False);
   }
 }
 } // namespace Base
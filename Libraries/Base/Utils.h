@@ -139,6 +139,18 @@ struct Pair {
   Pair(const Pair& src) : Left{src.Left}, Right{src.Right} {}
 };
 
+/* @NOTE: a borrowed piece of memory, usually the content of a String, it's
+ * used to look keys up without building temporary Strings. The memory must
+ * outlive the View */
+struct View {
+  const Char* Data;
+  ULong Size;
+
+  View(const Char* data, ULong size): Data{data}, Size{size} {}
+  View(const Char* data): Data{data}, Size{data? strlen(data): 0} {}
+  View(const String& str): Data{str.c_str()}, Size{str.size()} {}
+};
+
 template<typename Type>
 String Nametype() {
   auto& type = typeid(Type);
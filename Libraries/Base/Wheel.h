@@ -0,0 +1,387 @@
+#ifndef BASE_WHEEL_H_
+#define BASE_WHEEL_H_
+#include <Config.h>
+
+#if USE_BASE_WITH_FULL_PATH_HEADER
+#include <Base/Exception.h>
+#include <Base/Type.h>
+#else
+#include <Exception.h>
+#include <Type.h>
+#endif
+
+#include <utility>
+
+#if __cplusplus
+namespace Base {
+/* @NOTE: a hierarchical timing wheel in the style of the old timers of Linux.
+ * Time is counted in ticks and there are 4 levels of 256 slots, level L keeps
+ * the timers which are due in less than 256^(L+1) ticks and they are moved
+ * down when level 0 wraps. Put and Cancel are O(1) and Advance only touches
+ * the slots which are due, empty ones are skipped with bitmaps.
+ *
+ * Timers are kept in chunks which never move, so the value which is given to
+ * the callback of Advance stays valid even if the callback puts new timers.
+ * The wheel isn't thread-safe, its owner must lock it */
+template<typename ValueT>
+class Wheel {
+ public:
+  using Handle = ULong;
+
+  explicit Wheel(ULong now = 0): _Base{now}, _Size{0}, _Free{ENil},
+                                 _Firing{ENil}, _Current{ENil},
+                                 _Cancelled{False} {
+    for (auto& head : _Heads) {
+      head = ENil;
+    }
+
+    for (auto& level : _Bits) {
+      for (auto& word : level) {
+        word = 0;
+      }
+    }
+  }
+
+  Wheel(const Wheel&) = delete;
+  Wheel& operator=(const Wheel&) = delete;
+
+  ~Wheel() {
+    for (auto chunk : _Chunks) {
+      delete[] chunk;
+    }
+  }
+
+  /* @NOTE: how many timers are waiting */
+  ULong Size() { return _Size; }
+
+  /* @NOTE: the first tick which hasn't been advanced */
+  ULong Base() { return _Base; }
+
+  /* @NOTE: put a timer which is due at tick `expiry` and then every `period`
+   * ticks if period isn't 0. A timer which is already due fires on the next
+   * Advance */
+  Handle Put(ULong expiry, ValueT value, ULong period = 0) {
+    UInt index = Allocate();
+    Node& node = At(index);
+
+    node.Expiry = expiry;
+    node.Period = period;
+    node.Value = std::move(value);
+
+    Link(index);
+    _Size++;
+
+    return (ULong(node.Generation) << 32) | index;
+  }
+
+  /* @NOTE: cancel a timer, a timer which is firing can cancel itself and it
+   * won't be put again if it's periodic */
+  ErrorCodeE Cancel(Handle handle) {
+    UInt index = UInt(handle);
+
+    if (!IsAlive(handle)) {
+      return ENotFound;
+    } else if (index == _Current) {
+      _Cancelled = True;
+    } else {
+      Unlink(index);
+      Release(index);
+    }
+
+    return ENoError;
+  }
+
+  /* @NOTE: access the value of a timer */
+  ValueT* Find(Handle handle) {
+    return IsAlive(handle)? &At(UInt(handle)).Value: None;
+  }
+
+  /* @NOTE: the tick when Advance has something to do, it might be earlier
+   * than the first expiry since far timers must be moved down first. It's
+   * ~0 when the wheel is empty */
+  ULong Next() {
+    ULong result{~0ULL};
+    Int found;
+
+    if (_Size == 0) {
+      return result;
+    }
+
+    if ((found = Search(0, _Base & EMask)) >= 0) {
+      result = _Base + ((UInt(found) - _Base) & EMask);
+    }
+
+    for (UInt level = 1; level < ELevels; ++level) {
+      UInt shift = level*EBits;
+      ULong unit = (_Base + (1ULL << shift) - 1) >> shift;
+
+      if ((found = Search(level, unit & EMask)) >= 0) {
+        unit += (UInt(found) - unit) & EMask;
+
+        if ((unit << shift) < result) {
+          result = unit << shift;
+        }
+      }
+    }
+
+    return result;
+  }
+
+  /* @NOTE: fire every timer which is due at or before tick `now`, callback
+   * is called as `callback(handle, value)` and this method returns how many
+   * timers have been fired */
+  template<typename CallbackT>
+  ULong Advance(ULong now, CallbackT callback) {
+    ULong count{0};
+
+    while (_Base <= now) {
+      UInt index = _Base & EMask;
+
+      if (index == 0) {
+        for (UInt level = 1; level < ELevels; ++level) {
+          UInt slot = (_Base >> (level*EBits)) & EMask;
+
+          Cascade(level, slot);
+
+          if (slot != 0) {
+            break;
+          }
+        }
+      }
+
+      /* @NOTE: _Base moves first, so timers which are put by callbacks are
+       * never linked to the slot which is firing */
+      ULong tick = _Base++;
+
+      if (_Heads[index] != ENil) {
+        _Firing = _Heads[index];
+        _Heads[index] = ENil;
+        Clear(0, index);
+
+        for (UInt i = _Firing; i != ENil; i = At(i).Next) {
+          At(i).Slot = EFiring;
+        }
+
+        while (_Firing != ENil) {
+          UInt current = _Firing;
+          Node& node = At(current);
+          Handle handle = (ULong(node.Generation) << 32) | current;
+
+          Unlink(current);
+
+          _Current = current;
+          _Cancelled = False;
+
+          callback(handle, node.Value);
+          count++;
+
+          _Current = ENil;
+
+          if (node.Period > 0 && !_Cancelled) {
+            ULong missed = now > tick? (now - tick)/node.Period: 0;
+
+            /* @NOTE: periods which have been missed are skipped, the timer
+             * keeps its phase */
+            node.Expiry = tick + (missed + 1)*node.Period;
+            Link(current);
+          } else {
+            Release(current);
+          }
+        }
+      }
+
+      /* @NOTE: jump to the next tick which has timers or must move an upper
+       * slot down, ticks between them are empty */
+      if (_Base <= now) {
+        ULong next = Next();
+
+        if (next > _Base) {
+          _Base = next < now + 1? next: now + 1;
+        }
+      }
+    }
+
+    return count;
+  }
+
+ private:
+  enum {
+    EBits = 8,
+    ESlots = 1 << EBits,
+    EMask = ESlots - 1,
+    ELevels = 4,
+    EChunk = 4096
+  };
+
+  static constexpr UInt ENil = ~0u;
+  static constexpr UInt EFiring = ELevels*ESlots;
+  static constexpr UInt EUnused = ELevels*ESlots + 1;
+
+  struct Node {
+    ULong Expiry, Period;
+    UInt Prev, Next, Slot, Generation;
+    ValueT Value;
+  };
+
+  Node& At(UInt index) { return _Chunks[index/EChunk][index % EChunk]; }
+
+  Bool IsAlive(Handle handle) {
+    UInt index = UInt(handle);
+
+    if (index >= _Chunks.size()*EChunk) {
+      return False;
+    }
+
+    return At(index).Generation == UInt(handle >> 32) &&
+           At(index).Slot != EUnused;
+  }
+
+  UInt Allocate() {
+    UInt index = _Free;
+
+    if (index == ENil) {
+      UInt first = _Chunks.size()*EChunk;
+
+      _Chunks.push_back(new Node[EChunk]);
+
+      /* @NOTE: new nodes are chained to the free list from the last one so
+       * they are taken in order */
+      for (UInt i = EChunk; i > 0; --i) {
+        Node& node = At(first + i - 1);
+
+        node.Generation = 1;
+        node.Slot = EUnused;
+        node.Next = _Free;
+        _Free = first + i - 1;
+      }
+
+      index = _Free;
+    }
+
+    _Free = At(index).Next;
+    return index;
+  }
+
+  void Release(UInt index) {
+    Node& node = At(index);
+
+    /* @NOTE: the value is dropped now so whatever it keeps is released, the
+     * generation makes every handle of this node invalid */
+    node.Value = ValueT{};
+    node.Slot = EUnused;
+    node.Generation++;
+    node.Next = _Free;
+
+    _Free = index;
+    _Size--;
+  }
+
+  void Link(UInt index) {
+    Node& node = At(index);
+    ULong expiry = node.Expiry < _Base? _Base: node.Expiry;
+    ULong delta = expiry - _Base;
+    UInt level = 0;
+
+    /* @NOTE: a timer which is too far is parked on the last level, it's put
+     * again with its real expiry when its slot is moved down */
+    if (delta >> (ELevels*EBits)) {
+      delta = (1ULL << (ELevels*EBits)) - 1;
+      expiry = _Base + delta;
+    }
+
+    while (level + 1 < ELevels && delta >= (1ULL << ((level + 1)*EBits))) {
+      level++;
+    }
+
+    node.Slot = level*ESlots + ((expiry >> (level*EBits)) & EMask);
+    node.Prev = ENil;
+    node.Next = _Heads[node.Slot];
+
+    if (node.Next != ENil) {
+      At(node.Next).Prev = index;
+    }
+
+    _Heads[node.Slot] = index;
+    _Bits[level][(node.Slot & EMask) >> 6] |= 1ULL << (node.Slot & 63);
+  }
+
+  void Unlink(UInt index) {
+    Node& node = At(index);
+    UInt* head = node.Slot == EFiring? &_Firing: &_Heads[node.Slot];
+
+    if (node.Prev != ENil) {
+      At(node.Prev).Next = node.Next;
+    } else {
+      *head = node.Next;
+    }
+
+    if (node.Next != ENil) {
+      At(node.Next).Prev = node.Prev;
+    }
+
+    if (node.Slot < EFiring && *head == ENil) {
+      Clear(node.Slot/ESlots, node.Slot & EMask);
+    }
+
+    node.Prev = node.Next = ENil;
+  }
+
+  void Clear(UInt level, UInt slot) {
+    _Bits[level][slot >> 6] &= ~(1ULL << (slot & 63));
+  }
+
+  /* @NOTE: move the timers of a slot to lower levels */
+  void Cascade(UInt level, UInt slot) {
+    UInt index = _Heads[level*ESlots + slot];
+
+    _Heads[level*ESlots + slot] = ENil;
+    Clear(level, slot);
+
+    while (index != ENil) {
+      UInt next = At(index).Next;
+
+      Link(index);
+      index = next;
+    }
+  }
+
+  /* @NOTE: find the first slot of a level which has timers, starting from
+   * `from` and wrapping around. It returns -1 when the level is empty */
+  Int Search(UInt level, UInt from) {
+    for (UInt i = 0; i <= ESlots/64; ++i) {
+      UInt word = ((from >> 6) + i) % (ESlots/64);
+      ULong bits = _Bits[level][word];
+
+      if (i == 0) {
+        bits &= ~0ULL << (from & 63);
+      } else if (i == ESlots/64) {
+        bits &= (1ULL << (from & 63)) - 1;
+      }
+
+      if (bits) {
+        return word*64 + __builtin_ctzll(bits);
+      }
+    }
+
+    return -1;
+  }
+
+  Vector<Node*> _Chunks;
+  ULong _Bits[ELevels][ESlots/64];
+  UInt _Heads[ELevels*ESlots];
+  ULong _Base, _Size;
+  UInt _Free, _Firing, _Current;
+  Bool _Cancelled;
+};
+
+template<typename ValueT>
+constexpr UInt Wheel<ValueT>::ENil;
+
+template<typename ValueT>
+constexpr UInt Wheel<ValueT>::EFiring;
+
+template<typename ValueT>
+constexpr UInt Wheel<ValueT>::EUnused;
+} // namespace Base
+#endif
+#endif // BASE_WHEEL_H_
@@ -1,3 +1,4 @@
+#include <Hash.h>
 #include <Table.h>
 #include <iostream>
 
@@ -87,8 +88,11 @@ ULong Table::Index(ULong hashing){
    * this formular:
    *    mod(hashing, 2^level) = hashing & (2^level - 1)
    *                          = hashing & (~(2^level))
+   *
+   * Only the low bits are used, so the hash is mixed first since callers
+   * usually give us weak hashes which only differ in their high bits
    */
 
-  return hashing & (~_Maximum);
+  return Hash::Mix(hashing) & (~_Maximum);
 }
 }  // namespace Base
@@ -0,0 +1,250 @@
+#include <Acceptor.h>
+#include <Atomic.h>
+#include <Monitor.h>
+#include <Thread.h>
+#include <Unittest.h>
+#include <Utils.h>
+
+#include <chrono>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define NUM_OF_CLIENTS 4
+#define NUM_OF_CONNECTIONS 2000
+
+using namespace Base;
+
+/* @NOTE: open a blocking connection to our acceptor */
+static Int Connect(UInt port) {
+  sockaddr_in addr;
+  Int fd;
+
+  if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+TEST(Acceptor, Echo) {
+  Base::Acceptor acceptor{2};
+  ULong wrong{0}, connections{0};
+
+  EXPECT_EQ(acceptor.Size(), 2u);
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor& monitor) -> ErrorCodeE {
+    if (&monitor != &acceptor.At(0) && &monitor != &acceptor.At(1)) {
+      INC(&wrong);
+    }
+
+    /* @NOTE: the connection is watched by the shard which accepts it, the
+     * fd is released when the client closes it */
+    return monitor.Trigger(Auto::As<Int>(socket),
+                           [](Auto fd, Auto&) -> ErrorCodeE {
+                             Char buffer[64];
+                             Long size;
+
+                             while ((size = read(fd.Get<Int>(), buffer,
+                                                 sizeof(buffer))) > 0) {
+                               if (write(fd.Get<Int>(), buffer, size) != size) {
+                                 return EBadAccess;
+                               }
+                             }
+
+                             return size == 0? EDoNothing: ENoError;
+                           });
+  }), ENoError);
+
+  EXPECT_NEQ(acceptor.Port(), 0u);
+
+  /* @NOTE: listening twice is a mistake */
+  EXPECT_NEQ(acceptor.Listen("127.0.0.1", 0, None), ENoError);
+
+  for (UInt i = 0; i < 50; ++i) {
+    Int fd = Connect(acceptor.Port());
+    Char buffer[4];
+
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(write(fd, "ping", 4), 4);
+    EXPECT_EQ(read(fd, buffer, 4), 4);
+    EXPECT_EQ(memcmp(buffer, "ping", 4), 0);
+
+    close(fd);
+    connections++;
+  }
+
+  EXPECT_EQ(acceptor.Stop(), ENoError);
+  EXPECT_EQ(acceptor.Accepted(0) + acceptor.Accepted(1), connections);
+  EXPECT_EQ(wrong, 0ul);
+}
+
+TEST(Acceptor, Shards) {
+  Base::Acceptor first{3}, second{};
+
+  /* @NOTE: shards never share a HEAD, even between acceptors */
+  for (UInt i = 0; i < first.Size(); ++i) {
+    for (UInt j = 0; j < first.Size(); ++j) {
+      EXPECT_TRUE(i == j || &first.At(i) != &first.At(j));
+    }
+
+    for (UInt j = 0; j < second.Size(); ++j) {
+      EXPECT_TRUE(&first.At(i) != &second.At(j));
+    }
+  }
+
+  EXPECT_GE(second.Size(), 1u);
+  EXPECT_NEQ(first.Listen("localhost:80", 0, None), ENoError);
+  EXPECT_EQ(first.Port(), 0u);
+}
+
+TEST(Acceptor, Exhausted) {
+  using Clock = std::chrono::steady_clock;
+
+  Base::Acceptor acceptor{1};
+  Vector<Int> clients{}, fillers{};
+  ULong accepted{0};
+  rlimit saved, limit;
+  sockaddr_in addr;
+  Int fd;
+
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor&) -> ErrorCodeE {
+    INC(&accepted);
+    close(socket);
+    return ENoError;
+  }), ENoError);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(acceptor.Port());
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  for (UInt i = 0; i < NUM_OF_CLIENTS; ++i) {
+    EXPECT_GE((fd = socket(AF_INET, SOCK_STREAM, 0)), 0);
+    clients.push_back(fd);
+  }
+
+  /* @NOTE: use every fd which we may have, so the shard can't accept the
+   * clients even if it's woken up by them */
+
+  EXPECT_EQ(getrlimit(RLIMIT_NOFILE, &saved), 0);
+  limit = saved;
+  limit.rlim_cur = 512;
+  EXPECT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+
+  while ((fd = dup(clients[0])) >= 0) {
+    fillers.push_back(fd);
+  }
+
+  for (auto client : clients) {
+    EXPECT_EQ(connect(client, (sockaddr*)&addr, sizeof(addr)), 0);
+  }
+
+  usleep(100000);
+  EXPECT_EQ(READ_ONCE(accepted), 0ul);
+
+  /* @NOTE: fds are given back but no client connects anymore, so no new
+   * edge comes and the shard must try again by itself */
+
+  for (auto filler : fillers) {
+    close(filler);
+  }
+
+  EXPECT_EQ(setrlimit(RLIMIT_NOFILE, &saved), 0);
+
+  for (auto begin = Clock::now();
+       READ_ONCE(accepted) < NUM_OF_CLIENTS &&
+       Clock::now() - begin < std::chrono::seconds(5);) {
+    usleep(1000);
+  }
+
+  EXPECT_EQ(READ_ONCE(accepted), ULong(NUM_OF_CLIENTS));
+  EXPECT_EQ(acceptor.Stop(), ENoError);
+
+  for (auto client : clients) {
+    close(client);
+  }
+}
+
+TEST(AcceptorBenchmark, Connections) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Milli = std::chrono::milliseconds;
+
+  /* @NOTE: clients connect and wait until the server resets the connection,
+   * so we measure a full accept on the server side. Resetting leaves no
+   * TIME_WAIT behind so the ephemeral ports aren't exhausted */
+  for (UInt shards : {1u, 2u, 4u}) {
+    Base::Acceptor acceptor{shards};
+    Vector<Thread*> clients{};
+    ULong failed{0};
+
+    EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [](Int socket,
+                                                 Monitor&) -> ErrorCodeE {
+      struct linger linger{1, 0};
+
+      setsockopt(socket, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+      return EDoNothing;
+    }), ENoError);
+
+    auto begin = Clock::now();
+
+    for (UInt i = 0; i < NUM_OF_CLIENTS; ++i) {
+      clients.push_back(new Thread{True});
+      clients.back()->Start([&]() {
+        for (UInt j = 0; j < NUM_OF_CONNECTIONS; ++j) {
+          Int fd = Connect(acceptor.Port());
+          Char byte;
+
+          if (fd < 0) {
+            INC(&failed);
+            continue;
+          }
+
+          while (read(fd, &byte, 1) > 0) {}
+          close(fd);
+        }
+      });
+    }
+
+    for (auto client : clients) {
+      delete client;
+    }
+
+    ULong spent = std::chrono::duration_cast<Milli>(Clock::now() -
+                                                    begin).count();
+    ULong accepted{0};
+
+    acceptor.Stop();
+
+    for (UInt i = 0; i < acceptor.Size(); ++i) {
+      accepted += acceptor.Accepted(i);
+    }
+
+    EXPECT_EQ(failed, 0ul);
+    EXPECT_EQ(accepted, ULong(NUM_OF_CLIENTS*NUM_OF_CONNECTIONS));
+
+    INFO << Format{"acceptor with {} shards: {} connections, {} conn/s"}
+                .Apply(shards, accepted, accepted*1000/(spent? spent: 1))
+         << Base::EOL;
+  }
+}
+
+int main() {
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,488 @@
+#include <Acceptor.h>
+#include <Atomic.h>
+#include <Connection.h>
+#include <Monitor.h>
+#include <Unittest.h>
+#include <Utils.h>
+
+#include <chrono>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define NUM_OF_LINES 2000
+#define NUM_OF_MEGABYTES 256
+#define NUM_OF_PIPELINED 64
+#define NUM_OF_BURSTS 2000
+
+using namespace Base;
+
+/* @NOTE: open a blocking connection to our acceptor */
+static Int Connect(UInt port) {
+  sockaddr_in addr;
+  Int fd;
+
+  if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr))) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+static Bool Send(Int fd, const Char* data, ULong size) {
+  while (size > 0) {
+    Long sent = write(fd, data, size);
+
+    if (sent <= 0) {
+      return False;
+    }
+
+    data += sent;
+    size -= sent;
+  }
+
+  return True;
+}
+
+static Bool Receive(Int fd, Char* data, ULong size) {
+  while (size > 0) {
+    Long received = read(fd, data, size);
+
+    if (received <= 0) {
+      return False;
+    }
+
+    data += received;
+    size -= received;
+  }
+
+  return True;
+}
+
+/* @NOTE: wait until `flag` is set by a shard, we give up after 10s */
+static Bool Wait(ULong* flag) {
+  for (UInt i = 0; i < 10000 && !READ_ONCE(*flag); ++i) {
+    usleep(1000);
+  }
+
+  return READ_ONCE(*flag) != 0;
+}
+
+TEST(Connection, Lines) {
+  Base::Acceptor acceptor{1};
+  String expected{};
+  ULong wrong{0};
+
+  /* @NOTE: the server echoes whole lines only, a line may be split between
+   * reads and chunks so what hasn't been consumed must be kept */
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor& monitor) -> ErrorCodeE {
+    auto connection = Base::Connection::Make(monitor, socket,
+        [&](Base::Connection& connection, Buffer& input) -> ErrorCodeE {
+          Long end;
+
+          while ((end = input.Find('\n')) >= 0) {
+            Buffer line = input.Slice(0, end + 1);
+
+            if (connection.Write(line)) {
+              INC(&wrong);
+            }
+
+            input.Consume(end + 1);
+          }
+
+          return ENoError;
+        });
+
+    return connection ? ENoError : EBadAccess;
+  }), ENoError);
+
+  for (UInt i = 0; i < NUM_OF_LINES; ++i) {
+    expected.append(String(1 + (i * 37) % 300, Char('a' + i % 26)));
+    expected.append("\n");
+  }
+
+  Int fd = Connect(acceptor.Port());
+  String received(expected.size(), '\0');
+
+  EXPECT_GE(fd, 0);
+  EXPECT_TRUE(Send(fd, expected.c_str(), expected.size()));
+  EXPECT_TRUE(Receive(fd, (Char*)received.c_str(), received.size()));
+  EXPECT_TRUE(received == expected);
+  EXPECT_EQ(wrong, 0ul);
+
+  close(fd);
+  acceptor.Stop();
+}
+
+TEST(Connection, Slice) {
+  Base::Acceptor acceptor{1};
+  Buffer kept{};
+  ULong shared{0}, done{0};
+
+  /* @NOTE: a slice points to the bytes which we have read and it keeps them
+   * alive after they are consumed */
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor& monitor) -> ErrorCodeE {
+    auto connection = Base::Connection::Make(monitor, socket,
+        [&](Base::Connection&, Buffer& input) -> ErrorCodeE {
+          if (input.Size() < 5) {
+            return ENoError;
+          }
+
+          kept = input.Slice(1, 3);
+
+          if (kept.Count() == 1 && input.Count() == 1 &&
+              kept.At(0).Data == input.At(0).Data + 1) {
+            INC(&shared);
+          }
+
+          input.Consume(input.Size());
+          INC(&done);
+          return ENoError;
+        });
+
+    return connection ? ENoError : EBadAccess;
+  }), ENoError);
+
+  Int fd = Connect(acceptor.Port());
+
+  EXPECT_GE(fd, 0);
+  EXPECT_TRUE(Send(fd, "hello", 5));
+  EXPECT_TRUE(Wait(&done));
+  EXPECT_EQ(shared, 1ul);
+  EXPECT_EQ(kept.Size(), 3ul);
+  EXPECT_TRUE(kept.ToString() == "ell");
+
+  close(fd);
+  acceptor.Stop();
+}
+
+TEST(Connection, Close) {
+  Base::Acceptor acceptor{1};
+  Shared<Base::Connection> connection{None};
+  ULong closed{0}, received{0};
+
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor& monitor) -> ErrorCodeE {
+    connection = Base::Connection::Make(monitor, socket,
+        [&](Base::Connection& connection, Buffer& input) -> ErrorCodeE {
+          ADD(&received, input.Size());
+          input.Consume(input.Size());
+
+          if (connection.Closed()) {
+            INC(&closed);
+          }
+
+          return ENoError;
+        });
+
+    return connection ? ENoError : EBadAccess;
+  }), ENoError);
+
+  Int fd = Connect(acceptor.Port());
+
+  /* @NOTE: the last bytes and the close may come with the same event, the
+   * callback still sees the bytes before it's told about the close */
+  EXPECT_GE(fd, 0);
+  EXPECT_TRUE(Send(fd, "bye", 3));
+  close(fd);
+
+  EXPECT_TRUE(Wait(&closed));
+  EXPECT_EQ(closed, 1ul);
+  EXPECT_EQ(received, 3ul);
+  EXPECT_TRUE(connection && connection->Closed());
+  EXPECT_EQ(connection ? connection->Received() : 0, 3ul);
+
+  acceptor.Stop();
+}
+
+TEST(Connection, Pipeline) {
+  Base::Acceptor acceptor{1};
+  ULong queued{0}, lines{0};
+
+  /* @NOTE: replies of a burst are queued while the callback runs and sent
+   * together when it returns */
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor& monitor) -> ErrorCodeE {
+    auto connection = Base::Connection::Make(monitor, socket,
+        [&](Base::Connection& connection, Buffer& input) -> ErrorCodeE {
+          Long end;
+
+          while ((end = input.Find('\n')) >= 0) {
+            connection.Write("pong\n", 5);
+            input.Consume(end + 1);
+            INC(&lines);
+          }
+
+          /* @NOTE: nothing has been sent while we are here, every reply
+           * is still in the queue */
+          if (connection.Pending() ==
+              connection.Received() - connection.Sent()) {
+            INC(&queued);
+          }
+
+          return ENoError;
+        });
+
+    return connection ? ENoError : EBadAccess;
+  }), ENoError);
+
+  String burst{}, expected{};
+
+  for (UInt i = 0; i < 100; ++i) {
+    burst.append("ping\n");
+    expected.append("pong\n");
+  }
+
+  Int fd = Connect(acceptor.Port());
+  String received(expected.size(), '\0');
+
+  EXPECT_GE(fd, 0);
+  EXPECT_TRUE(Send(fd, burst.c_str(), burst.size()));
+  EXPECT_TRUE(Receive(fd, (Char*)received.c_str(), received.size()));
+  EXPECT_TRUE(received == expected);
+  EXPECT_EQ(lines, 100ul);
+  EXPECT_GE(queued, 1ul);
+
+  close(fd);
+  acceptor.Stop();
+}
+
+TEST(Connection, Backpressure) {
+  Base::Acceptor acceptor{1};
+  ULong produced{0}, resumed{0}, highest{0}, requests{0}, total{8 << 20};
+  Char block[16384];
+
+  memset(block, 'y', sizeof(block));
+
+  /* @NOTE: the producer writes while the connection is writable and it's
+   * resumed by the low watermark, the client doesn't read for a while so
+   * the socket becomes full */
+  auto produce = [&](Base::Connection& connection) {
+    while (connection.Writable() && produced < total) {
+      connection.Write(block, sizeof(block));
+      produced += sizeof(block);
+
+      if (connection.Pending() > highest) {
+        highest = connection.Pending();
+      }
+    }
+  };
+
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor& monitor) -> ErrorCodeE {
+    Int size{32 << 10};
+
+    setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    auto connection = Base::Connection::Make(monitor, socket,
+        [&](Base::Connection& connection, Buffer& input) -> ErrorCodeE {
+          if (input.Size() > 0) {
+            INC(&requests);
+          }
+
+          input.Consume(input.Size());
+          produce(connection);
+          return ENoError;
+        });
+
+    if (!connection) {
+      return EBadAccess;
+    }
+
+    connection->Watermarks(64 << 10, 256 << 10,
+                           [&](Base::Connection& connection) {
+                             INC(&resumed);
+                             produce(connection);
+                           });
+    return ENoError;
+  }), ENoError);
+
+  Int fd = Connect(acceptor.Port()), buffer{32 << 10};
+  ULong received{0}, stalled{0};
+  Char reply[16384];
+  Long size{0};
+
+  EXPECT_GE(fd, 0);
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+  EXPECT_TRUE(Send(fd, "go", 2));
+
+  /* @NOTE: the socket is full by now, so the producer must be waiting */
+  usleep(100000);
+  stalled = READ_ONCE(produced);
+
+  while (received < total && (size = read(fd, reply, sizeof(reply))) > 0) {
+    received += size;
+  }
+
+  EXPECT_LT(stalled, total);
+  EXPECT_EQ(received, total);
+  EXPECT_EQ(produced, total);
+  EXPECT_GE(resumed, 1ul);
+  EXPECT_LE(highest, ULong((256 << 10) + sizeof(block)));
+
+  /* @NOTE: the queue is empty so we must be reading again */
+  EXPECT_TRUE(Send(fd, "again", 5));
+
+  for (UInt i = 0; i < 10000 && READ_ONCE(requests) < 2; ++i) {
+    usleep(1000);
+  }
+
+  EXPECT_EQ(requests, 2ul);
+
+  close(fd);
+  acceptor.Stop();
+}
+
+TEST(ConnectionBenchmark, Throughput) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Milli = std::chrono::milliseconds;
+
+  Base::Acceptor acceptor{1};
+  ULong received{0}, closed{0};
+  Char block[65536];
+
+  /* @NOTE: the callback consumes everything, so chunks go back to the pool
+   * of the shard and the next read takes them again */
+  EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                               Monitor& monitor) -> ErrorCodeE {
+    auto connection = Base::Connection::Make(monitor, socket,
+        [&](Base::Connection& connection, Buffer& input) -> ErrorCodeE {
+          ADD(&received, input.Size());
+          input.Consume(input.Size());
+
+          if (connection.Closed()) {
+            INC(&closed);
+          }
+
+          return ENoError;
+        });
+
+    return connection ? ENoError : EBadAccess;
+  }), ENoError);
+
+  memset(block, 'x', sizeof(block));
+
+  auto before = Buffer::Statistics();
+  auto begin = Clock::now();
+  Int fd = Connect(acceptor.Port());
+
+  EXPECT_GE(fd, 0);
+
+  for (UInt i = 0; i < NUM_OF_MEGABYTES * 16; ++i) {
+    if (!Send(fd, block, sizeof(block))) {
+      break;
+    }
+  }
+
+  close(fd);
+  EXPECT_TRUE(Wait(&closed));
+
+  ULong spent = std::chrono::duration_cast<Milli>(Clock::now() -
+                                                  begin).count();
+
+  /* @NOTE: the shard publishes its counters when its thread exits */
+  acceptor.Stop();
+
+  auto after = Buffer::Statistics();
+  ULong taken = (after.Hits - before.Hits) + (after.Misses - before.Misses);
+
+  /* @NOTE: no slab should be carved, chunks come from the pool or the tail
+   * chunk is filled again */
+  EXPECT_EQ(received, ULong(NUM_OF_MEGABYTES) << 20);
+  EXPECT_LE(after.Misses - before.Misses, 1ul);
+
+  INFO << Format{"connection: {} MB/s, {} chunks taken, {} slabs carved"}
+              .Apply(NUM_OF_MEGABYTES*1000/(spent? spent: 1), taken,
+                     after.Misses - before.Misses)
+       << Base::EOL;
+}
+
+TEST(ConnectionBenchmark, Pipeline) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Milli = std::chrono::milliseconds;
+
+  String burst{};
+
+  for (UInt i = 0; i < NUM_OF_PIPELINED; ++i) {
+    burst.append("ping\n");
+  }
+
+  /* @NOTE: replies are sent once per burst or flushed one by one, the second
+   * way costs a syscall per reply */
+  for (Bool coalescing : {True, False}) {
+    Base::Acceptor acceptor{1};
+    Char replies[5 * NUM_OF_PIPELINED];
+
+    EXPECT_EQ(acceptor.Listen("127.0.0.1", 0, [&](Int socket,
+                                                 Monitor& monitor) -> ErrorCodeE {
+      Int enable{1};
+
+      /* @NOTE: without this, Nagle holds the replies which are flushed one
+       * by one until the client acknowledges the first one */
+      setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+      auto connection = Base::Connection::Make(monitor, socket,
+          [&](Base::Connection& connection, Buffer& input) -> ErrorCodeE {
+            Long end;
+
+            while ((end = input.Find('\n')) >= 0) {
+              connection.Write("pong\n", 5);
+              input.Consume(end + 1);
+
+              if (!coalescing) {
+                connection.Flush();
+              }
+            }
+
+            return ENoError;
+          });
+
+      return connection ? ENoError : EBadAccess;
+    }), ENoError);
+
+    Int fd = Connect(acceptor.Port());
+    auto begin = Clock::now();
+
+    EXPECT_GE(fd, 0);
+
+    for (UInt i = 0; i < NUM_OF_BURSTS; ++i) {
+      if (!Send(fd, burst.c_str(), burst.size()) ||
+          !Receive(fd, replies, sizeof(replies))) {
+        break;
+      }
+    }
+
+    ULong spent = std::chrono::duration_cast<Milli>(Clock::now() -
+                                                    begin).count();
+
+    INFO << Format{"pipeline of {} replies, coalescing {}: {} req/s"}
+                .Apply(NUM_OF_PIPELINED, coalescing? "on": "off",
+                       ULong(NUM_OF_BURSTS)*NUM_OF_PIPELINED*1000/
+                         (spent? spent: 1))
+         << Base::EOL;
+
+    close(fd);
+    acceptor.Stop();
+  }
+}
+
+int main() {
+  return RUN_ALL_TESTS();
+}
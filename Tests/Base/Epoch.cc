@@ -0,0 +1,119 @@
+#include <Atomic.h>
+#include <Epoch.h>
+#include <List.h>
+#include <Thread.h>
+#include <Unittest.h>
+
+#include <unistd.h>
+
+#define MAX_THREADS 100
+#define MAX_ROUNDS 1000
+
+static ULong Released{0};
+
+static void Count(Void *UNUSED(pointer)) { INC(&Released); }
+
+TEST(Epoch, Simple) {
+  ULong released = READ_ONCE(Released);
+  UInt samples[10];
+
+  for (auto i = 0; i < 10; ++i) {
+    Base::Epoch::Retire(&samples[i], Count);
+  }
+
+  EXPECT_EQ(Base::Epoch::Synchronize(), ENoError);
+  Base::Epoch::Collect();
+
+  EXPECT_EQ(READ_ONCE(Released), released + 10);
+  EXPECT_EQ(Base::Epoch::Pending(), ULong(0));
+}
+
+TEST(Epoch, Nested) {
+  Base::Epoch::Guard outer{};
+
+  {
+    Base::Epoch::Guard inner{};
+
+    EXPECT_EQ(Base::Epoch::Synchronize(), EBadLogic);
+  }
+
+  EXPECT_EQ(Base::Epoch::Synchronize(), EBadLogic);
+}
+
+TEST(Epoch, Reader) {
+  ULong released = READ_ONCE(Released);
+  Bool entered{False}, leaving{False};
+  Base::Thread reader{};
+  UInt sample;
+
+  reader.Start([&]() {
+    Base::Epoch::Guard guard{};
+
+    WRITE_ONCE(entered, True);
+
+    while (!READ_ONCE(leaving)) {
+      usleep(100);
+    }
+  });
+
+  while (!READ_ONCE(entered)) {
+    usleep(100);
+  }
+
+  /* @NOTE: the reader is still inside its critical section so the retired
+   * pointer mustn't be released no matter how many times we collect */
+
+  Base::Epoch::Retire(&sample, Count);
+
+  for (auto i = 0; i < 10; ++i) {
+    Base::Epoch::Collect();
+  }
+
+  EXPECT_EQ(READ_ONCE(Released), released);
+
+  WRITE_ONCE(leaving, True);
+  EXPECT_EQ(Base::Epoch::Synchronize(), ENoError);
+  Base::Epoch::Collect();
+
+  EXPECT_EQ(READ_ONCE(Released), released + 1);
+}
+
+TEST(Epoch, List) {
+  Base::List list{};
+
+  Function<void()> perform = [&]() {
+    Base::Thread threads[MAX_THREADS];
+
+    for (auto i = 0; i < MAX_THREADS; ++i) {
+      threads[i].Start([&list]() {
+        for (auto j = 0; j < MAX_ROUNDS; ++j) {
+          UInt sample;
+          ULong token = list.Add(&sample);
+
+          if (list.At<UInt>(token, True) != &sample) {
+            Bug(EBadAccess, "can't access as expected");
+          }
+
+          /* @NOTE: walk through the list so we will stand on nodes which are
+           * deleted by another threads */
+
+          list.At<UInt>(list.Size() / 2 + 1);
+
+          if (!list.Del(token, &sample)) {
+            Bug(EBadAccess, "can't delete as expected");
+          }
+        }
+      });
+    }
+  };
+
+  TIMEOUT(300, { perform(); });
+
+  EXPECT_EQ(list.Size(), UInt(0));
+  EXPECT_EQ(Base::Epoch::Synchronize(), ENoError);
+
+  Base::Epoch::Collect();
+  EXPECT_EQ(Base::Epoch::Pending(), ULong(0));
+}
+
+int main() { return RUN_ALL_TESTS(); }
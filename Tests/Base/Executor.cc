@@ -0,0 +1,188 @@
+#include <Atomic.h>
+#include <Executor.h>
+#include <Queue.h>
+#include <Thread.h>
+#include <Unittest.h>
+
+#include <unistd.h>
+
+#include <chrono>
+
+#define MAX_WORKERS 4
+#define MAX_TASKS 100000
+#define MAX_DEPTH 14
+
+static void Spawn(Base::Executor& executor, ULong& count, UInt depth) {
+  INC(&count);
+
+  if (depth == 0) {
+    return;
+  }
+
+  /* @NOTE: every task submits 2 children from inside the worker so they go
+   * to the worker's deque and idle workers must steal them */
+
+  for (auto i = 0; i < 2; ++i) {
+    executor.Submit([&executor, &count, depth]() {
+      Spawn(executor, count, depth - 1);
+    });
+  }
+}
+
+TEST(Executor, Simple) {
+  Base::Executor executor{MAX_WORKERS};
+  ULong count{0}, executed{0}, injected{0};
+
+  for (auto i = 0; i < MAX_TASKS; ++i) {
+    EXPECT_EQ(executor.Submit([&count]() { INC(&count); }), ENoError);
+  }
+
+  EXPECT_EQ(executor.Wait(), ENoError);
+  EXPECT_EQ(count, ULong(MAX_TASKS));
+  EXPECT_EQ(executor.Pending(), ULong(0));
+
+  for (UInt i = 0; i < executor.Size(); ++i) {
+    executed += executor.Statistics(i).Executed;
+    injected += executor.Statistics(i).Injected;
+  }
+
+  EXPECT_EQ(executed, ULong(MAX_TASKS));
+  EXPECT_EQ(injected, ULong(MAX_TASKS));
+}
+
+TEST(Executor, Nested) {
+  Base::Executor executor{MAX_WORKERS};
+  ULong count{0}, submitted{0}, stolen{0}, executed{0};
+
+  EXPECT_EQ(executor.Submit([&]() { Spawn(executor, count, MAX_DEPTH); }),
+            ENoError);
+  EXPECT_EQ(executor.Wait(), ENoError);
+  EXPECT_EQ(count, (ULong(1) << (MAX_DEPTH + 1)) - 1);
+
+  for (UInt i = 0; i < executor.Size(); ++i) {
+    Base::Executor::Statistic statistic = executor.Statistics(i);
+
+    submitted += statistic.Submitted;
+    stolen += statistic.Stolen;
+    executed += statistic.Executed;
+
+    INFO << Base::Format{"worker {}: submitted {}, executed {}, stolen {}, "
+                         "parked {}"}
+                .Apply(i, statistic.Submitted, statistic.Executed,
+                       statistic.Stolen, statistic.Parked)
+         << Base::EOL;
+  }
+
+  EXPECT_EQ(submitted, count - 1);
+  EXPECT_EQ(executed, count);
+}
+
+TEST(Executor, Stucks) {
+  Base::Executor executor{MAX_WORKERS};
+  Bool leaving{False};
+
+  EXPECT_EQ(executor.Submit([&leaving]() {
+    while (!READ_ONCE(leaving)) {
+      usleep(1000);
+    }
+  }), ENoError);
+
+  /* @NOTE: the task is still running after 100ms so it must be reported as
+   * a stuck task with a threshold of 50ms */
+
+  usleep(100000);
+  EXPECT_EQ(executor.Stucks(0.05).size(), ULong(1));
+  EXPECT_EQ(executor.Wait(0.01), EDoAgain);
+
+  WRITE_ONCE(leaving, True);
+
+  EXPECT_EQ(executor.Wait(), ENoError);
+  EXPECT_EQ(executor.Stucks(0.05).size(), ULong(0));
+}
+
+TEST(Executor, Failed) {
+  Base::Executor executor{MAX_WORKERS};
+  ULong failed{0};
+
+  for (auto i = 0; i < 10; ++i) {
+    executor.Submit([]() { throw Except(EBadLogic, "expected"); });
+  }
+
+  EXPECT_EQ(executor.Wait(), ENoError);
+
+  for (UInt i = 0; i < executor.Size(); ++i) {
+    failed += executor.Statistics(i).Failed;
+  }
+
+  EXPECT_EQ(failed, ULong(10));
+  EXPECT_NEQ(executor.Submit(None), ENoError);
+}
+
+TEST(ExecutorBenchmark, Pool) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  ULong spent[2]{0, 0}, count{0};
+
+  /* @NOTE: compare with what we used to do, a set of threads polling the same
+   * Queue */
+
+  {
+    Base::Queue<Function<void()>> queue{};
+    Bool leaving{False};
+    auto begin = Clock::now();
+
+    {
+      Base::Thread workers[MAX_WORKERS];
+
+      for (auto i = 0; i < MAX_WORKERS; ++i) {
+        workers[i].Start([&]() {
+          while (!READ_ONCE(leaving)) {
+            Function<void()> task;
+            ULong id = queue.Get(task, 0.001);
+
+            if (id) {
+              task();
+              queue.Done(id);
+            }
+          }
+        });
+      }
+
+      for (auto i = 0; i < MAX_TASKS; ++i) {
+        queue.Put([&count]() { INC(&count); });
+      }
+
+      while (READ_ONCE(count) < MAX_TASKS) {
+        usleep(100);
+      }
+
+      WRITE_ONCE(leaving, True);
+    }
+
+    spent[0] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  {
+    Base::Executor executor{MAX_WORKERS};
+    auto begin = Clock::now();
+
+    count = 0;
+
+    for (auto i = 0; i < MAX_TASKS; ++i) {
+      executor.Submit([&count]() { INC(&count); });
+    }
+
+    executor.Wait();
+    spent[1] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  INFO << Base::Format{"{} tasks: shared queue {}us, executor {}us"}
+              .Apply(MAX_TASKS, spent[0], spent[1])
+       << Base::EOL;
+}
+
+int main() {
+  Base::Log::Level() = EDebug;
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,197 @@
+#include <Hash.h>
+#include <Hashtable.h>
+#include <Unittest.h>
+
+#include <chrono>
+#include <unordered_set>
+
+#define MAX_KEYS (1 << 18)
+#define MAX_BYTES (1 << 12)
+#define MAX_ROUNDS (1 << 12)
+
+/* @NOTE: the bitwise CRC32C which every implementation must agree with */
+static UInt Bitwise(const Char* data, ULong size) {
+  UInt crc = ~0u;
+
+  for (ULong i = 0; i < size; ++i) {
+    crc ^= UInt(uint8_t(data[i]));
+
+    for (auto k = 0; k < 8; ++k) {
+      crc = (crc >> 1) ^ (0x82f63b78u & (0u - (crc & 1)));
+    }
+  }
+
+  return ~crc;
+}
+
+TEST(Hash, CRC32C) {
+  Char buffer[MAX_BYTES + 8];
+
+  for (UInt i = 0; i < sizeof(buffer); ++i) {
+    buffer[i] = Char(i*131 + 7);
+  }
+
+  EXPECT_EQ(Base::Hash::CRC32C("123456789", 9), 0xe3069283u);
+  EXPECT_EQ(Base::Hash::CRC32C("", 0), 0u);
+
+  /* @NOTE: every alignment and every tail must give the same checksum */
+  for (UInt offset = 0; offset < 8; ++offset) {
+    for (UInt size = 0; size < 64; ++size) {
+      EXPECT_EQ(Base::Hash::CRC32C(buffer + offset, size),
+                Bitwise(buffer + offset, size));
+    }
+  }
+
+  /* @NOTE: a checksum can be continued piece by piece */
+  {
+    UInt crc = Base::Hash::CRC32C(buffer, 1000);
+
+    crc = Base::Hash::CRC32C(buffer + 1000, MAX_BYTES - 1000, crc);
+    EXPECT_EQ(crc, Bitwise(buffer, MAX_BYTES));
+  }
+
+  INFO << Base::Format{"CRC32C is done by {}"}
+              .Apply(Base::Hash::Accelerated()? "SSE4.2": "a table")
+       << Base::EOL;
+}
+
+TEST(Hash, Digest) {
+  std::unordered_set<ULong> seen{};
+  Char buffer[128];
+
+  for (UInt i = 0; i < sizeof(buffer); ++i) {
+    buffer[i] = Char(i);
+  }
+
+  /* @NOTE: prefixes of every length take different paths in Digest */
+  for (UInt size = 0; size <= sizeof(buffer); ++size) {
+    EXPECT_TRUE(seen.insert(Base::Hash::Digest(buffer, size)).second);
+  }
+
+  EXPECT_EQ(Base::Hash::Digest(buffer, 100), Base::Hash::Digest(buffer, 100));
+  EXPECT_NEQ(Base::Hash::Digest(buffer, 100),
+             Base::Hash::Digest(buffer, 100, 1));
+
+  /* @NOTE: flipping any bit of a key changes about half of the bits of its
+   * hash */
+  for (UInt size : {3, 8, 16, 40, 100}) {
+    ULong origin = Base::Hash::Digest(buffer, size), flips{0};
+
+    for (UInt bit = 0; bit < size*8; ++bit) {
+      buffer[bit/8] ^= Char(1 << (bit % 8));
+      flips += __builtin_popcountll(origin ^ Base::Hash::Digest(buffer, size));
+      buffer[bit/8] ^= Char(1 << (bit % 8));
+    }
+
+    EXPECT_TRUE(flips > size*8*24 && flips < size*8*40);
+  }
+
+  seen.clear();
+
+  for (UInt key = 0; key < MAX_KEYS; ++key) {
+    String text = Base::Format{"key-{}"}.Apply(key);
+
+    EXPECT_TRUE(seen.insert(Base::Hash::Of(text)).second);
+    EXPECT_EQ(Base::Hash::Of(text), Base::Hash::Of(Base::View{text}));
+  }
+}
+
+TEST(Hash, Mix) {
+  std::unordered_set<ULong> seen{};
+  ULong buckets[16]{};
+
+  /* @NOTE: sequential keys must spread over the low bits */
+  for (ULong key = 0; key < MAX_KEYS; ++key) {
+    EXPECT_TRUE(seen.insert(Base::Hash::Mix(key << 20)).second);
+    buckets[Base::Hash::Mix(key << 20) & 15]++;
+  }
+
+  for (auto bucket : buckets) {
+    EXPECT_TRUE(bucket > MAX_KEYS/16 - MAX_KEYS/64 &&
+                bucket < MAX_KEYS/16 + MAX_KEYS/64);
+  }
+}
+
+TEST(Hash, Default) {
+  Base::Hashtable<String, UInt> strings{};
+  Base::Hashtable<UInt, UInt> numbers{{}, Base::Hashtable<UInt, UInt>::ESwiss};
+
+  for (UInt key = 0; key < 1000; ++key) {
+    EXPECT_EQ(strings.Put(Base::Format{"key-{}"}.Apply(key), UInt{key}),
+              ENoError);
+    EXPECT_EQ(numbers.Put(UInt{key << 16}, UInt{key}), ENoError);
+  }
+
+  for (UInt key = 0; key < 1000; ++key) {
+    String text = Base::Format{"key-{}"}.Apply(key);
+    UInt* value = strings.Find(Base::View{text});
+
+    EXPECT_TRUE(value != None && *value == key);
+    EXPECT_EQ(numbers.Get(key << 16), key);
+  }
+}
+
+TEST(Hash, Custom) {
+  using Hasher = Base::Hash::Custom<UInt>;
+
+  Base::Hashtable<UInt, UInt, Int, Hasher> numbers{
+      [](UInt* key) -> Int { return *key % 13; },
+      Base::Hashtable<UInt, UInt>::ESwiss};
+
+  for (UInt key = 0; key < 1000; ++key) {
+    EXPECT_EQ(numbers.Put(UInt{key}, UInt{key + 1}), ENoError);
+  }
+
+  for (UInt key = 0; key < 1000; ++key) {
+    EXPECT_EQ(numbers.Get(key), key + 1);
+  }
+}
+
+TEST(HashBenchmark, Throughput) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Nano = std::chrono::nanoseconds;
+
+  Vector<Char> buffer(MAX_BYTES);
+  ULong spent[3]{0, 0, 0}, sink{0};
+
+  for (UInt i = 0; i < buffer.size(); ++i) {
+    buffer[i] = Char(i*131 + 7);
+  }
+
+  /* @NOTE: FNV-1a is the kind of byte loop which we used to write */
+  for (auto i = 0; i < 3; ++i) {
+    auto begin = Clock::now();
+
+    for (auto round = 0; round < MAX_ROUNDS; ++round) {
+      if (i == 0) {
+        UInt result{2166136261u};
+
+        for (auto c : buffer) {
+          result = (result ^ UInt(uint8_t(c)))*16777619u;
+        }
+
+        sink += result;
+      } else if (i == 1) {
+        sink += Base::Hash::Digest(buffer.data(), buffer.size(), round);
+      } else {
+        sink += Base::Hash::CRC32C(buffer.data(), buffer.size(), round);
+      }
+    }
+
+    spent[i] = std::chrono::duration_cast<Nano>(Clock::now() - begin).count();
+  }
+
+  EXPECT_NEQ(sink, 0ul);
+
+  INFO << Base::Format{"hash {}KB: fnv {}MB/s, digest {}MB/s, crc32c {}MB/s"}
+              .Apply(ULong(MAX_ROUNDS)*MAX_BYTES/1024,
+                     ULong(MAX_ROUNDS)*MAX_BYTES*1000/(spent[0] + 1),
+                     ULong(MAX_ROUNDS)*MAX_BYTES*1000/(spent[1] + 1),
+                     ULong(MAX_ROUNDS)*MAX_BYTES*1000/(spent[2] + 1))
+       << Base::EOL;
+}
+
+int main() {
+  Base::Log::Level() = EDebug;
+  return RUN_ALL_TESTS();
+}
@@ -1,11 +1,59 @@
+#include <ConcurrentHashtable.h>
 #include <Hashtable.h>
+#include <Lock.h>
+#include <Thread.h>
 #include <Unittest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
 #define MAX_SIZE 1000
+#define MAX_ITEMS (1 << 18)
+#define MAX_LOOKUPS (1 << 20)
+#define MAX_THREADS 32
+#define MAX_READS (1 << 16)
+
+static Int Identity(UInt* value) { return *value; }
+
+/* @NOTE: every key shares one of 7 homes so probe sequences are long and
+ * they wrap around the end of the table */
+static Int Crowded(UInt* value) { return (*value % 7) * 37; }
+
+static const UInt Swiss = Base::Hashtable<UInt, UInt>::ESwiss;
+
+/* @NOTE: tables which are hashed by the functions above */
+template<typename ValueT>
+using Hashed = Base::Hashtable<UInt, ValueT, Int, Base::Hash::Custom<UInt>>;
+
+template<typename ValueT>
+using Sharded =
+    Base::ConcurrentHashtable<UInt, ValueT, Int, Base::Hash::Custom<UInt>>;
+
+/* @NOTE: hashers which can be inlined, Text also hashes a View the same way
+ * it hashes a String with the same content */
+struct Inline {
+  Int operator()(UInt* value) { return *value; }
+};
+
+struct Text {
+  Int operator()(String* value) { return (*this)(Base::View{*value}); }
+
+  Int operator()(const Base::View& view) {
+    UInt result{2166136261u};
+
+    for (ULong i = 0; i < view.Size; ++i) {
+      result = (result ^ UInt(uint8_t(view.Data[i])))*16777619u;
+    }
+
+    return result;
+  }
+};
 
 TEST(Hashtable, Simple) {
   for (UInt size = 1; size < MAX_SIZE; ++size) {
-    Base::Hashtable<UInt, UInt> int1{size,
+    Hashed<UInt> int1{size,
       [](UInt* value) -> Int{ return *value; }
     };
 
@@ -20,7 +68,7 @@ TEST(Hashtable, Simple) {
 }
 
 TEST(Hashtable, LevelUp){
-  Base::Hashtable<UInt, UInt> int1{5,
+  Hashed<UInt> int1{5,
     [](UInt* value) -> Int{ return *value; }
   };
 
@@ -33,4 +81,777 @@ TEST(Hashtable, LevelUp){
   }
 }
 
-int main() { RUN_ALL_TESTS(); }
+TEST(Hashtable, Migration) {
+  Hashed<UInt> int1{Crowded};
+
+  /* @NOTE: every Put moves a few buckets, so the keys which were put before
+   * must be found on one of the mappings at any moment */
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+
+    for (UInt check = 0; check <= index; check += 97) {
+      UInt* value = int1.Find(check);
+
+      EXPECT_TRUE(value != None && *value == check);
+    }
+  }
+
+  /* @NOTE: overwrite while the last migration might still be running */
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    UInt value = index + 1;
+
+    EXPECT_EQ(int1.Put(index, value), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Get(RValue(index)), index + 1);
+  }
+
+  EXPECT_TRUE(int1.Find(MAX_SIZE) == None);
+}
+
+TEST(Hashtable, Lifetime) {
+  Hashed<String> str1{Crowded};
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    String value = Base::Format{"value-{}"}.Apply(index);
+
+    EXPECT_EQ(str1.Put(index, value), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    String* value = str1.Find(index);
+
+    EXPECT_TRUE(value != None);
+
+    if (value) {
+      EXPECT_EQ(*value, Base::Format{"value-{}"}.Apply(index));
+    }
+  }
+}
+
+TEST(HashtableV2, Simple) {
+  for (UInt size = 1; size < MAX_SIZE; ++size) {
+    Hashed<UInt> int1{size, Identity, True};
+
+    for (UInt index = 0; index < size; ++index) {
+      EXPECT_EQ(int1.Put(index, index), ENoError);
+    }
+
+    for (UInt index = 0; index < size; ++index) {
+      EXPECT_EQ(int1.Get(RValue(index)), index);
+    }
+
+    EXPECT_TRUE(int1.Find(size) == None);
+  }
+}
+
+TEST(HashtableV2, LevelUp) {
+  Hashed<UInt> int1{Identity, True};
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  /* @NOTE: putting an existing key must replace its value */
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    UInt value = 2*index;
+
+    EXPECT_EQ(int1.Put(index, value), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Get(RValue(index)), 2*index);
+  }
+}
+
+TEST(HashtableV2, Collision) {
+  Hashed<UInt> int1{Crowded, True};
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  /* @NOTE: remove every third key, the others must be shifted back and
+   * still be found */
+  for (UInt index = 0; index < MAX_SIZE; index += 3) {
+    EXPECT_EQ(int1.Del(index), ENoError);
+    EXPECT_EQ(int1.Del(index), ENotFound);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    UInt* value = int1.Find(index);
+
+    if (index % 3 == 0) {
+      EXPECT_TRUE(value == None);
+    } else {
+      EXPECT_TRUE(value != None && *value == index);
+    }
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; index += 3) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Get(RValue(index)), index);
+  }
+}
+
+TEST(HashtableV2, Lifetime) {
+  Hashed<String> str1{Crowded, True};
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    String value = Base::Format{"value-{}"}.Apply(index);
+
+    EXPECT_EQ(str1.Put(index, value), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; index += 2) {
+    EXPECT_EQ(str1.Del(index), ENoError);
+  }
+
+  for (UInt index = 1; index < MAX_SIZE; index += 2) {
+    String* value = str1.Find(index);
+
+    EXPECT_TRUE(value != None);
+
+    if (value) {
+      EXPECT_EQ(*value, Base::Format{"value-{}"}.Apply(index));
+    }
+  }
+
+  str1.Clear();
+  EXPECT_TRUE(str1.Find(1) == None);
+}
+
+TEST(HashtableV2, LoadFactor) {
+  Hashed<UInt> int1{Identity, True};
+
+  EXPECT_NEQ(int1.LoadFactor(0.0), ENoError);
+  EXPECT_NEQ(int1.LoadFactor(1.5), ENoError);
+  EXPECT_EQ(int1.LoadFactor(1.0), ENoError);
+
+  /* @NOTE: a full table must still answer misses */
+  for (UInt index = 0; index < 64; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  EXPECT_TRUE(int1.Find(64) == None);
+  EXPECT_EQ(int1.LoadFactor(0.5), ENoError);
+
+  for (UInt index = 64; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Get(RValue(index)), index);
+  }
+}
+
+TEST(HashtableSwiss, Simple) {
+  /* @NOTE: tables of every size are tested by the other modes, sizes
+   * around the group width are enough here */
+  for (UInt size = 1; size < MAX_SIZE; size += size < 64? 1: 61) {
+    Hashed<UInt> int1{size, Identity, Swiss};
+
+    for (UInt index = 0; index < size; ++index) {
+      EXPECT_EQ(int1.Put(index, index), ENoError);
+    }
+
+    for (UInt index = 0; index < size; ++index) {
+      EXPECT_EQ(int1.Get(RValue(index)), index);
+    }
+
+    EXPECT_TRUE(int1.Find(size) == None);
+  }
+}
+
+TEST(HashtableSwiss, Collision) {
+  Hashed<UInt> int1{Crowded, Swiss};
+
+  /* @NOTE: keys sharing a hash share their control byte too, so every probe
+   * must compare the full hashes and keys of many candidates */
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; index += 3) {
+    EXPECT_EQ(int1.Del(index), ENoError);
+    EXPECT_EQ(int1.Del(index), ENotFound);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    UInt* value = int1.Find(index);
+
+    if (index % 3 == 0) {
+      EXPECT_TRUE(value == None);
+    } else {
+      EXPECT_TRUE(value != None && *value == index);
+    }
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; index += 3) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Get(RValue(index)), index);
+  }
+}
+
+TEST(HashtableSwiss, Deleted) {
+  Hashed<UInt> int1{64, Identity, Swiss};
+
+  /* @NOTE: a window of keys slides over a small table, deleted slots must be
+   * reused or cleaned up without growing the table forever */
+  for (UInt index = 0; index < 64*MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+
+    if (index >= 32) {
+      EXPECT_EQ(int1.Del(index - 32), ENoError);
+    }
+  }
+
+  for (UInt index = 64*MAX_SIZE - 32; index < 64*MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Get(RValue(index)), index);
+  }
+
+  EXPECT_TRUE(int1.Find(0) == None);
+  EXPECT_EQ(int1.LoadFactor(1.0), ENoError);
+
+  /* @NOTE: a full table must still answer misses */
+  for (UInt index = 0; index < 256; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  EXPECT_TRUE(int1.Find(MAX_ITEMS) == None);
+}
+
+TEST(HashtableSwiss, Lifetime) {
+  Hashed<String> str1{Crowded, Swiss};
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    String value = Base::Format{"value-{}"}.Apply(index);
+
+    EXPECT_EQ(str1.Put(index, value), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; index += 2) {
+    EXPECT_EQ(str1.Del(index), ENoError);
+  }
+
+  for (UInt index = 1; index < MAX_SIZE; index += 2) {
+    String* value = str1.Find(index);
+
+    EXPECT_TRUE(value != None);
+
+    if (value) {
+      EXPECT_EQ(*value, Base::Format{"value-{}"}.Apply(index));
+    }
+  }
+
+  str1.Clear();
+  EXPECT_TRUE(str1.Find(1) == None);
+}
+
+TEST(HashtableView, Find) {
+  UInt styles[] = {0, True, Swiss};
+
+  for (auto style : styles) {
+    Base::Hashtable<String, UInt, Int, Text> str1{Text{}, style};
+
+    for (UInt index = 0; index < MAX_SIZE; ++index) {
+      String key = Base::Format{"key-{}"}.Apply(index);
+
+      EXPECT_EQ(str1.Put(key, index), ENoError);
+    }
+
+    /* @NOTE: keys are looked up from a buffer which is larger than them, so
+     * only the View's size tells where a key ends */
+    for (UInt index = 0; index < MAX_SIZE; ++index) {
+      Char buffer[32];
+      Int size = snprintf(buffer, sizeof(buffer), "key-%u-tail", index);
+      UInt* value = str1.Find(Base::View{buffer, ULong(size - 5)});
+
+      EXPECT_TRUE(value != None && *value == index);
+    }
+
+    EXPECT_TRUE(str1.Find(Base::View{"key-1-tail", 7}) == None);
+    EXPECT_TRUE(str1.Find(Base::View{"key"}) == None);
+  }
+}
+
+TEST(HashtableBuild, Modes) {
+  std::vector<std::pair<UInt, UInt>> entries{};
+  UInt styles[] = {0, True, Swiss};
+
+  /* @NOTE: every fourth key comes twice, the second value must win */
+  for (UInt key = 0; key < MAX_ITEMS/4; ++key) {
+    entries.push_back(std::make_pair(key, key));
+  }
+
+  for (UInt key = 0; key < MAX_ITEMS/4; key += 4) {
+    entries.push_back(std::make_pair(key, key + 1));
+  }
+
+  for (auto style : styles) {
+    for (UInt threads = 1; threads <= 4; threads *= 2) {
+      Hashed<UInt> int1{Crowded, style};
+      Hashed<UInt> int2{Identity, style};
+
+      EXPECT_EQ(int1.BuildFrom(entries.begin(), entries.begin() + MAX_SIZE,
+                               threads), ENoError);
+      EXPECT_EQ(int2.BuildFrom(entries.begin(), entries.end(), threads),
+                ENoError);
+      EXPECT_EQ(int1.Size(), ULong(MAX_SIZE));
+      EXPECT_EQ(int2.Size(), ULong(MAX_ITEMS/4));
+
+      for (UInt key = 0; key < MAX_SIZE; ++key) {
+        EXPECT_EQ(int1.Get(RValue(key)), key);
+      }
+
+      for (UInt key = 0; key < MAX_ITEMS/4; ++key) {
+        UInt* value = int2.Find(key);
+
+        EXPECT_TRUE(value && *value == (key % 4? key: key + 1));
+      }
+
+      /* @NOTE: a table which isn't empty falls back to Put */
+      EXPECT_EQ(int1.BuildFrom(entries.begin() + MAX_SIZE,
+                               entries.begin() + 2*MAX_SIZE, threads),
+                ENoError);
+      EXPECT_EQ(int1.Size(), ULong(2*MAX_SIZE));
+      EXPECT_TRUE(int1.Find(2*MAX_SIZE - 1) != None);
+    }
+  }
+}
+
+TEST(ConcurrentHashtable, Simple) {
+  Sharded<UInt> int1{Crowded, 4};
+  UInt value{0};
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(int1.Put(index, index), ENoError);
+  }
+
+  EXPECT_EQ(int1.Size(), ULong(MAX_SIZE));
+
+  for (UInt index = 0; index < MAX_SIZE; index += 2) {
+    EXPECT_EQ(int1.Del(index), ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    if (index % 2) {
+      EXPECT_EQ(int1.Get(index, value), ENoError);
+      EXPECT_EQ(value, index);
+    } else {
+      EXPECT_EQ(int1.Get(index, value), ENotFound);
+    }
+  }
+
+  EXPECT_EQ(int1.Size(), ULong(MAX_SIZE/2));
+}
+
+TEST(ConcurrentHashtable, Lifetime) {
+  Sharded<String> str1{Identity};
+  String value{};
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(str1.Put(index, Base::Format{"value-{}"}.Apply(index)),
+              ENoError);
+  }
+
+  for (UInt index = 0; index < MAX_SIZE; ++index) {
+    EXPECT_EQ(str1.Get(index, value), ENoError);
+    EXPECT_EQ(value, Base::Format{"value-{}"}.Apply(index));
+  }
+}
+
+TEST(ConcurrentHashtable, Threads) {
+  Sharded<ULong> int1{Identity};
+  ULong broken{0};
+
+  /* @NOTE: writers keep growing shards and rewriting values while readers
+   * check that every value they see is consistent with its key */
+
+  {
+    Vector<Base::Thread*> writers{}, readers{};
+
+    for (auto i = 0; i < 4; ++i) {
+      readers.push_back(new Base::Thread{});
+
+      readers.back()->Start([&, i]() {
+        ULong seed{ULong(i) + 1};
+
+        for (auto r = 0; r < 4*MAX_READS; ++r) {
+          ULong value{0};
+          UInt key{0};
+
+          seed ^= seed << 13;
+          seed ^= seed >> 7;
+          seed ^= seed << 17;
+
+          key = seed % (MAX_ITEMS/4);
+
+          if (int1.Get(key, value) == ENoError &&
+              ((value >> 32) != key || (value & 0xffffffff) >= 4)) {
+            INC(&broken);
+          }
+        }
+      });
+    }
+
+    for (auto i = 0; i < 2; ++i) {
+      writers.push_back(new Base::Thread{});
+
+      writers.back()->Start([&, i]() {
+        for (UInt round = 0; round < 4; ++round) {
+          for (UInt key = i; key < MAX_ITEMS/4; key += 2) {
+            int1.Put(key, (ULong(key) << 32) | round);
+          }
+        }
+      });
+    }
+
+    /* @NOTE: deleting a Thread joins it */
+    for (auto writer : writers) {
+      delete writer;
+    }
+
+    for (auto reader : readers) {
+      delete reader;
+    }
+  }
+
+  EXPECT_EQ(broken, ULong(0));
+  EXPECT_EQ(int1.Size(), ULong(MAX_ITEMS/4));
+}
+
+TEST(HashtableBenchmark, Insert) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  ULong spent[4]{0, 0, 0, 0};
+
+  /* @NOTE: keys are put in ascending order with the identity hash, it's
+   * the only pattern which the chained mode handles without collisions */
+
+  {
+    Hashed<UInt> table{Identity};
+    auto begin = Clock::now();
+
+    for (UInt key = 0; key < MAX_ITEMS; ++key) {
+      table.Put(key, key);
+    }
+
+    spent[0] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  {
+    Hashed<UInt> table{Identity, True};
+    auto begin = Clock::now();
+
+    for (UInt key = 0; key < MAX_ITEMS; ++key) {
+      table.Put(key, key);
+    }
+
+    spent[1] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  {
+    std::unordered_map<UInt, UInt> table{};
+    auto begin = Clock::now();
+
+    for (UInt key = 0; key < MAX_ITEMS; ++key) {
+      table[key] = key;
+    }
+
+    spent[2] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  {
+    Hashed<UInt> table{Identity, Swiss};
+    auto begin = Clock::now();
+
+    for (UInt key = 0; key < MAX_ITEMS; ++key) {
+      table.Put(key, key);
+    }
+
+    spent[3] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  INFO << Base::Format{"insert {} keys: chained {}us, robin hood {}us, "
+                       "std::unordered_map {}us, swiss {}us"}
+              .Apply(MAX_ITEMS, spent[0], spent[1], spent[2], spent[3])
+       << Base::EOL;
+}
+
+TEST(HashtableBenchmark, Lookup) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  Hashed<UInt> chained{Identity}, robinhood{Identity, True},
+      swiss{Identity, Swiss};
+  Hashed<UInt>* tables[] = {&chained, &robinhood, &swiss};
+  std::unordered_map<UInt, UInt> standard{};
+  Vector<UInt> keys{}, misses{};
+  ULong spent[2][4]{}, found[2][4]{}, seed{1};
+
+  for (UInt key = 0; key < MAX_ITEMS; ++key) {
+    chained.Put(key, key);
+    robinhood.Put(key, key);
+    swiss.Put(key, key);
+    standard[key] = key;
+  }
+
+  /* @NOTE: half of the lookups miss on the first round and every lookup
+   * misses on the second one, keys are picked randomly so every lookup
+   * touches a cold slot */
+  for (auto i = 0; i < MAX_LOOKUPS; ++i) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    keys.push_back(seed % (2*MAX_ITEMS));
+    misses.push_back(MAX_ITEMS + seed % MAX_ITEMS);
+  }
+
+  for (auto round = 0; round < 2; ++round) {
+    Vector<UInt>& sample = round? misses: keys;
+
+    for (auto i = 0; i < 4; ++i) {
+      auto begin = Clock::now();
+
+      if (i == 3) {
+        for (auto key : sample) {
+          found[round][i] += standard.find(key) != standard.end();
+        }
+      } else {
+        for (auto key : sample) {
+          found[round][i] += tables[i]->Find(key) != None;
+        }
+      }
+
+      spent[round][i] =
+          std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+    }
+
+    EXPECT_EQ(found[round][0], found[round][3]);
+    EXPECT_EQ(found[round][1], found[round][3]);
+    EXPECT_EQ(found[round][2], found[round][3]);
+
+    INFO << Base::Format{"{} {} keys: chained {}us, robin hood {}us, "
+                         "swiss {}us, std::unordered_map {}us"}
+                .Apply(round? "miss": "lookup", MAX_LOOKUPS, spent[round][0],
+                       spent[round][1], spent[round][2], spent[round][3])
+         << Base::EOL;
+  }
+}
+
+TEST(HashtableBenchmark, Hasher) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  Hashed<UInt> wrapped{Identity, Swiss};
+  Base::Hashtable<UInt, UInt, Int, Inline> inlined{Inline{}, Swiss};
+  Base::Hashtable<String, UInt, Int, Text> texts{Text{}, Swiss};
+  Vector<String> keys{};
+  ULong spent[4]{0, 0, 0, 0}, found[4]{0, 0, 0, 0};
+
+  for (UInt key = 0; key < MAX_ITEMS; ++key) {
+    wrapped.Put(key, key);
+    inlined.Put(key, key);
+  }
+
+  for (UInt key = 0; key < MAX_ITEMS/4; ++key) {
+    keys.push_back(Base::Format{"a rather long key number {}"}.Apply(key));
+    texts.Put(String{keys.back()}, UInt{key});
+  }
+
+  /* @NOTE: Function<> can't be inlined while a struct can */
+  for (auto i = 0; i < 2; ++i) {
+    auto begin = Clock::now();
+
+    for (UInt key = 0; key < MAX_LOOKUPS; ++key) {
+      found[i] += (i? inlined.Find(key % MAX_ITEMS):
+                      wrapped.Find(key % MAX_ITEMS)) != None;
+    }
+
+    spent[i] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  /* @NOTE: what a caller holding a CString pays to look a key up, a
+   * temporary String or nothing with a View */
+  for (auto i = 2; i < 4; ++i) {
+    auto begin = Clock::now();
+
+    for (UInt key = 0; key < MAX_LOOKUPS/4; ++key) {
+      const Char* data = keys[key % keys.size()].c_str();
+
+      found[i] += (i == 2? texts.Find(String{data}):
+                           texts.Find(Base::View{data})) != None;
+    }
+
+    spent[i] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  EXPECT_EQ(found[0], ULong(MAX_LOOKUPS));
+  EXPECT_EQ(found[1], ULong(MAX_LOOKUPS));
+  EXPECT_EQ(found[2], ULong(MAX_LOOKUPS/4));
+  EXPECT_EQ(found[3], ULong(MAX_LOOKUPS/4));
+
+  INFO << Base::Format{"hasher: Function<> {}us, inline {}us; lookup by "
+                       "String {}us, by View {}us"}
+              .Apply(spent[0], spent[1], spent[2], spent[3])
+       << Base::EOL;
+}
+
+TEST(HashtableBenchmark, Build) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  std::vector<std::pair<UInt, UInt>> entries{};
+
+  /* @NOTE: keys look random but they are still unique */
+  for (UInt i = 0; i < 4*MAX_ITEMS; ++i) {
+    entries.push_back(std::make_pair(i*2654435761u, i));
+  }
+
+  /* @NOTE: what it costs to load a snapshot with Put, Reserve and Put, and
+   * BuildFrom on 1 and 4 threads */
+  for (UInt style : {UInt(True), Swiss}) {
+    ULong spent[4]{0, 0, 0, 0};
+
+    for (auto i = 0; i < 4; ++i) {
+      Base::Hashtable<UInt, UInt, Int, Inline> table{Inline{}, style};
+      auto begin = Clock::now();
+
+      if (i < 2) {
+        if (i == 1) {
+          table.Reserve(entries.size());
+        }
+
+        for (auto& entry : entries) {
+          table.Put(UInt{entry.first}, UInt{entry.second});
+        }
+      } else {
+        table.BuildFrom(entries.begin(), entries.end(), i == 2? 1: 4);
+      }
+
+      spent[i] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+      EXPECT_EQ(table.Size(), ULong(entries.size()));
+    }
+
+    INFO << Base::Format{"{}: load {} keys with Put {}us, Reserve {}us, "
+                         "BuildFrom {}us, 4 threads {}us"}
+                .Apply(style == Swiss? "swiss": "robin hood", entries.size(),
+                       spent[0], spent[1], spent[2], spent[3])
+         << Base::EOL;
+  }
+}
+
+TEST(HashtableBenchmark, Latency) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Nano = std::chrono::nanoseconds;
+
+  Hashed<UInt> chained{Identity}, robinhood{Identity, True};
+  Hashed<UInt>* tables[] = {&chained, &robinhood};
+  String names[] = {"chained", "robin hood"};
+
+  /* @NOTE: the chained mode migrates step by step while the open-addressing
+   * mode rehashes everything at once, the worst Put shows the difference */
+  for (auto i = 0; i < 2; ++i) {
+    Vector<ULong> latencies(4*MAX_ITEMS);
+
+    for (UInt key = 0; key < latencies.size(); ++key) {
+      auto begin = Clock::now();
+
+      tables[i]->Put(key, key);
+      latencies[key] =
+          std::chrono::duration_cast<Nano>(Clock::now() - begin).count();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    INFO << Base::Format{"{}: put p50 {}ns, p99 {}ns, max {}ns"}
+                .Apply(names[i], latencies[latencies.size()/2],
+                       latencies[latencies.size()*99/100], latencies.back())
+         << Base::EOL;
+  }
+}
+
+TEST(HashtableBenchmark, Concurrent) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  Sharded<UInt> concurrent{Identity};
+  Hashed<UInt> locked{Identity, True};
+  Base::Lock lock{};
+
+  for (UInt key = 0; key < MAX_ITEMS; ++key) {
+    concurrent.Put(key, key);
+    locked.Put(key, key);
+  }
+
+  /* @NOTE: every thread does the same amount of reads, so the throughput
+   * should grow with the number of threads as long as there are enough
+   * cores, while a Hashtable behind a single Lock stays flat. The locked
+   * one does fewer reads since every read costs a round of WatchStopper's
+   * bookkeeping */
+  for (UInt threads = 1; threads <= MAX_THREADS; threads *= 2) {
+    ULong spent[2]{0, 0}, found[2]{0, 0};
+    UInt reads[2]{MAX_READS, MAX_READS/64};
+
+    for (auto i = 0; i < 2; ++i) {
+      Vector<Base::Thread*> workers{};
+      auto begin = Clock::now();
+
+      for (UInt t = 0; t < threads; ++t) {
+        workers.push_back(new Base::Thread{});
+
+        workers.back()->Start([&, i, t]() {
+          ULong seed{t + 1}, hits{0};
+
+          for (UInt r = 0; r < reads[i]; ++r) {
+            UInt key{0}, value{0};
+
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+
+            key = seed % MAX_ITEMS;
+
+            if (i == 0) {
+              hits += concurrent.Get(key, value) == ENoError;
+            } else {
+              lock.Safe([&]() { hits += locked.Find(key) != None; });
+            }
+          }
+
+          ADD(&found[i], hits);
+        });
+      }
+
+      /* @NOTE: deleting a Thread joins it */
+      for (auto worker : workers) {
+        delete worker;
+      }
+
+      spent[i] = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+    }
+
+    EXPECT_EQ(found[0], ULong(threads)*reads[0]);
+    EXPECT_EQ(found[1], ULong(threads)*reads[1]);
+
+    INFO << Base::Format{"{} threads: sharded {} reads/ms, locked {} reads/ms"}
+                .Apply(threads, ULong(threads)*reads[0]*1000/(spent[0] + 1),
+                       ULong(threads)*reads[1]*1000/(spent[1] + 1))
+         << Base::EOL;
+  }
+}
+
+int main() {
+  Base::Log::Level() = EDebug;
+  return RUN_ALL_TESTS();
+}
@@ -3,7 +3,11 @@
 #include <Thread.h>
 #include <Unittest.h>
 
+#include <chrono>
+
 #define MAX_THREADS 1000
+#define MAX_ENTRIES 20000
+#define MAX_PROBES 1000
 
 TEST(List, Simple) {
   Function<void()> perform = [&]() {
@@ -161,4 +165,281 @@ TEST(ListNoDump, ThreadWWithSleep) {
   EXPECT_NEQ(list.Size(True), UInt(0));
 }
 
+TEST(ListChunked, Simple) {
+  Function<void()> perform = [&]() {
+    Base::List list{Base::List::EChunked};
+    UInt sample0, sample1, sample2;
+
+    ULong token0 = list.Add(&sample0);
+    ULong token1 = list.Add(&sample1);
+
+    EXPECT_NEQ(token0, ULong(0));
+    EXPECT_NEQ(token1, ULong(0));
+
+    EXPECT_EQ(Int(list.Size()), 2);
+    EXPECT_TRUE(list.At<UInt>(token1, True) == &sample1);
+    EXPECT_TRUE(list.At<UInt>(2) == &sample1);
+
+    EXPECT_EQ(list.Exist(token0), 1);
+    EXPECT_EQ(list.Exist(token1), 1);
+    EXPECT_EQ(list.Exist(&sample0), 1);
+    EXPECT_EQ(list.Exist(&sample1), 1);
+    EXPECT_EQ(list.Exist(token1 + 1), 0);
+    EXPECT_EQ(list.Exist(&sample2), 0);
+
+    EXPECT_TRUE(list.Del(token0, &sample0));
+    EXPECT_FALSE(list.Del(token1, &sample0));
+    EXPECT_TRUE(list.At<UInt>(1) == &sample1);
+    EXPECT_TRUE(list.Del(token1, &sample1));
+
+    EXPECT_EQ(Int(list.Size()), 0);
+    EXPECT_EQ(list.Exist(token0), 0);
+    EXPECT_EQ(list.Exist(&sample1), 0);
+
+    EXPECT_EQ(list.Add(token0, &sample0), ENoError);
+    EXPECT_EQ(list.Add(token0, &sample1), EDoNothing);
+    EXPECT_EQ(Int(list.Size()), 1);
+    EXPECT_EQ(list.Exist(token0), 1);
+  };
+
+  TIMEOUT(300, { perform(); });
+}
+
+TEST(ListChunked, ThreadWWithoutSleep) {
+  Base::List list{Base::List::EChunked};
+
+  Function<void()> perform = [&]() {
+    Base::Thread threads[MAX_THREADS];
+
+    for (auto i = 0; i < MAX_THREADS; ++i) {
+      threads[i].Start([&list]() {
+        UInt sample;
+        ULong token = list.Add(&sample);
+
+        if (list.At<UInt>(token, True) != &sample) {
+          Bug(EBadAccess, "can't access as expected");
+        }
+
+        if (!list.Del(token, &sample)) {
+          Bug(EBadAccess, "can't delete as expected");
+        }
+      });
+    }
+  };
+
+  TIMEOUT(300, { perform(); });
+
+  EXPECT_EQ(list.Size(), UInt(0));
+  EXPECT_NEQ(list.Size(True), UInt(0));
+}
+
+TEST(ListForEach, Simple) {
+  Base::List::LayoutE layouts[] = {Base::List::ELinked, Base::List::EChunked};
+
+  for (auto layout : layouts) {
+    Base::List list{layout};
+    UInt samples[100];
+    ULong tokens[100], visited{0}, sum{0};
+
+    for (auto i = 0; i < 100; ++i) {
+      tokens[i] = list.Add(&samples[i]);
+    }
+
+    for (auto i = 0; i < 100; i += 2) {
+      EXPECT_TRUE(list.Del(tokens[i], &samples[i]));
+    }
+
+    /* @NOTE: every live pointer should be visited once with its own index */
+
+    EXPECT_EQ(list.ForEach([&](ULong index, Void *pointer) -> ErrorCodeE {
+      auto position = (UInt *)pointer - samples;
+
+      visited++;
+      sum += position;
+
+      return index == tokens[position] ? ENoError : EBadLogic;
+    }), ENoError);
+
+    EXPECT_EQ(visited, ULong(50));
+    EXPECT_EQ(sum, ULong(2500));
+
+    /* @NOTE: the walk stops when the callback returns an error */
+
+    visited = 0;
+
+    EXPECT_EQ(list.ForEach([&](ULong, Void *) -> ErrorCodeE {
+      return ++visited == 10 ? EDoNothing : ENoError;
+    }, True), EDoNothing);
+
+    EXPECT_EQ(visited, ULong(10));
+  }
+}
+
+TEST(ListForEach, Thread) {
+  Base::List list{};
+  UInt samples[MAX_PROBES];
+  ULong stopped{0}, walked{0}, snapshots{0};
+
+  for (auto i = 0; i < MAX_PROBES; ++i) {
+    list.Add(&samples[i]);
+  }
+
+  Function<void()> perform = [&]() {
+    Base::Thread threads[MAX_THREADS / 10];
+
+    for (auto i = 0; i < MAX_THREADS / 10; ++i) {
+      threads[i].Start([&, i]() {
+        if (i % 2) {
+          for (auto j = 0; j < MAX_PROBES; ++j) {
+            UInt sample;
+            ULong token = list.Add(&sample);
+
+            if (!list.Del(token, &sample)) {
+              Bug(EBadAccess, "can't delete as expected");
+            }
+          }
+        } else {
+          for (auto j = 0; j < 10; ++j) {
+            ULong count{0};
+
+            /* @NOTE: a snapshot always contains the persistent pointers and
+             * nothing else since every other pointer is added and deleted
+             * by the same thread */
+
+            if (!list.ForEach([&](ULong, Void *) -> ErrorCodeE {
+                  count++;
+                  return ENoError;
+                }, True)) {
+              if (count != MAX_PROBES) {
+                Bug(EBadLogic, "snapshot isn't consistent");
+              }
+
+              INC(&snapshots);
+            }
+
+            list.ForEach([&](ULong, Void *) -> ErrorCodeE {
+              INC(&walked);
+              return ENoError;
+            });
+          }
+        }
+
+        INC(&stopped);
+      });
+    }
+  };
+
+  TIMEOUT(300, { perform(); });
+
+  EXPECT_EQ(stopped, ULong(MAX_THREADS / 10));
+  EXPECT_EQ(list.Size(), UInt(MAX_PROBES));
+  EXPECT_TRUE(walked >= ULong(MAX_PROBES * MAX_THREADS / 2));
+
+  INFO << Base::Format{"{} consistent snapshots"}.Apply(snapshots) << Base::EOL;
+}
+
+TEST(ListBenchmark, Layout) {
+  using Clock = std::chrono::steady_clock;
+  using Micro = std::chrono::microseconds;
+
+  Base::List::LayoutE layouts[] = {Base::List::ELinked, Base::List::EChunked};
+  String names[] = {"linked", "chunked"};
+
+  for (auto i = 0; i < 2; ++i) {
+    Base::List list{layouts[i]};
+    Vector<UInt> samples(MAX_ENTRIES);
+    Vector<ULong> tokens(MAX_ENTRIES);
+    ULong found{0};
+    Long add, index, position, del;
+
+    auto begin = Clock::now();
+
+    for (auto j = 0; j < MAX_ENTRIES; ++j) {
+      tokens[j] = list.Add(&samples[j]);
+    }
+
+    add = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+    begin = Clock::now();
+
+    for (auto j = 0; j < MAX_PROBES; ++j) {
+      auto k = (j * 7919) % MAX_ENTRIES;
+
+      found += list.At<UInt>(tokens[k], True) == &samples[k];
+    }
+
+    index = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+    begin = Clock::now();
+
+    for (auto j = 0; j < MAX_PROBES; ++j) {
+      auto k = (j * 7919) % MAX_ENTRIES;
+
+      found += list.At<UInt>(k + 1) == &samples[k];
+    }
+
+    position = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+    begin = Clock::now();
+
+    for (auto j = 0; j < MAX_ENTRIES; ++j) {
+      list.Del(tokens[j], &samples[j]);
+    }
+
+    del = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+
+    EXPECT_EQ(found, ULong(2 * MAX_PROBES));
+    EXPECT_EQ(list.Size(), UInt(0));
+
+    INFO << Base::Format{"{}: {} Add() {}us, {} At(index) {}us, "
+                         "{} At(position) {}us, {} Del() {}us"}
+                .Apply(names[i], MAX_ENTRIES, add, MAX_PROBES, index,
+                       MAX_PROBES, position, MAX_ENTRIES, del)
+         << Base::EOL;
+  }
+}
+
+TEST(ListBenchmark, Magazine) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  Base::List list{};
+  Base::List::Statistic before{Base::List::Statistics()}, after;
+  auto begin = Clock::now();
+  ULong hits{0}, misses{0}, spent{0};
+
+  Function<void()> perform = [&]() {
+    Base::Thread threads[MAX_THREADS / 10];
+
+    for (auto i = 0; i < MAX_THREADS / 10; ++i) {
+      threads[i].Start([&list]() {
+        UInt samples[MAX_PROBES];
+
+        for (auto j = 0; j < MAX_PROBES; ++j) {
+          ULong token = list.Add(&samples[j]);
+
+          if (!list.Del(token, &samples[j])) {
+            Bug(EBadAccess, "can't delete as expected");
+          }
+        }
+      });
+    }
+  };
+
+  TIMEOUT(300, { perform(); });
+
+  spent = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  after = Base::List::Statistics();
+  hits = after.Hits - before.Hits;
+  misses = after.Misses - before.Misses;
+
+  EXPECT_EQ(list.Size(), UInt(0));
+  EXPECT_NEQ(hits, ULong(0));
+
+  INFO << Base::Format{"{} Add()/Del() {}us, magazine hits {}, misses {}, "
+                       "refills {}, flushes {}, hit rate {}%"}
+              .Apply(MAX_THREADS / 10 * MAX_PROBES, spent, hits, misses,
+                     after.Refills - before.Refills,
+                     after.Flushes - before.Flushes,
+                     hits * 100 / (hits + misses))
+       << Base::EOL;
+}
+
 int main() { return RUN_ALL_TESTS(); }
@@ -0,0 +1,653 @@
+#include <Atomic.h>
+#include <Auto.h>
+#include <Hash.h>
+#include <Monitor.h>
+#include <Thread.h>
+#include <Unittest.h>
+#include <Utils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define NUM_OF_PAIRS 16
+#define NUM_OF_MESSAGES 20000
+#define MESSAGE_SIZE 64
+
+using namespace Base;
+
+namespace Base {
+namespace Internal {
+void Idle(struct timespec* spec);
+} // namespace Internal
+} // namespace Base
+
+/* @NOTE: heap allocations of the monitors' threads are counted so a benchmark
+ * can tell what an event costs, the thread which sends the events is skipped */
+static pthread_t Sender;
+static Bool Counting{False};
+static ULong Allocations{0};
+
+void* operator new(std::size_t size) {
+  void* result{None};
+
+  if (READ_ONCE(Counting) && !pthread_equal(pthread_self(), Sender)) {
+    INC(&Allocations);
+  }
+
+  if (!(result = malloc(size ? size : 1))) {
+    throw std::bad_alloc();
+  }
+
+  return result;
+}
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+
+/* @NOTE: a reactor which is made of a HEAD and some children, every Monitor
+ * runs its Loop on its own thread until Stop is called */
+struct Reactor {
+  Shared<Monitor> Head;
+  Vector<Shared<Monitor>> Children;
+  Vector<Base::Thread*> Threads;
+  Bool Stopping;
+
+  explicit Reactor(UInt children, UInt type = Monitor::EIOSync):
+      Stopping{False} {
+    Head = Monitor::Make("head", type);
+
+    for (UInt i = 0; i < children; ++i) {
+      Children.push_back(Monitor::Make(Format{"child-{}"}.Apply(i), type));
+    }
+  }
+
+  ~Reactor() {
+    Stop();
+
+    Children.clear();
+    Head = None;
+  }
+
+  void Start() {
+    Vector<Monitor*> monitors{Head.get()};
+
+    for (auto& child : Children) {
+      monitors.push_back(child.get());
+    }
+
+    for (auto monitor : monitors) {
+      Threads.push_back(new Base::Thread{});
+      Threads.back()->Start([this, monitor]() {
+        monitor->Loop([this](Monitor&) -> Bool {
+          return !READ_ONCE(Stopping);
+        }, 10);
+      });
+    }
+  }
+
+  void Stop() {
+    WRITE_ONCE(Stopping, True);
+
+    for (auto thread : Threads) {
+      delete thread;
+    }
+
+    Threads.clear();
+  }
+};
+
+/* @NOTE: a pair of connected sockets, we write to Input and the Monitor
+ * reads from Output */
+struct Channel {
+  Int Input, Output;
+  ULong Received;
+  pthread_t Reader;
+  Bool Mixed;
+
+  Channel(): Input{-1}, Output{-1}, Received{0}, Reader{}, Mixed{False} {
+    Int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+      throw Except(EWatchErrno, Format{"socketpair: {}"} << strerror(errno));
+    }
+
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+    Input = fds[0];
+    Output = fds[1];
+  }
+
+  ~Channel() {
+    close(Input);
+    close(Output);
+  }
+
+  /* @NOTE: read everything since the fd is edge-triggered, `work` is run
+   * once per message to simulate what a server does with a request */
+  ErrorCodeE Read(Function<void(Char*)> work) {
+    Char buffer[MESSAGE_SIZE*16];
+
+    if (Received == 0) {
+      Reader = pthread_self();
+    } else if (!pthread_equal(Reader, pthread_self())) {
+      Mixed = True;
+    }
+
+    while (True) {
+      Long size = read(Output, buffer, sizeof(buffer));
+
+      if (size <= 0) {
+        break;
+      }
+
+      for (Long i = 0; i + MESSAGE_SIZE <= size; i += MESSAGE_SIZE) {
+        work(buffer + i);
+      }
+
+      ADD(&Received, ULong(size));
+    }
+
+    return ENoError;
+  }
+
+  /* @NOTE: io_uring gives us the data when we have asked for direct reads,
+   * epoll and a fallback of io_uring don't so we must read it by ourselves */
+  ErrorCodeE Consume(Monitor* monitor, Function<void(Char*)> work) {
+    String data{};
+
+    if (monitor->Receive(Auto::As<Int>(Output), data)) {
+      return Read(work);
+    }
+
+    if (Received == 0) {
+      Reader = pthread_self();
+    } else if (!pthread_equal(Reader, pthread_self())) {
+      Mixed = True;
+    }
+
+    for (ULong i = 0; i + MESSAGE_SIZE <= data.size(); i += MESSAGE_SIZE) {
+      work(&data[i]);
+    }
+
+    ADD(&Received, ULong(data.size()));
+    return ENoError;
+  }
+};
+
+static Bool WaitFor(Function<Bool()> done, UInt seconds) {
+  struct timespec spec{.tv_sec = 0, .tv_nsec = 1000000};
+
+  for (UInt i = 0; i < seconds*1000; ++i) {
+    if (done()) {
+      return True;
+    }
+
+    Internal::Idle(&spec);
+  }
+
+  return done();
+}
+
+TEST(Monitor, Route) {
+  auto perform = []() {
+    Reactor reactor{2};
+    Channel channels[NUM_OF_PAIRS];
+    pthread_t threads[3];
+    Bool ready[3]{False, False, False};
+    UInt owners[NUM_OF_PAIRS];
+
+    /* @NOTE: a third of the channels are watched by HEAD and the others by
+     * children, HEAD only polls and hands every callback to a child */
+    for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+      Channel* channel = &channels[i];
+
+      owners[i] = i % 3;
+
+      EXPECT_EQ((owners[i] == 0? reactor.Head: reactor.Children[owners[i] - 1])
+                    ->Trigger(Auto::As<Int>(channel->Output),
+                              [channel](Auto, Auto&) -> ErrorCodeE {
+                                return channel->Read([](Char*) {});
+                              }),
+                ENoError);
+    }
+
+    reactor.Start();
+
+    /* @NOTE: learn which threads run the children with their channels */
+    for (UInt i = 0; i < 3; ++i) {
+      EXPECT_EQ(write(channels[i].Input, "x", 1), 1);
+    }
+
+    EXPECT_TRUE(WaitFor([&]() -> Bool {
+      for (UInt i = 0; i < 3; ++i) {
+        if (READ_ONCE(channels[i].Received) < 1) {
+          return False;
+        }
+
+        threads[i] = channels[i].Reader;
+        ready[i] = True;
+      }
+
+      return True;
+    }, 10));
+
+    for (UInt round = 0; round < 100; ++round) {
+      for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+        EXPECT_EQ(write(channels[i].Input, "y", 1), 1);
+      }
+    }
+
+    EXPECT_TRUE(WaitFor([&]() -> Bool {
+      for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+        if (READ_ONCE(channels[i].Received) < (i < 3? 101u: 100u)) {
+          return False;
+        }
+      }
+
+      return True;
+    }, 10));
+
+    reactor.Stop();
+
+    EXPECT_TRUE(ready[0] && ready[1] && ready[2]);
+
+    /* @NOTE: callbacks of a channel always run on one thread, the ones of
+     * children run on their owners and HEAD never runs them itself since
+     * it has children */
+    for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+      EXPECT_FALSE(channels[i].Mixed);
+
+      if (owners[i] > 0) {
+        EXPECT_TRUE(pthread_equal(channels[i].Reader, threads[owners[i]]));
+      } else {
+        EXPECT_TRUE(pthread_equal(channels[i].Reader, threads[1]) ||
+                    pthread_equal(channels[i].Reader, threads[2]));
+      }
+    }
+  };
+
+  TIMEOUT(30, { perform(); });
+}
+
+TEST(Monitor, Inline) {
+  auto perform = []() {
+    Reactor reactor{0};
+    Channel channel{};
+    Channel* pointer = &channel;
+
+    /* @NOTE: without children, HEAD runs callbacks by itself */
+    EXPECT_EQ(reactor.Head->Trigger(Auto::As<Int>(channel.Output),
+                                    [pointer](Auto, Auto&) -> ErrorCodeE {
+                                      return pointer->Read([](Char*) {});
+                                    }),
+              ENoError);
+
+    reactor.Start();
+
+    for (UInt i = 0; i < 100; ++i) {
+      EXPECT_EQ(write(channel.Input, "z", 1), 1);
+    }
+
+    EXPECT_TRUE(WaitFor([&]() -> Bool {
+      return READ_ONCE(channel.Received) == 100;
+    }, 10));
+
+    reactor.Stop();
+  };
+
+  TIMEOUT(30, { perform(); });
+}
+
+TEST(Monitor, URing) {
+  auto perform = [](UInt children) {
+    Reactor reactor{children, Base::Monitor::EIOUring};
+    Channel channels[NUM_OF_PAIRS];
+    ULong broken{0};
+
+    /* @NOTE: every byte must come exactly once and in order whether the
+     * kernel reads it for us or we read it when io_uring isn't supported.
+     * Only even channels ask for direct reads and the context keeps what
+     * the callbacks put there */
+    for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+      Channel* channel = &channels[i];
+      Base::Monitor* monitor = (i % 2 == 0 || children == 0? reactor.Head:
+                          reactor.Children[i % children]).get();
+
+      EXPECT_EQ(monitor->Trigger(Auto::As<Int>(channel->Output),
+                                 [=, &broken](Auto, Auto& context)
+                                     -> ErrorCodeE {
+                  if (context == nullptr) {
+                    context = Auto::As<Int>(channel->Output);
+                  } else if (context.Get<Int>() != channel->Output) {
+                    ADD(&broken, 1ul);
+                  }
+
+                  return channel->Consume(monitor, [&](Char* m) {
+                    if (m[0] != Char('a' + (m[1] % 26))) {
+                      ADD(&broken, 1ul);
+                    }
+                  });
+                }),
+                ENoError);
+
+      if (i % 2 == 0) {
+        EXPECT_EQ(monitor->Modify(Auto::As<Int>(channel->Output),
+                                  Base::Monitor::EDirect),
+                  ENoError);
+      }
+    }
+
+    reactor.Start();
+
+    for (UInt round = 0; round < 100; ++round) {
+      for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+        Char message[MESSAGE_SIZE];
+
+        memset(message, 'a' + (round % 26), sizeof(message));
+        message[1] = Char(round);
+
+        EXPECT_EQ(write(channels[i].Input, message, MESSAGE_SIZE),
+                  MESSAGE_SIZE);
+      }
+    }
+
+    EXPECT_TRUE(WaitFor([&]() -> Bool {
+      for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+        if (READ_ONCE(channels[i].Received) < 100u*MESSAGE_SIZE) {
+          return False;
+        }
+      }
+
+      return True;
+    }, 10));
+
+    reactor.Stop();
+
+    EXPECT_EQ(broken, 0ul);
+
+    for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+      EXPECT_EQ(channels[i].Received, 100ul*MESSAGE_SIZE);
+      EXPECT_FALSE(channels[i].Mixed);
+    }
+  };
+
+  EXPECT_TRUE(Base::Monitor::IsSupport(Base::Monitor::EIOUring));
+
+  TIMEOUT(30, { perform(0); });
+  TIMEOUT(30, { perform(2); });
+}
+
+TEST(Monitor, Timer) {
+  using Clock = std::chrono::steady_clock;
+  using Milli = std::chrono::milliseconds;
+
+  auto perform = [](UInt children) {
+    Reactor reactor{children, Base::Monitor::ETimer};
+    auto begin = Clock::now();
+    ULong once{0}, periodic{0}, failed{0}, cancelled{0}, wrong{0};
+    ULong elapsed{0}, bursts{1}, stamps[100];
+    auto stamp = [&]() -> ULong {
+      return std::chrono::duration_cast<Milli>(Clock::now() - begin).count();
+    };
+
+    reactor.Start();
+
+    /* @NOTE: callbacks receive the id of their timer instead of a fd */
+    EXPECT_EQ(reactor.Head->Trigger(Auto::As(Base::Monitor::Timer{1, 20, 0, 0}),
+                                    [&](Auto id, Auto&) -> ErrorCodeE {
+                                      if (id.Get<ULong>() != 1) {
+                                        INC(&wrong);
+                                      }
+
+                                      WRITE_ONCE(elapsed, stamp());
+                                      INC(&once);
+                                      return ENoError;
+                                    }),
+              ENoError);
+
+    EXPECT_EQ(reactor.Head->Trigger(Auto::As(Base::Monitor::Timer{2, 5, 5, 0}),
+                                    [&](Auto, Auto&) -> ErrorCodeE {
+                                      INC(&periodic);
+                                      return ENoError;
+                                    }),
+              ENoError);
+
+    /* @NOTE: a periodic timer stops when its callback fails */
+    EXPECT_EQ(reactor.Head->Trigger(Auto::As(Base::Monitor::Timer{3, 1, 1, 0}),
+                                    [&](Auto, Auto&) -> ErrorCodeE {
+                                      return INC(&failed) == 3? EBadAccess:
+                                                                ENoError;
+                                    }),
+              ENoError);
+
+    EXPECT_EQ(reactor.Head->Trigger(Auto::As(Base::Monitor::Timer{4, 50, 0, 0}),
+                                    [&](Auto, Auto&) -> ErrorCodeE {
+                                      INC(&cancelled);
+                                      return ENoError;
+                                    }),
+              ENoError);
+
+    EXPECT_NEQ(reactor.Head->Trigger(Auto::As(Base::Monitor::Timer{4, 1, 0, 0}),
+                                     [&](Auto, Auto&) -> ErrorCodeE {
+                                       INC(&cancelled);
+                                       return ENoError;
+                                     }),
+               ENoError);
+
+    EXPECT_EQ(reactor.Head->Find(Auto::As<ULong>(4)), ENoError);
+    EXPECT_EQ(reactor.Head->Remove(Auto::As<ULong>(4)), ENoError);
+    EXPECT_EQ(reactor.Head->Find(Auto::As<ULong>(4)), ENotFound);
+
+    /* @NOTE: timers with a slack of 64ms are rounded to the same few ticks */
+    ULong scheduling = stamp();
+
+    for (ULong i = 0; i < 100; ++i) {
+      stamps[i] = 0;
+
+      EXPECT_EQ((children? reactor.Children[i % children]: reactor.Head)
+                    ->Trigger(Auto::As(Base::Monitor::Timer{100 + i, i + 1, 0,
+                                                            64}),
+                              [&, i](Auto, Auto&) -> ErrorCodeE {
+                                WRITE_ONCE(stamps[i], stamp() + 1);
+                                return ENoError;
+                              }),
+                ENoError);
+    }
+
+    scheduling = stamp() - scheduling;
+
+    EXPECT_TRUE(WaitFor([&]() -> Bool {
+      for (auto i = 0; i < 100; ++i) {
+        if (READ_ONCE(stamps[i]) == 0) {
+          return False;
+        }
+      }
+
+      return READ_ONCE(once) > 0 && READ_ONCE(periodic) >= 10;
+    }, 10));
+
+    EXPECT_EQ(reactor.Head->Remove(Auto::As<ULong>(2)), ENoError);
+
+    /* @NOTE: leave enough time to the cancelled timer to fire if it was
+     * still there */
+    EXPECT_TRUE(WaitFor([&]() -> Bool { return stamp() >= 100; }, 1));
+
+    reactor.Stop();
+
+    EXPECT_EQ(once, 1ul);
+    EXPECT_EQ(wrong, 0ul);
+    EXPECT_EQ(failed, 3ul);
+    EXPECT_EQ(cancelled, 0ul);
+    EXPECT_GE(elapsed, 19ul);
+    EXPECT_EQ(reactor.Head->Find(Auto::As<ULong>(3)), ENotFound);
+
+    /* @NOTE: the expiries are rounded to multiples of 64ms so the timers
+     * fire in at most 3 bursts, a burst may span a few milliseconds. A slow
+     * build may take a while to put them, every 64ms of it adds a burst */
+    std::sort(stamps, stamps + 100);
+
+    for (auto i = 1; i < 100; ++i) {
+      if (stamps[i] - stamps[i - 1] > 10) {
+        bursts++;
+      }
+    }
+
+    EXPECT_LE(bursts, 3 + scheduling/64);
+  };
+
+  EXPECT_TRUE(Base::Monitor::IsSupport(Base::Monitor::ETimer));
+
+  TIMEOUT(30, { perform(0); });
+  TIMEOUT(30, { perform(2); });
+}
+
+/* @NOTE: send messages through the channels of a reactor and return how
+ * many of them are handled per second, HEAD watches `idle` more fds which
+ * never wake up */
+static ULong Throughput(UInt type, UInt children, UInt idle = 0) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  Reactor reactor{children, type};
+  Channel channels[NUM_OF_PAIRS];
+  Vector<Int> sleepers{};
+  ULong sink{0}, spent{0};
+  Char message[MESSAGE_SIZE];
+
+  memset(message, 'm', sizeof(message));
+
+  for (UInt i = 0; i < idle; ++i) {
+    sleepers.push_back(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+
+    EXPECT_EQ(reactor.Head->Trigger(Auto::As<Int>(sleepers.back()),
+                                    [](Auto, Auto&) -> ErrorCodeE {
+                                      return ENoError;
+                                    }),
+              ENoError);
+  }
+
+  /* @NOTE: every message costs a few microseconds of hashing, like the
+   * parsing a server does per request */
+  for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+    Channel* channel = &channels[i];
+    Monitor* head = reactor.Head.get();
+
+    head->Trigger(Auto::As<Int>(channel->Output),
+                  [channel, head, &sink](Auto, Auto&) -> ErrorCodeE {
+      return channel->Consume(head, [&](Char* data) {
+        ULong hashing{0};
+
+        for (UInt k = 0; k < 64; ++k) {
+          hashing = Hash::Digest(data, MESSAGE_SIZE, hashing);
+        }
+
+        ADD(&sink, hashing & 1);
+      });
+    });
+
+    head->Modify(Auto::As<Int>(channel->Output), Monitor::EDirect);
+  }
+
+  reactor.Start();
+
+  {
+    auto begin = Clock::now();
+
+    for (UInt i = 0; i < NUM_OF_MESSAGES; ++i) {
+      EXPECT_EQ(write(channels[i % NUM_OF_PAIRS].Input, message,
+                      MESSAGE_SIZE), MESSAGE_SIZE);
+    }
+
+    EXPECT_TRUE(WaitFor([&]() -> Bool {
+      ULong received{0};
+
+      for (UInt i = 0; i < NUM_OF_PAIRS; ++i) {
+        received += READ_ONCE(channels[i].Received);
+      }
+
+      return received == ULong(NUM_OF_MESSAGES)*MESSAGE_SIZE;
+    }, 60));
+
+    spent = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+  }
+
+  reactor.Stop();
+
+  for (auto fd: sleepers) {
+    reactor.Head->Remove(Auto::As<Int>(fd));
+    close(fd);
+  }
+
+  return ULong(NUM_OF_MESSAGES)*1000000/(spent + 1);
+}
+
+TEST(MonitorBenchmark, Loopback) {
+  for (UInt type : {Base::Monitor::EIOSync, Base::Monitor::EIOUring})
+  for (UInt children : {0, 1, 2, 4}) {
+    INFO << Format{"{} loopback with {} children: {} messages, {} msg/s"}
+                .Apply(type == Base::Monitor::EIOSync? "epoll": "io_uring",
+                       children, NUM_OF_MESSAGES, Throughput(type, children))
+         << Base::EOL;
+  }
+}
+
+TEST(MonitorBenchmark, Allocation) {
+  /* @NOTE: messages are sent one by one so every message is one event, the
+   * callback only reads so whatever is allocated comes from the dispatching */
+  for (UInt children : {0, 1}) {
+    Reactor reactor{children};
+    Channel channel{};
+    Channel* pointer = &channel;
+
+    reactor.Head->Trigger(Auto::As<Int>(channel.Output),
+                          [pointer](Auto, Auto&) -> ErrorCodeE {
+                            return pointer->Read([](Char*) {});
+                          });
+
+    reactor.Start();
+
+    for (UInt i = 0; i < 1100; ++i) {
+      if (i == 100) {
+        Sender = pthread_self();
+        Allocations = 0;
+        WRITE_ONCE(Counting, True);
+      }
+
+      EXPECT_EQ(write(channel.Input, "a", 1), 1);
+      EXPECT_TRUE(WaitFor([&]() -> Bool {
+        return READ_ONCE(channel.Received) == i + 1;
+      }, 10));
+    }
+
+    WRITE_ONCE(Counting, False);
+    reactor.Stop();
+
+    INFO << Format{"epoll with {} children: {} allocations per event"}
+                .Apply(children, Allocations/1000)
+         << Base::EOL;
+  }
+}
+
+TEST(MonitorBenchmark, Crowded) {
+  /* @NOTE: every event looks its fd up a few times, so a crowded Monitor
+   * must not be slower than an empty one */
+  for (UInt idle : {0, 1000, 16000}) {
+    INFO << Format{"epoll loopback beside {} idle fds: {} msg/s"}
+                .Apply(idle, Throughput(Base::Monitor::EIOSync, 0, idle))
+         << Base::EOL;
+  }
+}
+
+int main() {
+  /* @NOTE: Fildes logs every event on EDebug, it would drown the benchmark */
+  Base::Log::Level() = EInfo;
+  return RUN_ALL_TESTS();
+}
@@ -3,10 +3,24 @@
 #include <Unittest.h>
 
 #include <stdlib.h>     /* srand, rand */
+#include <time.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <thread>
+
 #define MAX_THREADS 900
 #define MAX_VALUE 18000
+#define MAX_BACKLOG 1024
+#define MAX_WORKERS 8
+#define MAX_ROUNDS 1000
+
+static ULong Now(clockid_t clock) {
+  struct timespec spec;
+
+  clock_gettime(clock, &spec);
+  return ULong(spec.tv_sec) * ULong(1e9) + ULong(spec.tv_nsec);
+}
 
 TEST(Queue, Simple) {
   Base::Queue<Int> queue{};
@@ -137,6 +151,587 @@ TEST(Queue, Bandwidth) {
   };
 }
 
+TEST(QueueRing, Simple) {
+  Base::Queue<Int> queue{16};
+  Function<void()> perform = [&]() {
+    ULong tasks[16];
+
+    for (Int value = 0; value < 16; ++value) {
+      EXPECT_TRUE(queue.Put(RValue(value)));
+    }
+
+    /* @NOTE: the backlog is full so Put should fail fast without timeout */
+
+    EXPECT_FALSE(queue.Put(RValue(16), 0));
+    EXPECT_EQ(queue.QSize(), 16);
+
+    for (Int expect = 0; expect < 16; ++expect) {
+      Int value;
+
+      EXPECT_NEQ((tasks[expect] = queue.Get(value)), ULong(0));
+      EXPECT_EQ(value, expect);
+    }
+
+    /* @NOTE: values are still processing so they are still counted */
+
+    EXPECT_FALSE(queue.Put(RValue(16), 0));
+    EXPECT_TRUE(queue.Reject(tasks[0]));
+
+    for (Int expect = 1; expect < 16; ++expect) {
+      EXPECT_TRUE(queue.Done(tasks[expect]));
+    }
+
+    for (Int value = 0; value < 15; ++value) {
+      EXPECT_TRUE(queue.Put(RValue(value), 0));
+    }
+
+    EXPECT_EQ(queue.QSize(), 16);
+    EXPECT_EQ(queue.WSize(), 0);
+  };
+
+  TIMEOUT(100, { perform(); } );
+}
+
+TEST(QueueRing, Threads) {
+  Base::Queue<Int> queue{MAX_BACKLOG};
+  Int sum{0}, consumed{0};
+
+  Function<void()> perform = [&]() {
+    Base::Thread threads[2*MAX_WORKERS];
+
+    for (auto i = 0; i < MAX_WORKERS; ++i) {
+      threads[i].Start([&queue]() {
+        for (Int value = 1; value <= MAX_VALUE; ++value) {
+          if (!queue.Put(RValue(value))) {
+            Bug(EBadLogic, "can\'t put a value as expected");
+          }
+        }
+      });
+
+      threads[MAX_WORKERS + i].Start([&]() {
+        while (READ_ONCE(consumed) < MAX_WORKERS * MAX_VALUE) {
+          Int value;
+          ULong task = queue.Get(value);
+
+          if (task) {
+            ADD(&sum, value % 7);
+            INC(&consumed);
+            queue.Done(task);
+          } else {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+  };
+
+  TIMEOUT(200, { perform(); });
+
+  EXPECT_EQ(consumed, MAX_WORKERS * MAX_VALUE);
+  EXPECT_EQ(queue.QSize(), 0);
+  EXPECT_EQ(queue.WSize(), 0);
+}
+
+TEST(QueueBenchmark, Backend) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  UInt backlogs[] = {0, MAX_BACKLOG, MAX_WORKERS * MAX_VALUE};
+  String names[] = {"linked", "ring", "ring without backpressure"};
+
+  for (auto i = 0; i < 3; ++i) {
+    Base::Queue<Int> queue{backlogs[i]};
+    Int consumed{0};
+    auto begin = Clock::now();
+    ULong spent{0};
+
+    Function<void()> perform = [&]() {
+      Base::Thread threads[2*MAX_WORKERS];
+
+      for (auto j = 0; j < MAX_WORKERS; ++j) {
+        threads[j].Start([&queue]() {
+          for (Int value = 1; value <= MAX_VALUE; ++value) {
+            queue.Put(RValue(value));
+          }
+        });
+
+        threads[MAX_WORKERS + j].Start([&]() {
+          while (READ_ONCE(consumed) < MAX_WORKERS * MAX_VALUE) {
+            Int value;
+            ULong task = queue.Get(value);
+
+            if (task) {
+              INC(&consumed);
+              queue.Done(task);
+            } else {
+              std::this_thread::yield();
+            }
+          }
+        });
+      }
+    };
+
+    TIMEOUT(300, { perform(); });
+
+    spent = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+
+    EXPECT_EQ(consumed, MAX_WORKERS * MAX_VALUE);
+    INFO << Base::Format{"{}: {} producers, {} consumers, {} values in {}us "
+                         "({} values/ms)"}
+                .Apply(names[i], MAX_WORKERS, MAX_WORKERS,
+                       MAX_WORKERS * MAX_VALUE, spent,
+                       ULong(MAX_WORKERS * MAX_VALUE) * 1000 / (spent + 1))
+         << Base::EOL;
+  }
+}
+
+TEST(QueueWait, Timeout) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+
+  for (auto backlog : backlogs) {
+    Base::Queue<Int> queue{backlog};
+    ULong begin{Now(CLOCK_MONOTONIC)}, spent{0};
+    Int value{0};
+
+    /* @NOTE: an empty queue returns immediately without timeout and waits
+     * about 50ms with a sub-second timeout */
+
+    EXPECT_EQ(queue.Get(value), ULong(0));
+    EXPECT_EQ(queue.Get(value, 0.05), ULong(0));
+
+    spent = Now(CLOCK_MONOTONIC) - begin;
+
+    EXPECT_GE(spent, ULong(50e6));
+    EXPECT_LT(spent, ULong(1e9));
+  }
+}
+
+TEST(QueueWait, Idle) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+
+  for (auto backlog : backlogs) {
+    Base::Queue<Int> queue{backlog};
+    ULong cpu{0}, task{0};
+    Int value{0};
+
+    {
+      Base::Thread consumer{};
+
+      consumer.Start([&]() {
+        ULong begin{Now(CLOCK_THREAD_CPUTIME_ID)};
+
+        task = queue.Get(value, -1.0);
+        cpu = Now(CLOCK_THREAD_CPUTIME_ID) - begin;
+      });
+
+      /* @NOTE: the consumer parks while the queue is idle so it shouldn't
+       * burn any CPU time during this period */
+
+      usleep(200000);
+      EXPECT_TRUE(queue.Put(RValue(10)));
+    }
+
+    EXPECT_NEQ(task, ULong(0));
+    EXPECT_EQ(value, 10);
+    EXPECT_TRUE(queue.Done(task));
+    EXPECT_LT(cpu, ULong(20e6));
+
+    INFO << Base::Format{"consumer spent {}us of CPU while idling 200ms"}
+                .Apply(cpu / 1000)
+         << Base::EOL;
+  }
+}
+
+TEST(QueueBenchmark, Wakeup) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+  String names[] = {"linked", "ring"};
+
+  for (auto i = 0; i < 2; ++i) {
+    Base::Queue<ULong> queue{backlogs[i]};
+    ULong total{0}, worst{0};
+
+    Function<void()> perform = [&]() {
+      Base::Thread consumer{};
+
+      consumer.Start([&]() {
+        for (auto round = 0; round < MAX_ROUNDS; ++round) {
+          ULong stamp{0}, task{queue.Get(stamp, -1.0)}, latency{0};
+
+          latency = Now(CLOCK_MONOTONIC) - stamp;
+          total += latency;
+          worst = worst < latency ? latency : worst;
+
+          queue.Done(task);
+        }
+      });
+
+      /* @NOTE: give the consumer enough time to park before each value so
+       * we measure how long a wakeup takes */
+
+      for (auto round = 0; round < MAX_ROUNDS; ++round) {
+        usleep(100);
+        queue.Put(Now(CLOCK_MONOTONIC));
+      }
+    };
+
+    TIMEOUT(100, { perform(); });
+
+    INFO << Base::Format{"{}: wakeup latency avg {}ns, max {}ns"}
+                .Apply(names[i], total / MAX_ROUNDS, worst)
+         << Base::EOL;
+  }
+}
+
+TEST(QueueBatch, Simple) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+
+  for (auto backlog : backlogs) {
+    Base::Queue<Int> queue{backlog};
+    Vector<Int> values{};
+    Int expect{0};
+
+    for (Int value = 0; value < MAX_BACKLOG; ++value) {
+      values.push_back(value);
+    }
+
+    EXPECT_EQ(queue.PutMany(values.begin(), values.end()), ULong(MAX_BACKLOG));
+    EXPECT_EQ(queue.QSize(), MAX_BACKLOG);
+
+    while (expect < MAX_BACKLOG) {
+      Int outputs[100];
+      ULong tasks[100], count{queue.GetMany(outputs, tasks, 100)};
+
+      EXPECT_NEQ(count, ULong(0));
+
+      for (ULong i = 0; i < count; ++i) {
+        EXPECT_EQ(outputs[i], expect++);
+      }
+
+      EXPECT_EQ(queue.DoneMany(tasks, count), count);
+    }
+
+    EXPECT_EQ(queue.QSize(), 0);
+    EXPECT_EQ(queue.WSize(), 0);
+  }
+}
+
+TEST(QueueBatch, Threads) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+
+  for (auto backlog : backlogs) {
+    Base::Queue<Int> queue{backlog};
+    Int sum{0}, consumed{0};
+
+    Function<void()> perform = [&]() {
+      Base::Thread threads[2*MAX_WORKERS];
+
+      for (auto i = 0; i < MAX_WORKERS; ++i) {
+        threads[i].Start([&queue]() {
+          Vector<Int> values{};
+
+          for (Int value = 1; value <= MAX_VALUE; ++value) {
+            values.push_back(value);
+          }
+
+          if (queue.PutMany(values.begin(), values.end()) != MAX_VALUE) {
+            Bug(EBadLogic, "can\'t put values as expected");
+          }
+        });
+
+        threads[MAX_WORKERS + i].Start([&]() {
+          while (READ_ONCE(consumed) < MAX_WORKERS * MAX_VALUE) {
+            Int values[QUEUE_BATCH];
+            ULong tasks[QUEUE_BATCH];
+            ULong count = queue.GetMany(values, tasks, QUEUE_BATCH, 0.01);
+
+            for (ULong j = 0; j < count; ++j) {
+              ADD(&sum, values[j] % 7);
+            }
+
+            ADD(&consumed, Int(count));
+            queue.DoneMany(tasks, count);
+          }
+        });
+      }
+    };
+
+    TIMEOUT(200, { perform(); });
+
+    EXPECT_EQ(consumed, MAX_WORKERS * MAX_VALUE);
+    EXPECT_EQ(queue.QSize(), 0);
+    EXPECT_EQ(queue.WSize(), 0);
+  }
+}
+
+TEST(QueueBenchmark, Batch) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  UInt backlogs[] = {0, MAX_BACKLOG};
+  String names[] = {"linked", "ring"};
+
+  for (auto i = 0; i < 2; ++i) {
+    Base::Queue<Int> queue{backlogs[i]};
+    Int consumed{0};
+    auto begin = Clock::now();
+    ULong spent{0};
+
+    Function<void()> perform = [&]() {
+      Base::Thread threads[2*MAX_WORKERS];
+
+      for (auto j = 0; j < MAX_WORKERS; ++j) {
+        threads[j].Start([&queue]() {
+          Int values[QUEUE_BATCH];
+
+          for (Int value = 0; value < MAX_VALUE; value += QUEUE_BATCH) {
+            for (auto k = 0; k < QUEUE_BATCH; ++k) {
+              values[k] = value + k;
+            }
+
+            queue.PutMany(values, values + QUEUE_BATCH);
+          }
+        });
+
+        threads[MAX_WORKERS + j].Start([&]() {
+          Int total = MAX_WORKERS * ((MAX_VALUE + QUEUE_BATCH - 1) /
+                                     QUEUE_BATCH * QUEUE_BATCH);
+
+          while (READ_ONCE(consumed) < total) {
+            Int values[QUEUE_BATCH];
+            ULong tasks[QUEUE_BATCH];
+            ULong count = queue.GetMany(values, tasks, QUEUE_BATCH);
+
+            if (count) {
+              ADD(&consumed, Int(count));
+              queue.DoneMany(tasks, count);
+            } else {
+              std::this_thread::yield();
+            }
+          }
+        });
+      }
+    };
+
+    TIMEOUT(300, { perform(); });
+
+    spent = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+
+    INFO << Base::Format{"{} batched: {} producers, {} consumers, {} values in "
+                         "{}us ({} values/ms)"}
+                .Apply(names[i], MAX_WORKERS, MAX_WORKERS, consumed, spent,
+                       ULong(consumed) * 1000 / (spent + 1))
+         << Base::EOL;
+  }
+}
+
+TEST(QueueTask, Stale) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+
+  for (auto backlog : backlogs) {
+    Base::Queue<Int> queue{backlog};
+    ULong first{0}, second{0};
+    Int value{0};
+
+    EXPECT_TRUE(queue.Put(RValue(1)));
+    EXPECT_NEQ((first = queue.Get(value)), ULong(0));
+    EXPECT_TRUE(queue.Done(first));
+
+    /* @NOTE: the slot of the first task is reused by the second one but its
+     * generation has changed, so acknowledging the first task again must be
+     * detected as stale */
+
+    EXPECT_TRUE(queue.Put(RValue(2)));
+    EXPECT_NEQ((second = queue.Get(value)), ULong(0));
+    EXPECT_EQ(second & 0xffffffff, first & 0xffffffff);
+    EXPECT_NEQ(second, first);
+
+    EXPECT_FALSE(queue.Done(first));
+    EXPECT_FALSE(queue.Reject(first));
+    EXPECT_EQ(queue.WSize(), 1);
+
+    EXPECT_TRUE(queue.Done(second));
+    EXPECT_FALSE(queue.Done(second));
+    EXPECT_FALSE(queue.Done(0));
+    EXPECT_EQ(queue.WSize(), 0);
+
+    /* @NOTE: a rejected task comes back with a new id, the old one must not
+     * reach the node again */
+
+    EXPECT_TRUE(queue.Put(RValue(3)));
+    EXPECT_NEQ((first = queue.Get(value)), ULong(0));
+    EXPECT_TRUE(queue.Reject(first));
+    EXPECT_EQ(queue.WSize(), 0);
+    EXPECT_FALSE(queue.Reject(first));
+    EXPECT_FALSE(queue.Done(first));
+
+    EXPECT_NEQ((second = queue.Get(value)), ULong(0));
+    EXPECT_EQ(value, 3);
+    EXPECT_FALSE(queue.Done(first));
+    EXPECT_TRUE(queue.Done(second));
+    EXPECT_EQ(queue.WSize(), 0);
+  }
+}
+
+TEST(QueueTask, Duplicate) {
+  UInt backlog{4};
+  Base::Queue<Int> queue{backlog};
+  ULong current{0};
+  Bool stop{False};
+  Int value{0};
+  ULong task{0};
+
+  /* @NOTE: duplicated acks race with the consumer which acknowledges and
+   * fetches again, so a node is reused under a new id while a late Done or
+   * Reject with the old id is still running. Only one of them may win, a
+   * broken node would stay inside the cache and the backlog would shrink */
+
+  Function<void()> perform = [&]() {
+    Base::Thread threads[MAX_WORKERS];
+
+    for (auto i = 0; i < MAX_WORKERS; ++i) {
+      threads[i].Start([&, i]() {
+        for (ULong round = 0; !READ_ONCE(stop); ++round) {
+          ULong task = READ_ONCE(current);
+
+          if (!task) {
+            continue;
+          } else if ((i + round) % 2) {
+            queue.Done(task);
+          } else {
+            queue.Reject(task);
+          }
+        }
+      });
+    }
+
+    for (Int round = 0; round < 20 * MAX_VALUE; ++round) {
+      Int value{0};
+      ULong task = queue.Get(value);
+
+      if (!task) {
+        queue.Put(RValue(round), 1.0);
+        continue;
+      }
+
+      WRITE_ONCE(current, task);
+      queue.Done(task);
+    }
+
+    WRITE_ONCE(stop, True);
+  };
+
+  TIMEOUT(200, { perform(); });
+
+  while ((task = queue.Get(value))) {
+    EXPECT_TRUE(queue.Done(task));
+  }
+
+  EXPECT_EQ(queue.QSize(), 0);
+  EXPECT_EQ(queue.WSize(), 0);
+
+  for (UInt i = 0; i < backlog; ++i) {
+    EXPECT_TRUE(queue.Put(RValue(Int(i)), 0.0));
+  }
+
+  EXPECT_FALSE(queue.Put(RValue(Int(backlog)), 0.0));
+}
+
+TEST(QueueBenchmark, Inflight) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Micro = std::chrono::microseconds;
+
+  Base::Queue<Int> queue{};
+  Vector<ULong> tasks{};
+  ULong spent{0}, done{0};
+
+  for (Int value = 0; value < MAX_VALUE; ++value) {
+    EXPECT_TRUE(queue.Put(RValue(value)));
+  }
+
+  for (Int value = 0; value < MAX_VALUE; ++value) {
+    Int output;
+
+    tasks.push_back(queue.Get(output));
+  }
+
+  EXPECT_EQ(queue.WSize(), MAX_VALUE);
+
+  /* @NOTE: acknowledge the tasks in the reverse order so the table doesn't
+   * take advantage of anything, every Done must cost the same */
+
+  auto begin = Clock::now();
+
+  for (auto i = tasks.size(); i > 0; --i) {
+    done += queue.Done(tasks[i - 1]);
+  }
+
+  spent = std::chrono::duration_cast<Micro>(Clock::now() - begin).count();
+
+  EXPECT_EQ(done, ULong(MAX_VALUE));
+  EXPECT_EQ(queue.WSize(), 0);
+  INFO << Base::Format{"acknowledged {} in-flight tasks in {}us"}
+              .Apply(MAX_VALUE, spent)
+       << Base::EOL;
+}
+
+TEST(QueueValue, MoveOnly) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+
+  for (auto backlog : backlogs) {
+    Base::Queue<Unique<Int>> queue{backlog};
+    Unique<Int> value{};
+    ULong task{0};
+
+    for (Int i = 0; i < MAX_BACKLOG; ++i) {
+      EXPECT_TRUE(queue.Put(Unique<Int>(new Int{i})));
+    }
+
+    /* @NOTE: values are moved out by Get so a rejected task must give its
+     * value back */
+
+    EXPECT_NEQ((task = queue.Get(value)), ULong(0));
+    EXPECT_EQ(*value, 0);
+    EXPECT_TRUE(queue.Reject(task, RValue(value)));
+
+    for (Int i = 1; i <= MAX_BACKLOG; ++i) {
+      EXPECT_NEQ((task = queue.Get(value)), ULong(0));
+      EXPECT_EQ(*value, i % MAX_BACKLOG);
+      EXPECT_TRUE(queue.Done(task));
+    }
+
+    EXPECT_EQ(queue.QSize(), 0);
+    EXPECT_EQ(queue.WSize(), 0);
+  }
+}
+
+TEST(QueueValue, Lifetime) {
+  UInt backlogs[] = {0, MAX_BACKLOG};
+
+  for (auto backlog : backlogs) {
+    Base::Queue<String> queue{backlog};
+    String value{};
+    ULong task{0};
+
+    /* @NOTE: the queue keeps its own copy so the caller's value can go away
+     * right after Put */
+
+    {
+      String sample{"a value which is long enough to be allocated"};
+
+      EXPECT_TRUE(queue.Put(sample));
+      sample.assign("changed");
+    }
+
+    EXPECT_NEQ((task = queue.Get(value)), ULong(0));
+    EXPECT_EQ(value, String{"a value which is long enough to be allocated"});
+    EXPECT_TRUE(queue.Reject(task));
+
+    EXPECT_NEQ((task = queue.Get(value)), ULong(0));
+    EXPECT_EQ(value, String{"a value which is long enough to be allocated"});
+    EXPECT_TRUE(queue.Done(task));
+  }
+}
+
 int main() {
   Base::Log::Level() = EDebug;
   return RUN_ALL_TESTS();
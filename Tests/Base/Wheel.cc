@@ -0,0 +1,216 @@
+#include <Unittest.h>
+#include <Wheel.h>
+
+#include <chrono>
+#include <random>
+
+#define MAX_TIMERS (1 << 20)
+
+TEST(Wheel, Simple) {
+  Base::Wheel<UInt> wheel{1000};
+  Vector<UInt> fired{};
+  auto collect = [&](ULong UNUSED(handle), UInt& value) {
+    fired.push_back(value);
+  };
+
+  wheel.Put(1010, 2);
+  wheel.Put(1005, 1);
+  wheel.Put(900, 0);
+  EXPECT_EQ(wheel.Size(), 3ul);
+
+  /* @NOTE: a timer which is already due fires on the next Advance */
+  EXPECT_EQ(wheel.Next(), 1000ul);
+  EXPECT_EQ(wheel.Advance(1004, collect), 1ul);
+  EXPECT_EQ(fired.size(), 1ul);
+  EXPECT_EQ(fired[0], 0u);
+
+  EXPECT_EQ(wheel.Next(), 1005ul);
+  EXPECT_EQ(wheel.Advance(1009, collect), 1ul);
+  EXPECT_EQ(wheel.Advance(1010, collect), 1ul);
+  EXPECT_EQ(fired.size(), 3ul);
+  EXPECT_EQ(fired[2], 2u);
+
+  EXPECT_EQ(wheel.Size(), 0ul);
+  EXPECT_EQ(wheel.Next(), ~0ul);
+}
+
+TEST(Wheel, Cancel) {
+  Base::Wheel<UInt> wheel{};
+  ULong count{0};
+  auto first = wheel.Put(10, 1);
+  auto second = wheel.Put(10, 2);
+
+  EXPECT_EQ(wheel.Cancel(first), ENoError);
+  EXPECT_EQ(wheel.Cancel(first), ENotFound);
+  EXPECT_TRUE(wheel.Find(first) == None);
+  EXPECT_EQ(*wheel.Find(second), 2u);
+
+  /* @NOTE: the node of a cancelled timer is reused but the old handle stays
+   * invalid */
+  auto third = wheel.Put(20, 3);
+
+  EXPECT_NEQ(third, first);
+  EXPECT_EQ(wheel.Cancel(first), ENotFound);
+
+  wheel.Advance(100, [&](ULong handle, UInt& value) {
+    EXPECT_NEQ(handle, first);
+    EXPECT_NEQ(value, 1u);
+    count++;
+  });
+
+  EXPECT_EQ(count, 2ul);
+  EXPECT_EQ(wheel.Cancel(second), ENotFound);
+}
+
+TEST(Wheel, Cascade) {
+  Base::Wheel<ULong> wheel{123};
+  Vector<ULong> expiries{130, 123 + 255, 123 + 256, 123 + 65536, 70000,
+                         (1ul << 24) + 7, (1ul << 33) + 5};
+  Vector<ULong> fired{};
+  ULong now{123};
+
+  for (auto expiry: expiries) {
+    wheel.Put(expiry, expiry);
+  }
+
+  /* @NOTE: jump from a point to the next one, every timer must fire exactly
+   * on its own tick even if it comes from an upper level */
+  while (wheel.Size() > 0) {
+    ULong next = wheel.Next();
+
+    EXPECT_GE(next, now);
+    wheel.Advance(next, [&](ULong UNUSED(handle), ULong& value) {
+      EXPECT_EQ(value, next);
+      fired.push_back(value);
+    });
+
+    now = next + 1;
+  }
+
+  EXPECT_EQ(fired.size(), expiries.size());
+
+  for (UInt i = 0; i < fired.size(); ++i) {
+    EXPECT_EQ(fired[i], expiries[i]);
+  }
+}
+
+TEST(Wheel, Periodic) {
+  Base::Wheel<UInt> wheel{};
+  Vector<ULong> ticks{};
+  ULong count{0};
+
+  wheel.Put(5, 0, 10);
+
+  for (ULong now = 0; now < 100; ++now) {
+    wheel.Advance(now, [&](ULong UNUSED(handle), UInt& UNUSED(value)) {
+      ticks.push_back(now);
+    });
+  }
+
+  EXPECT_EQ(ticks.size(), 10ul);
+  EXPECT_EQ(ticks[0], 5ul);
+  EXPECT_EQ(ticks[9], 95ul);
+
+  /* @NOTE: missed periods are skipped and the phase is kept */
+  wheel.Advance(1000, [&](ULong UNUSED(handle), UInt& UNUSED(value)) {
+    count++;
+  });
+
+  EXPECT_EQ(count, 1ul);
+  EXPECT_EQ(wheel.Next(), 1005ul);
+
+  /* @NOTE: a periodic timer can cancel itself while it's firing */
+  wheel.Advance(2000, [&](ULong handle, UInt& UNUSED(value)) {
+    EXPECT_EQ(wheel.Cancel(handle), ENoError);
+  });
+
+  EXPECT_EQ(wheel.Size(), 0ul);
+}
+
+TEST(Wheel, Random) {
+  std::mt19937_64 random{42};
+  Base::Wheel<ULong> wheel{0};
+  Vector<ULong> handles{};
+  Vector<Bool> done{};
+  ULong now{0}, fired{0}, cancelled{0};
+
+  for (UInt round = 0; round < 200; ++round) {
+    for (UInt i = 0; i < 100; ++i) {
+      ULong delay = random() % (1ul << (4 + random() % 24));
+
+      handles.push_back(wheel.Put(now + delay, now + delay));
+      done.push_back(False);
+    }
+
+    for (UInt i = 0; i < 10; ++i) {
+      ULong index = random() % handles.size();
+
+      if (!done[index] && !wheel.Cancel(handles[index])) {
+        done[index] = True;
+        cancelled++;
+      }
+    }
+
+    now += random() % (1ul << (random() % 20));
+
+    wheel.Advance(now, [&](ULong handle, ULong& expiry) {
+      EXPECT_LE(expiry, now);
+      EXPECT_TRUE(wheel.Find(handle) == &expiry);
+      fired++;
+    });
+
+    /* @NOTE: nothing which is waiting may be due */
+    EXPECT_GT(wheel.Next(), now);
+  }
+
+  EXPECT_EQ(fired + cancelled + wheel.Size(), handles.size());
+}
+
+TEST(WheelBenchmark, Throughput) {
+  using Clock = std::chrono::high_resolution_clock;
+  using Nano = std::chrono::nanoseconds;
+
+  std::mt19937_64 random{7};
+  Base::Wheel<ULong> wheel{0};
+  Vector<ULong> handles(MAX_TIMERS);
+  ULong spent[3], fired{0};
+
+  /* @NOTE: timers spread over ~1 hour of milliseconds like connection
+   * timeouts do, most of them are cancelled before they expire */
+  auto begin = Clock::now();
+
+  for (ULong i = 0; i < MAX_TIMERS; ++i) {
+    handles[i] = wheel.Put(random() % (1ul << 22), i);
+  }
+
+  spent[0] = std::chrono::duration_cast<Nano>(Clock::now() - begin).count();
+  begin = Clock::now();
+
+  for (ULong i = 0; i < MAX_TIMERS; i += 2) {
+    wheel.Cancel(handles[i]);
+  }
+
+  spent[1] = std::chrono::duration_cast<Nano>(Clock::now() - begin).count();
+  begin = Clock::now();
+
+  for (ULong now = 0; now < (1ul << 22); now += 1000) {
+    fired += wheel.Advance(now, [](ULong UNUSED(handle),
+                                   ULong& UNUSED(value)) {});
+  }
+
+  fired += wheel.Advance(1ul << 22, [](ULong UNUSED(handle),
+                                       ULong& UNUSED(value)) {});
+  spent[2] = std::chrono::duration_cast<Nano>(Clock::now() - begin).count();
+
+  EXPECT_EQ(fired, ULong(MAX_TIMERS/2));
+  EXPECT_EQ(wheel.Size(), 0ul);
+
+  INFO << Base::Format{"wheel {} timers: put {}ns, cancel {}ns, fire {}ns"}
+              .Apply(MAX_TIMERS, spent[0]/MAX_TIMERS,
+                     spent[1]/(MAX_TIMERS/2), spent[2]/(MAX_TIMERS/2))
+       << Base::EOL;
+}
+
+int main() {
+  return RUN_ALL_TESTS();
+}